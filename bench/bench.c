@@ -0,0 +1,648 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <limits.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../src/bitset/bitset.h"
+#include "../src/output/output.h"
+#include "../src/parallel/parallel.h"
+#include "../src/storage/storage.h"
+
+#define BENCH_MAX_IDS (1 << 16)   // Элементов в пачке для поэлементных замеров
+#define BENCH_MAX_DENSITIES 16
+
+typedef enum {
+    FORMAT_CSV,
+    FORMAT_JSON
+} ReportFormat;
+
+typedef struct {
+    ReportFormat format;
+    int          repeat;
+    int          warmup;
+    double       minTime;          // Секунд на одно повторение
+    int          minLog;           // Вселенные от 2^minLog
+    int          maxLog;           // до 2^maxLog элементов
+    int          step;             // Шаг по степени двойки
+    double       densities[BENCH_MAX_DENSITIES];
+    size_t       densityCount;
+    const char*  filter;
+    size_t       printLimit;       // Наибольшая вселенная для вывода на экран
+    size_t       threads;
+} BenchOptions;
+
+/* Распределитель, считающий выделения */
+typedef struct {
+    Allocator base;
+    size_t    allocations;
+} CountingAllocator;
+
+static void* countingAllocate(Allocator* allocator, size_t bytes) {
+    ((CountingAllocator*)allocator)->allocations++;
+    return allocatorAllocate(NULL, bytes);
+}
+
+static void countingRelease(Allocator* allocator, void* memory, size_t bytes) {
+    (void)allocator;
+    allocatorRelease(NULL, memory, bytes);
+}
+
+static CountingAllocator counter = {
+    {countingAllocate, countingRelease, NULL}, 0};
+
+/* Данные одного замера */
+typedef struct {
+    size_t    capacity;
+    double    density;
+    BitSet    setA;
+    BitSet    setB;
+    BitSet    result;
+    BitSet    versioned; // Копия A в общей памяти (bitsetClone)
+    int*      ids;
+    uint64_t* found;     // Упакованные ответы bitsetContainsManyPacked
+    size_t    idCount;
+    size_t    sink;      // Не даёт компилятору выбросить результаты
+} BenchContext;
+
+typedef struct {
+    const char* name;
+    // Выполняет операции и возвращает их число
+    size_t (*run)(BenchContext* context);
+    // Байт данных множеств, затрагиваемых одной операцией (0 — не считается)
+    size_t (*bytes)(BenchContext* context);
+    bool   isPrinter;
+} BenchCase;
+
+static uint64_t randomState = 0x2545F4914F6CDD1DULL;
+
+static uint64_t randomNext(void) {
+    randomState ^= randomState >> 12;
+    randomState ^= randomState << 25;
+    randomState ^= randomState >> 27;
+    return randomState * 0x2545F4914F6CDD1DULL;
+}
+
+static double randomUnit(void) {
+    return (double)(randomNext() >> 11) / 9007199254740992.0;
+}
+
+static double now(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (double)time.tv_sec + (double)time.tv_nsec * 1e-9;
+}
+
+/*
+ * Заполняет множество с заданной плотностью: промежутки между элементами
+ * имеют геометрическое распределение, поэтому время пропорционально числу
+ * элементов. Биты пишутся напрямую, чтобы не ограничиваться int.
+ */
+static void populate(BitSet* set, double density) {
+    uint64_t* bits = bitsetBlocks(set);
+
+    if (density >= 1.0) {
+        memset(bits, 0xFF, set->blockCount * sizeof(uint64_t));
+        bits[set->blockCount - 1] &= bitsetLastBlockMask(set->capacity);
+    } else {
+        double scale    = 1.0 / log1p(-density);
+        double position = floor(log(1.0 - randomUnit()) * scale);
+
+        while (position <= (double)set->capacity) {
+            size_t element = (size_t)position;
+            bits[element / 64] |= (uint64_t)1 << (element % 64);
+            position += 1.0 + floor(log(1.0 - randomUnit()) * scale);
+        }
+    }
+    set->size = findSetSize(set);
+}
+
+static size_t wordBytes(BenchContext* context) {
+    return context->setA.blockCount * sizeof(uint64_t);
+}
+
+static size_t twoOperandBytes(BenchContext* context) {
+    return 3 * wordBytes(context);
+}
+
+static size_t oneOperandBytes(BenchContext* context) {
+    return 2 * wordBytes(context);
+}
+
+static size_t scanBytes(BenchContext* context) {
+    return 2 * wordBytes(context);
+}
+
+/* Поэлементные операции */
+static size_t runAdd(BenchContext* context) {
+    for (size_t iter = 0; iter < context->idCount; iter++) {
+        bitsetAdd(&context->result, context->ids[iter]);
+    }
+    return context->idCount;
+}
+
+static size_t runAddUnchecked(BenchContext* context) {
+    for (size_t iter = 0; iter < context->idCount; iter++) {
+        bitsetAddUnchecked(&context->result, context->ids[iter]);
+    }
+    return context->idCount;
+}
+
+static size_t runRemove(BenchContext* context) {
+    for (size_t iter = 0; iter < context->idCount; iter++) {
+        bitsetRemove(&context->result, context->ids[iter]);
+    }
+    return context->idCount;
+}
+
+static size_t runContains(BenchContext* context) {
+    size_t found = 0;
+    for (size_t iter = 0; iter < context->idCount; iter++) {
+        found += bitsetContains(&context->setA, context->ids[iter]);
+    }
+    context->sink += found;
+    return context->idCount;
+}
+
+static size_t runContainsUnchecked(BenchContext* context) {
+    size_t found = 0;
+    for (size_t iter = 0; iter < context->idCount; iter++) {
+        found += bitsetContainsUnchecked(&context->setA, context->ids[iter]);
+    }
+    context->sink += found;
+    return context->idCount;
+}
+
+/* Пакетные операции; одна операция — один элемент пачки */
+static size_t runContainsMany(BenchContext* context) {
+    bitsetContainsManyPacked(&context->setA, context->ids,
+                             (int)context->idCount, context->found);
+    context->sink += context->found[0];
+    return context->idCount;
+}
+
+static size_t runAddMany(BenchContext* context) {
+    bitsetAddMany(&context->result, context->ids, (int)context->idCount);
+    return context->idCount;
+}
+
+static size_t runRemoveMany(BenchContext* context) {
+    bitsetRemoveMany(&context->result, context->ids, (int)context->idCount);
+    return context->idCount;
+}
+
+// Конец диапазона bitsetAddRange: элементы выше INT_MAX недоступны
+static int rangeEnd(BenchContext* context) {
+    return context->capacity < INT_MAX ? (int)context->capacity + 1 : INT_MAX;
+}
+
+// Байт слов, записанных bitsetAddRange
+static size_t rangeBytes(BenchContext* context) {
+    return ((size_t)rangeEnd(context) + 63) / 64 * sizeof(uint64_t);
+}
+
+static size_t runAddRange(BenchContext* context) {
+    bitsetAddRange(&context->result, 0, rangeEnd(context));
+    return 1;
+}
+
+/* Операции над множествами целиком */
+static size_t runUnion(BenchContext* context) {
+    BitSet set = getSetsUnion(&context->setA, &context->setB);
+    context->sink += set.size;
+    bitsetDestroy(&set);
+    return 1;
+}
+
+static size_t runIntersection(BenchContext* context) {
+    BitSet set = getSetsIntersection(&context->setA, &context->setB);
+    context->sink += set.size;
+    bitsetDestroy(&set);
+    return 1;
+}
+
+static size_t runDifference(BenchContext* context) {
+    BitSet set = getSetsDifference(&context->setA, &context->setB);
+    context->sink += set.size;
+    bitsetDestroy(&set);
+    return 1;
+}
+
+static size_t runSymmetricDifference(BenchContext* context) {
+    BitSet set = getSetsSymmetricDifference(&context->setA, &context->setB);
+    context->sink += set.size;
+    bitsetDestroy(&set);
+    return 1;
+}
+
+static size_t runComplement(BenchContext* context) {
+    BitSet set = getComplementSet(&context->setA);
+    context->sink += set.size;
+    bitsetDestroy(&set);
+    return 1;
+}
+
+static size_t runUnionInto(BenchContext* context) {
+    getSetsUnionInto(&context->result, &context->setA, &context->setB);
+    return 1;
+}
+
+static size_t runIntersectionInto(BenchContext* context) {
+    getSetsIntersectionInto(&context->result, &context->setA, &context->setB);
+    return 1;
+}
+
+static size_t runDifferenceInto(BenchContext* context) {
+    getSetsDifferenceInto(&context->result, &context->setA, &context->setB);
+    return 1;
+}
+
+static size_t runSymmetricDifferenceInto(BenchContext* context) {
+    getSetsSymmetricDifferenceInto(&context->result, &context->setA,
+                                   &context->setB);
+    return 1;
+}
+
+static size_t runComplementInto(BenchContext* context) {
+    getComplementSetInto(&context->result, &context->setA);
+    return 1;
+}
+
+/* Предикаты и подсчёт; A сравнивается с копией, чтобы пройти все слова */
+static size_t runEqual(BenchContext* context) {
+    context->sink += setsIsEqual(&context->setA, &context->result);
+    return 1;
+}
+
+static size_t runSubset(BenchContext* context) {
+    context->sink += setIsSubset(&context->setA, &context->result);
+    return 1;
+}
+
+// Операции над массивом: A, B и копия A за один проход
+static size_t runUnionMany(BenchContext* context) {
+    BitSet* sets[3] = {&context->setA, &context->setB, &context->result};
+    BitSet  set     = bitsetUnionMany(sets, 3);
+    context->sink += set.size;
+    bitsetDestroy(&set);
+    return 1;
+}
+
+static size_t runMajorityMany(BenchContext* context) {
+    BitSet* sets[3] = {&context->setA, &context->setB, &context->result};
+    BitSet  set     = bitsetMajorityMany(sets, 3);
+    context->sink += set.size;
+    bitsetDestroy(&set);
+    return 1;
+}
+
+// Мощность пересечения без построения результата, ср. getSetsIntersection
+static size_t runIntersectionSize(BenchContext* context) {
+    context->sink += bitsetIntersectionSize(&context->setA, &context->setB);
+    return 1;
+}
+
+static size_t runJaccard(BenchContext* context) {
+    context->sink += (size_t)(bitsetJaccard(&context->setA, &context->setB) *
+                              1000.0);
+    return 1;
+}
+
+// Копия без копирования слов, ср. getSets* с полным результатом
+// Копия после записи: в общий объект переносится одна страница
+static size_t runClone(BenchContext* context) {
+    BitSet set;
+    bitsetAdd(&context->versioned, context->ids[0]);
+    if (bitsetClone(&context->versioned, &set) == 0) {
+        context->sink += set.size;
+        bitsetDestroy(&set);
+    }
+    return 1;
+}
+
+static size_t runSize(BenchContext* context) {
+    context->sink += findSetSize(&context->setA);
+    return 1;
+}
+
+static void countVisitor(int element, void* context) {
+    *(size_t*)context += (size_t)element;
+}
+
+static size_t runForEach(BenchContext* context) {
+    size_t total = 0;
+    bitsetForEach(&context->setA, countVisitor, &total);
+    context->sink += total;
+    return 1;
+}
+
+static size_t runPrintSet(BenchContext* context) {
+    printSet("A", &context->setA);
+    return 1;
+}
+
+static size_t runPrintBitView(BenchContext* context) {
+    printBitViewOfSet("A", &context->setA);
+    return 1;
+}
+
+static const BenchCase benchCases[] = {
+    {"bitsetAdd", runAdd, NULL, false},
+    {"bitsetAddUnchecked", runAddUnchecked, NULL, false},
+    {"bitsetRemove", runRemove, NULL, false},
+    {"bitsetContains", runContains, NULL, false},
+    {"bitsetContainsUnchecked", runContainsUnchecked, NULL, false},
+    {"bitsetContainsMany", runContainsMany, NULL, false},
+    {"bitsetAddMany", runAddMany, NULL, false},
+    {"bitsetRemoveMany", runRemoveMany, NULL, false},
+    {"bitsetAddRange", runAddRange, rangeBytes, false},
+    {"getSetsUnion", runUnion, twoOperandBytes, false},
+    {"getSetsIntersection", runIntersection, twoOperandBytes, false},
+    {"getSetsDifference", runDifference, twoOperandBytes, false},
+    {"getSetsSymmetricDifference", runSymmetricDifference, twoOperandBytes,
+     false},
+    {"getComplementSet", runComplement, oneOperandBytes, false},
+    {"getSetsUnionInto", runUnionInto, twoOperandBytes, false},
+    {"getSetsIntersectionInto", runIntersectionInto, twoOperandBytes, false},
+    {"getSetsDifferenceInto", runDifferenceInto, twoOperandBytes, false},
+    {"getSetsSymmetricDifferenceInto", runSymmetricDifferenceInto,
+     twoOperandBytes, false},
+    {"getComplementSetInto", runComplementInto, oneOperandBytes, false},
+    {"setsIsEqual", runEqual, scanBytes, false},
+    {"setIsSubset", runSubset, scanBytes, false},
+    {"bitsetUnionMany", runUnionMany, twoOperandBytes, false},
+    {"bitsetMajorityMany", runMajorityMany, twoOperandBytes, false},
+    {"bitsetIntersectionSize", runIntersectionSize, scanBytes, false},
+    {"bitsetJaccard", runJaccard, scanBytes, false},
+    {"bitsetClone", runClone, NULL, false},
+    {"findSetSize", runSize, wordBytes, false},
+    {"bitsetForEach", runForEach, wordBytes, false},
+    {"printSet", runPrintSet, wordBytes, true},
+    {"printBitViewOfSet", runPrintBitView, wordBytes, true},
+};
+
+static int compareDoubles(const void* left, const void* right) {
+    double a = *(const double*)left;
+    double b = *(const double*)right;
+    return (a > b) - (a < b);
+}
+
+// Подготовка перед каждым повторением: result — копия A
+static void resetResult(BenchContext* context) {
+    memcpy(bitsetBlocks(&context->result), bitsetBlocks(&context->setA),
+           context->setA.blockCount * sizeof(uint64_t));
+    context->result.size = context->setA.size;
+}
+
+static void runCase(const BenchCase* benchCase, BenchContext* context,
+                    BenchOptions* options, FILE* report, bool* isFirst) {
+    double samples[64];
+    int    repeat      = options->repeat < 64 ? options->repeat : 64;
+    size_t loops       = 1;
+    size_t operations  = 0;
+    size_t allocations = 0;
+
+    // Разогрев заодно подбирает число вызовов на одно повторение
+    for (int iter = 0; iter < options->warmup || iter == 0; iter++) {
+        resetResult(context);
+        double start = now();
+        for (size_t loop = 0; loop < loops; loop++) {
+            benchCase->run(context);
+        }
+        double elapsed = now() - start;
+        while (elapsed < options->minTime && loops < ((size_t)1 << 30)) {
+            loops *= 2;
+            elapsed *= 2;
+        }
+    }
+
+    for (int iter = 0; iter < repeat; iter++) {
+        size_t count = 0;
+        resetResult(context);
+        counter.allocations = 0;
+
+        double start = now();
+        for (size_t loop = 0; loop < loops; loop++) {
+            count += benchCase->run(context);
+        }
+        samples[iter] = (now() - start) * 1e9 / (double)count;
+
+        operations += count;
+        allocations += counter.allocations;
+    }
+
+    qsort(samples, (size_t)repeat, sizeof(double), compareDoubles);
+
+    double median     = samples[repeat / 2];
+    double gigabytes  = 0.0;
+    double allocsPer  = (double)allocations / (double)operations;
+
+    if (benchCase->bytes != NULL) {
+        gigabytes = (double)benchCase->bytes(context) / median;
+    }
+
+    if (options->format == FORMAT_CSV) {
+        fprintf(report, "%s,%zu,%g,%.3f,%.3f,%.3f,%.4f,%d\n", benchCase->name,
+                context->capacity + 1, context->density, median, samples[0],
+                gigabytes, allocsPer, repeat);
+    } else {
+        fprintf(report,
+                "%s\n  {\"benchmark\": \"%s\", \"universe\": %zu, "
+                "\"density\": %g, \"ns_per_op\": %.3f, \"min_ns_per_op\": "
+                "%.3f, \"gb_per_s\": %.3f, \"allocs_per_op\": %.4f, "
+                "\"repetitions\": %d}",
+                *isFirst ? "" : ",", benchCase->name, context->capacity + 1,
+                context->density, median, samples[0], gigabytes, allocsPer,
+                repeat);
+    }
+    fflush(report);
+    *isFirst = false;
+}
+
+static int runSweep(BenchOptions* options, FILE* report) {
+    int  status_code = 0;
+    bool isFirst     = true;
+
+    for (int logSize = options->minLog;
+         logSize <= options->maxLog && status_code == 0;
+         logSize += options->step) {
+        for (size_t densityIndex = 0;
+             densityIndex < options->densityCount && status_code == 0;
+             densityIndex++) {
+            BenchContext context;
+            context.capacity = ((size_t)1 << logSize) - 1;
+            context.density = options->densities[densityIndex];
+            context.setA = bitsetCreateWith(context.capacity, &counter.base);
+            context.setB = bitsetCreateWith(context.capacity, &counter.base);
+            context.result = bitsetCreateWith(context.capacity, &counter.base);
+            context.sink = 0;
+
+            // Элементы выше INT_MAX недоступны поэлементным функциям
+            size_t idLimit = context.capacity < INT_MAX ? context.capacity
+                                                        : INT_MAX;
+            context.idCount = idLimit + 1 < BENCH_MAX_IDS ? idLimit + 1
+                                                          : BENCH_MAX_IDS;
+            context.ids = (int*)malloc(context.idCount * sizeof(int));
+            context.found = (uint64_t*)malloc((context.idCount + 63) / 64 *
+                                              sizeof(uint64_t));
+
+            if (bitsetBlocks(&context.setA) == NULL ||
+                bitsetBlocks(&context.setB) == NULL ||
+                bitsetBlocks(&context.result) == NULL || context.ids == NULL ||
+                context.found == NULL) {
+                fprintf(stderr, "Не хватает памяти для вселенной 2^%d\n",
+                        logSize);
+                status_code = -1;
+            } else {
+                populate(&context.setA, context.density);
+                populate(&context.setB, context.density);
+                // Без копии в общей памяти замер bitsetClone пропускается
+                bool hasVersioned =
+                    bitsetClone(&context.setA, &context.versioned) == 0;
+                for (size_t iter = 0; iter < context.idCount; iter++) {
+                    context.ids[iter] = (int)(randomNext() % (idLimit + 1));
+                }
+
+                for (size_t iter = 0;
+                     iter < sizeof(benchCases) / sizeof(benchCases[0]);
+                     iter++) {
+                    const BenchCase* benchCase = &benchCases[iter];
+                    if ((options->filter == NULL ||
+                         strstr(benchCase->name, options->filter) != NULL) &&
+                        (!benchCase->isPrinter ||
+                         context.capacity < options->printLimit) &&
+                        (benchCase->run != runClone || hasVersioned)) {
+                        runCase(benchCase, &context, options, report, &isFirst);
+                    }
+                }
+                if (hasVersioned) {
+                    bitsetDestroy(&context.versioned);
+                }
+            }
+
+            free(context.found);
+            free(context.ids);
+            bitsetDestroy(&context.setA);
+            bitsetDestroy(&context.setB);
+            bitsetDestroy(&context.result);
+        }
+    }
+
+    return status_code;
+}
+
+static int parseDensities(BenchOptions* options, char* list) {
+    int status_code = 0;
+
+    options->densityCount = 0;
+    for (char* token = strtok(list, ","); token != NULL && status_code == 0;
+         token = strtok(NULL, ",")) {
+        double density = atof(token);
+        if (density <= 0.0 || density > 1.0 ||
+            options->densityCount == BENCH_MAX_DENSITIES) {
+            status_code = -1;
+        } else {
+            options->densities[options->densityCount++] = density;
+        }
+    }
+
+    return options->densityCount == 0 ? -1 : status_code;
+}
+
+static void printUsage(void) {
+    fprintf(stderr,
+            "Использование: bitsetBench [--format csv|json] [--repeat N]\n"
+            "  [--warmup N] [--min-time секунды] [--min-log K] [--max-log K]\n"
+            "  [--step K] [--densities 0.00001,0.01,1] [--filter имя]\n"
+            "  [--print-limit элементов] [--threads N]\n"
+            "Вселенные: 2^min-log .. 2^max-log (до 2^32), плотности в долях.\n");
+}
+
+int main(int argc, char** argv) {
+    int          status_code = 0;
+    char         defaultDensities[] = "0.00001,0.001,0.01,0.1,0.5,1";
+    BenchOptions options = {FORMAT_CSV, 5, 1, 0.01, 6, 24, 6, {0}, 0,
+                            NULL, (size_t)1 << 16, 1};
+
+    parseDensities(&options, defaultDensities);
+
+    for (int iter = 1; iter < argc && status_code == 0; iter++) {
+        const char* option = argv[iter];
+        const char* value  = iter + 1 < argc ? argv[iter + 1] : NULL;
+
+        if (value == NULL) {
+            status_code = -1;
+        } else if (strcmp(option, "--format") == 0) {
+            options.format = strcmp(value, "json") == 0 ? FORMAT_JSON
+                                                        : FORMAT_CSV;
+        } else if (strcmp(option, "--repeat") == 0) {
+            options.repeat = atoi(value);
+        } else if (strcmp(option, "--warmup") == 0) {
+            options.warmup = atoi(value);
+        } else if (strcmp(option, "--min-time") == 0) {
+            options.minTime = atof(value);
+        } else if (strcmp(option, "--min-log") == 0) {
+            options.minLog = atoi(value);
+        } else if (strcmp(option, "--max-log") == 0) {
+            options.maxLog = atoi(value);
+        } else if (strcmp(option, "--step") == 0) {
+            options.step = atoi(value);
+        } else if (strcmp(option, "--densities") == 0) {
+            status_code = parseDensities(&options, argv[iter + 1]);
+        } else if (strcmp(option, "--filter") == 0) {
+            options.filter = value;
+        } else if (strcmp(option, "--print-limit") == 0) {
+            options.printLimit = (size_t)atoll(value);
+        } else if (strcmp(option, "--threads") == 0) {
+            options.threads = (size_t)atoi(value);
+        } else {
+            status_code = -1;
+        }
+        iter++;
+    }
+
+    if (options.repeat < 1 || options.warmup < 0 || options.step < 1 ||
+        options.minLog < 1 || options.maxLog > 32 ||
+        options.minLog > options.maxLog) {
+        status_code = -1;
+    }
+
+    if (status_code != 0) {
+        printUsage();
+    } else {
+        // Отчёт идёт в исходный stdout, вывод функций печати — в /dev/null
+        FILE* report = fdopen(dup(fileno(stdout)), "w");
+
+        if (report == NULL || freopen("/dev/null", "w", stdout) == NULL) {
+            status_code = -1;
+        } else {
+            if (options.threads > 1) {
+                parallelInit(options.threads);
+            }
+
+            if (options.format == FORMAT_CSV) {
+                fprintf(report, "benchmark,universe,density,ns_per_op,"
+                                "min_ns_per_op,gb_per_s,allocs_per_op,"
+                                "repetitions\n");
+            } else {
+                fprintf(report, "[");
+            }
+
+            status_code = runSweep(&options, report);
+
+            if (options.format == FORMAT_JSON) {
+                fprintf(report, "\n]\n");
+            }
+
+            parallelShutdown();
+            fclose(report);
+        }
+    }
+
+    return status_code == 0 ? 0 : 1;
+}
@@ -0,0 +1,218 @@
+// MAP_ANONYMOUS не входит в POSIX 2008
+#define _DEFAULT_SOURCE
+
+#include "allocator.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+// aligned_alloc требует размер, кратный выравниванию
+static size_t alignedSize(size_t bytes) {
+    return (bytes + ALLOCATOR_ALIGNMENT - 1) & ~(size_t)(ALLOCATOR_ALIGNMENT - 1);
+}
+
+/*
+ * Малые массивы берутся из кучи и обнуляются сразу. Большие отображаются
+ * напрямую: ядро выдаёт нулевые страницы лениво, поэтому создание
+ * множества не трогает его слова. Вид выделения восстанавливается по
+ * размеру, который release получает тот же.
+ */
+static void* defaultAllocate(Allocator* allocator, size_t bytes) {
+    (void)allocator;
+    size_t size   = alignedSize(bytes == 0 ? 1 : bytes);
+    void*  memory = NULL;
+
+    if (size >= ALLOCATOR_MAP_THRESHOLD) {
+        memory = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) {
+            memory = NULL;
+        }
+    } else {
+        memory = aligned_alloc(ALLOCATOR_ALIGNMENT, size);
+        if (memory != NULL) {
+            memset(memory, 0, size);
+        }
+    }
+
+    return memory;
+}
+
+static void defaultRelease(Allocator* allocator, void* memory, size_t bytes) {
+    (void)allocator;
+    size_t size = alignedSize(bytes == 0 ? 1 : bytes);
+
+    if (size >= ALLOCATOR_MAP_THRESHOLD) {
+        munmap(memory, size);
+    } else {
+        free(memory);
+    }
+}
+
+static Allocator defaultAllocator = {defaultAllocate, defaultRelease, NULL};
+
+Allocator* allocatorDefault(void) {
+    return &defaultAllocator;
+}
+
+// Распределитель, пригодный для новых выделений
+Allocator* allocatorResolve(Allocator* allocator) {
+    if (allocator == NULL || allocator->allocate == NULL) {
+        allocator = &defaultAllocator;
+    }
+    return allocator;
+}
+
+void* allocatorAllocate(Allocator* allocator, size_t bytes) {
+    allocator = allocatorResolve(allocator);
+    return allocator->allocate(allocator, bytes);
+}
+
+void allocatorRelease(Allocator* allocator, void* memory, size_t bytes) {
+    if (memory != NULL) {
+        if (allocator == NULL) {
+            allocator = &defaultAllocator;
+        }
+        allocator->release(allocator, memory, bytes);
+    }
+}
+
+static bool arenaOwns(ArenaAllocator* arena, void* memory) {
+    unsigned char* pointer = (unsigned char*)memory;
+    return arena->memory != NULL && pointer >= arena->memory &&
+           pointer < arena->memory + arena->capacity;
+}
+
+static void* arenaAllocate(Allocator* allocator, size_t bytes) {
+    ArenaAllocator* arena  = (ArenaAllocator*)allocator;
+    size_t          size   = alignedSize(bytes == 0 ? 1 : bytes);
+    void*           memory = NULL;
+
+    if (arena->memory != NULL && size <= arena->capacity - arena->used) {
+        memory = arena->memory + arena->used;
+        arena->used += size;
+        memset(memory, 0, size);
+    } else {
+        memory = defaultAllocate(NULL, bytes);
+        arena->overflow += memory != NULL;
+    }
+
+    return memory;
+}
+
+// Память арены возвращается только сбросом
+static void arenaRelease(Allocator* allocator, void* memory, size_t bytes) {
+    if (!arenaOwns((ArenaAllocator*)allocator, memory)) {
+        defaultRelease(NULL, memory, bytes);
+    }
+}
+
+int allocatorArenaInit(ArenaAllocator* arena, size_t capacity) {
+    int status_code = 0;
+
+    arena->base.allocate = arenaAllocate;
+    arena->base.release = arenaRelease;
+    arena->base.touch = NULL;
+    arena->capacity = alignedSize(capacity);
+    arena->memory = (unsigned char*)aligned_alloc(ALLOCATOR_ALIGNMENT,
+                                                  arena->capacity);
+    arena->used = 0;
+    arena->overflow = 0;
+
+    if (arena->memory == NULL) {
+        arena->capacity = 0;
+        status_code = -1;
+    }
+
+    return status_code;
+}
+
+void allocatorArenaReset(ArenaAllocator* arena) {
+    arena->used = 0;
+}
+
+void allocatorArenaDestroy(ArenaAllocator* arena) {
+    free(arena->memory);
+    arena->memory = NULL;
+    arena->capacity = 0;
+    arena->used = 0;
+}
+
+// Размер массивов класса: пул выделяет и освобождает их целиком
+static size_t poolClassSize(int sizeClass) {
+    return (size_t)ALLOCATOR_ALIGNMENT << sizeClass;
+}
+
+// Номер класса размера или -1, если массив слишком велик для пула
+static int poolClass(size_t bytes) {
+    int    sizeClass = 0;
+    size_t classSize = ALLOCATOR_ALIGNMENT;
+
+    while (classSize < bytes && sizeClass < ALLOCATOR_POOL_CLASSES) {
+        classSize <<= 1;
+        sizeClass++;
+    }
+
+    return sizeClass < ALLOCATOR_POOL_CLASSES ? sizeClass : -1;
+}
+
+static void* poolAllocate(Allocator* allocator, size_t bytes) {
+    PoolAllocator* pool      = (PoolAllocator*)allocator;
+    int            sizeClass = poolClass(bytes);
+    void*          memory    = NULL;
+
+    if (sizeClass >= 0 && pool->freeLists[sizeClass] != NULL) {
+        // Первое слово свободного массива хранит указатель на следующий
+        memory = pool->freeLists[sizeClass];
+        pool->freeLists[sizeClass] = *(void**)memory;
+        pool->cached[sizeClass]--;
+        pool->hits++;
+        memset(memory, 0, bytes == 0 ? 1 : bytes);
+    } else {
+        size_t size = sizeClass >= 0 ? poolClassSize(sizeClass) : bytes;
+        memory = defaultAllocate(NULL, size);
+        pool->misses++;
+    }
+
+    return memory;
+}
+
+static void poolRelease(Allocator* allocator, void* memory, size_t bytes) {
+    PoolAllocator* pool      = (PoolAllocator*)allocator;
+    int            sizeClass = poolClass(bytes);
+
+    if (sizeClass >= 0 && pool->cached[sizeClass] < pool->maxCached) {
+        *(void**)memory = pool->freeLists[sizeClass];
+        pool->freeLists[sizeClass] = memory;
+        pool->cached[sizeClass]++;
+    } else {
+        defaultRelease(NULL, memory,
+                       sizeClass >= 0 ? poolClassSize(sizeClass) : bytes);
+    }
+}
+
+void allocatorPoolInit(PoolAllocator* pool, size_t maxCached) {
+    pool->base.allocate = poolAllocate;
+    pool->base.release = poolRelease;
+    pool->base.touch = NULL;
+    pool->maxCached = maxCached;
+    pool->hits = 0;
+    pool->misses = 0;
+    for (int sizeClass = 0; sizeClass < ALLOCATOR_POOL_CLASSES; sizeClass++) {
+        pool->freeLists[sizeClass] = NULL;
+        pool->cached[sizeClass] = 0;
+    }
+}
+
+void allocatorPoolDestroy(PoolAllocator* pool) {
+    for (int sizeClass = 0; sizeClass < ALLOCATOR_POOL_CLASSES; sizeClass++) {
+        while (pool->freeLists[sizeClass] != NULL) {
+            void* memory = pool->freeLists[sizeClass];
+            pool->freeLists[sizeClass] = *(void**)memory;
+            defaultRelease(NULL, memory, poolClassSize(sizeClass));
+        }
+        pool->cached[sizeClass] = 0;
+    }
+}
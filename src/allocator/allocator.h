@@ -0,0 +1,72 @@
+#ifndef ALLOCATOR_H
+#define ALLOCATOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ALLOCATOR_ALIGNMENT 64      // Размер строки кэша
+#define ALLOCATOR_POOL_CLASSES 15   // Классы размеров пула: 64 байта .. 1 МиБ
+#define ALLOCATOR_MAP_THRESHOLD (128 * 1024)  // С этого размера — mmap
+
+/*
+ * Распределитель памяти для блоков множеств. allocate возвращает обнулённую
+ * память, выровненную по ALLOCATOR_ALIGNMENT, или NULL; release получает
+ * тот же размер, что был запрошен. Распределитель по умолчанию отдаёт
+ * массивы от ALLOCATOR_MAP_THRESHOLD байт анонимным отображением: страницы
+ * обнуляются ядром при первом обращении, и большое разреженное множество
+ * не занимает память под нетронутые слова. Распределитель без allocate
+ * только освобождает память, полученную иначе (например, отображение
+ * файла), а новые выделения для него берутся у распределителя по
+ * умолчанию. Необязательный touch получает слова [fromBlock, toBlock),
+ * изменённые множеством (общие страницы копий, см. bitsetCreateShared).
+ */
+typedef struct Allocator Allocator;
+
+struct Allocator {
+    void* (*allocate)(Allocator* allocator, size_t bytes);
+    void (*release)(Allocator* allocator, void* memory, size_t bytes);
+    void (*touch)(Allocator* allocator, size_t fromBlock, size_t toBlock);
+};
+
+/*
+ * Арена: выделение сдвигом указателя, освобождение отдельных блоков не
+ * выполняется, сброс за O(1). Запросы, не поместившиеся в арену,
+ * передаются распределителю по умолчанию.
+ */
+typedef struct {
+    Allocator      base;
+    unsigned char* memory;
+    size_t         capacity;  // Размер арены в байтах
+    size_t         used;      // Занято байт
+    size_t         overflow;  // Выделений вне арены
+} ArenaAllocator;
+
+/*
+ * Пул: освобождённые массивы складываются в списки по классам размеров
+ * (степени двойки) и переиспользуются. Не потокобезопасен.
+ */
+typedef struct {
+    Allocator base;
+    void*     freeLists[ALLOCATOR_POOL_CLASSES];
+    size_t    cached[ALLOCATOR_POOL_CLASSES];
+    size_t    maxCached;  // Наибольшее число хранимых массивов одного класса
+    size_t    hits;       // Выделений из списков
+    size_t    misses;     // Выделений у распределителя по умолчанию
+} PoolAllocator;
+
+/* Общие функции; allocator == NULL означает распределитель по умолчанию */
+Allocator* allocatorDefault(void);
+Allocator* allocatorResolve(Allocator* allocator);
+void* allocatorAllocate(Allocator* allocator, size_t bytes);
+void allocatorRelease(Allocator* allocator, void* memory, size_t bytes);
+
+/* Арена */
+int allocatorArenaInit(ArenaAllocator* arena, size_t capacity);
+void allocatorArenaReset(ArenaAllocator* arena);
+void allocatorArenaDestroy(ArenaAllocator* arena);
+
+/* Пул */
+void allocatorPoolInit(PoolAllocator* pool, size_t maxCached);
+void allocatorPoolDestroy(PoolAllocator* pool);
+
+#endif
@@ -1,192 +1,2272 @@
 #include "bitset.h"
 
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
+
+#include "../compare/compare.h"
+#include "../gather/gather.h"
+#include "../parallel/parallel.h"
+#include "../popcount/popcount.h"
+#include "../stats/stats.h"
+
+// Размер порции слов, которая вычисляется и сразу подсчитывается из кэша L1
+#define BITSET_CHUNK_BLOCKS 512
+
+// Кандидатов за один проход запроса в bitsetJaccardMany
+#define BITSET_BATCH_CANDIDATES 64
+
+// Слов упакованных ответов на порцию bitsetContainsMany (4096 элементов)
+#define BITSET_BATCH_WORDS 64
+
+// Порция слов пороговой операции: разрядные срезы счётчиков порции
+// помещаются в L1. Число множеств ограничено 2^BITSET_COUNTER_PLANES - 1
+#define BITSET_THRESHOLD_BLOCKS 64
+#define BITSET_COUNTER_PLANES 32
+
+// Порядок до стольких множеств операции над массивом хранится на стеке
+#define BITSET_MANY_STACK_SETS 64
+
+// Множества крупнее этого числа слов не помещаются в L2, и неупорядоченную
+// пачку элементов выгоднее сначала разложить по корзинам
+#define BITSET_BUCKET_MIN_BLOCKS 32768
+#define BITSET_BUCKET_MIN_ELEMENTS 4096
+#define BITSET_BUCKET_MAX_COUNT 4096
+
+// Индекс rank/select: накопленные суммы на суперблок и суммы внутри
+// суперблока на блок, около 5% памяти множества
+#define INDEX_SUPER_WORDS 64   // Слов в суперблоке (4096 элементов)
+#define INDEX_BLOCK_WORDS 8    // Слов в блоке (512 элементов)
+
+struct BitsetIndex {
+    uint64_t* superCounts;   // Элементов до суперблока; superCount + 1 значений
+    uint16_t* blockCounts;   // Элементов от начала суперблока до блока
+    size_t    superCount;
+    size_t    blockCount;
+    size_t    dirtyFrom;     // Устаревшие суперблоки [dirtyFrom, dirtyTo)
+    size_t    dirtyTo;
+};
+
+/*
+ * Сводка непустых слов: бит уровня 1 на каждое непустое слово множества и
+ * бит уровня 2 на каждое непустое слово уровня 1. Сводка всегда точна.
+ */
+struct BitsetSummary {
+    uint64_t* words;       // Уровень 1
+    uint64_t* groups;      // Уровень 2
+    size_t    wordCount;   // Слов уровня 1
+    size_t    groupCount;  // Слов уровня 2
+};
+
+typedef enum {
+    RANGE_ADD,
+    RANGE_REMOVE,
+    RANGE_FLIP
+} RangeOperation;
+
+typedef enum {
+    SET_UNION,
+    SET_INTERSECTION,
+    SET_DIFFERENCE,
+    SET_SYMMETRIC_DIFFERENCE
+} SetOperation;
+
+// Контекст операции, выполняемой частями в пуле потоков
+typedef struct {
+    SetOperation operation;
+    BitSet*      result;
+    BitSet*      setA;
+    BitSet*      setB;
+    BitSet**     sets;                            // Входы операций над массивом
+    size_t       setsCount;
+    size_t       threshold;                       // Порог bitsetThresholdMany
+    atomic_uint  relation;                        // Признаки COMPARE_*
+    unsigned     wantMask;                        // Нужные признаки
+    unsigned     stopMask;                        // Признаки досрочного выхода
+    size_t       partial[PARALLEL_MAX_THREADS];   // Размеры частей результата
+} BitsetTask;
+
+// Сумма частичных размеров после parallelFor
+static size_t bitsetTaskTotal(BitsetTask* task, size_t parts) {
+    size_t total = 0;
+    for (size_t part = 0; part < parts; part++) {
+        total += task->partial[part];
+    }
+    return total;
+}
+
+uint64_t* bitsetBlocks(BitSet* set) {
+    uint64_t* bits = set->bits;
+    if (bits == NULL && set->blockCount != 0) {
+        bits = set->inlineBits;
+    }
+    return bits;
+}
+
+#ifdef BITSET_STATS
+// Байт слов в куче: малое множество хранит слова внутри структуры
+static size_t heapBytes(BitSet* set) {
+    return set->bits != NULL ? set->blockCount * sizeof(uint64_t) : 0;
+}
+#endif
 
 BitSet bitsetCreate(size_t capacity) {
-    size_t blockCount = (capacity + 63) / 64;
+    return bitsetCreateWith(capacity, NULL);
+}
+
+BitSet bitsetCreateWith(size_t capacity, Allocator* allocator) {
+    STATS_BEGIN();
+    // Элементы принимают значения 0..capacity включительно
+    size_t blockCount = capacity / 64 + 1;
 
     BitSet set;
-    set.bits = (uint64_t*)calloc(blockCount, sizeof(uint64_t));
+    set.allocator = allocatorResolve(allocator);
+    set.index = NULL;
+    set.summary = NULL;
+    set.growable = false;
+    set.bits = NULL;
+    memset(set.inlineBits, 0, sizeof(set.inlineBits));
+    if (blockCount > BITSET_INLINE_WORDS) {
+        set.bits = (uint64_t*)allocatorAllocate(
+            set.allocator, blockCount * sizeof(uint64_t));
+    }
 
-    if (memoryIsAllocated(set.bits) == 0) {
+    if (blockCount <= BITSET_INLINE_WORDS || memoryIsAllocated(set.bits) == 0) {
         set.blockCount = blockCount;
         set.capacity = capacity;
+        STATS_MEMORY(1, (int64_t)heapBytes(&set));
     } else {
         set.blockCount = 0;
         set.capacity = 0;
     }
     set.size = 0;
 
+    STATS_END(STATS_BITSET_CREATE);
     return set;
 }
 
-void bitsetAdd(BitSet* set, int element) {
-    if (elementCanBeCreated(element, set->capacity) == 0 &&
-        !bitsetContains(set, element)
-        ) {
-        int arrayBlock = element / 64;
-        int elementBit = element % 64;
-        set->bits[arrayBlock] |= ((uint64_t)1 << (63 - elementBit));
-        set->size += 1;
+BitSet bitsetCreateGrowable(size_t capacity) {
+    BitSet set = bitsetCreate(capacity);
+
+    if (bitsetBlocks(&set) != NULL) {
+        set.capacity = set.blockCount * 64 - 1;
+        set.growable = true;
+    }
+
+    return set;
+}
+
+/*
+ * Перевыделяет слова множества под blockCount слов: общие слова
+ * копируются, новые обнуляются. До BITSET_INLINE_WORDS слов множество
+ * возвращается во встроенный буфер. Индекс и сводка строятся заново.
+ */
+static int bitsetResize(BitSet* set, size_t blockCount) {
+    int        status_code = 0;
+    Allocator* allocator   = allocatorResolve(set->allocator);
+    uint64_t*  bits        = NULL;
+
+    if (blockCount > BITSET_INLINE_WORDS) {
+        bits = (uint64_t*)allocatorAllocate(allocator,
+                                            blockCount * sizeof(uint64_t));
+        status_code = memoryIsAllocated(bits);
+    }
+
+    if (status_code == 0) {
+        bool     hadIndex   = set->index != NULL;
+        bool     hadSummary = set->summary != NULL;
+        size_t   common     = blockCount < set->blockCount ? blockCount
+                                                           : set->blockCount;
+        uint64_t words[BITSET_INLINE_WORDS] = {0};
+
+        // Индекс и сводка освобождаются прежним распределителем
+        bitsetIndexDestroy(set);
+        bitsetSummaryDestroy(set);
+
+        memcpy(bits != NULL ? bits : words, bitsetBlocks(set),
+               common * sizeof(uint64_t));
+        STATS_MEMORY(0, -(int64_t)heapBytes(set));
+        allocatorRelease(set->allocator, set->bits,
+                         set->blockCount * sizeof(uint64_t));
+        if (bits == NULL) {
+            memcpy(set->inlineBits, words, sizeof(words));
+        }
+
+        set->bits = bits;
+        set->blockCount = blockCount;
+        set->allocator = allocator;
+        STATS_MEMORY(0, (int64_t)heapBytes(set));
+
+        if (hadSummary) {
+            status_code = bitsetSummaryBuild(set);
+        }
+        if (hadIndex && bitsetIndexBuild(set) != 0) {
+            status_code = -1;
+        }
+    }
+
+    return status_code;
+}
+
+int bitsetReserve(BitSet* set, size_t capacity) {
+    int status_code = bitsetBlocks(set) != NULL ? 0 : -1;
+
+    if (status_code == 0 && capacity > set->capacity) {
+        size_t blockCount = capacity / 64 + 1;
+
+        // Растущее множество удваивается, чтобы добавление по возрастанию
+        // перевыделяло память O(log n) раз
+        if (set->growable && blockCount < set->blockCount * 2) {
+            blockCount = set->blockCount * 2;
+        }
+        if (blockCount != set->blockCount) {
+            status_code = bitsetResize(set, blockCount);
+        }
+        if (status_code == 0) {
+            set->capacity = set->growable ? blockCount * 64 - 1 : capacity;
+        }
+    }
+
+    return status_code;
+}
+
+int bitsetShrinkToFit(BitSet* set) {
+    int status_code = bitsetBlocks(set) != NULL ? 0 : -1;
+
+    if (status_code == 0 && set->growable) {
+        int    maximum    = bitsetPrevSet(set, (int)set->capacity);
+        size_t blockCount = maximum >= 0 ? (size_t)maximum / 64 + 1 : 1;
+
+        if (blockCount < set->blockCount) {
+            status_code = bitsetResize(set, blockCount);
+            if (status_code == 0) {
+                set->capacity = blockCount * 64 - 1;
+            }
+        }
+    }
+
+    return status_code;
+}
+
+// Растущее множество расширяется до элемента; ошибки сообщает вызывающий
+static void bitsetGrowTo(BitSet* set, int element) {
+    if (set->growable && element >= 0 && (size_t)element > set->capacity) {
+        bitsetReserve(set, (size_t)element);
+    }
+}
+
+// Сообщает распределителю об изменённых словах (общие страницы копий)
+static void wordsTouch(BitSet* set, size_t fromBlock, size_t toBlock) {
+    Allocator* allocator = set->allocator;
+
+    if (allocator->touch != NULL && fromBlock < toBlock) {
+        allocator->touch(allocator, fromBlock, toBlock);
+    }
+}
+
+// Помечает слова [fromBlock, toBlock) изменёнными для индекса и копий
+static void indexTouch(BitSet* set, size_t fromBlock, size_t toBlock) {
+    BitsetIndex* index = set->index;
+
+    wordsTouch(set, fromBlock, toBlock);
+    if (index != NULL && fromBlock < toBlock) {
+        size_t from = fromBlock / INDEX_SUPER_WORDS;
+        size_t to   = (toBlock - 1) / INDEX_SUPER_WORDS + 1;
+
+        if (index->dirtyFrom >= index->dirtyTo) {
+            index->dirtyFrom = from;
+            index->dirtyTo = to;
+        } else {
+            index->dirtyFrom = from < index->dirtyFrom ? from : index->dirtyFrom;
+            index->dirtyTo = to > index->dirtyTo ? to : index->dirtyTo;
+        }
+    }
+}
+
+// Младшие count бит слова
+static uint64_t lowBitsMask(size_t count) {
+    return count >= 64 ? ~(uint64_t)0 : ((uint64_t)1 << count) - 1;
+}
+
+// Отмечает в сводке, пусто ли слово block
+static void summaryMark(BitsetSummary* summary, size_t block, bool nonEmpty) {
+    size_t   word     = block / 64;
+    uint64_t bit      = (uint64_t)1 << (block % 64);
+    uint64_t groupBit = (uint64_t)1 << (word % 64);
+
+    if (nonEmpty) {
+        summary->words[word] |= bit;
+        summary->groups[word / 64] |= groupBit;
+    } else {
+        summary->words[word] &= ~bit;
+        if (summary->words[word] == 0) {
+            summary->groups[word / 64] &= ~groupBit;
+        }
+    }
+}
+
+// Пересчитывает сводку для слов [fromBlock, toBlock) по их содержимому
+static void summaryRefresh(BitSet* set, size_t fromBlock, size_t toBlock) {
+    BitsetSummary* summary = set->summary;
+    uint64_t*      bits    = bitsetBlocks(set);
+
+    if (summary != NULL && fromBlock < toBlock) {
+        size_t firstWord = fromBlock / 64;
+        size_t lastWord  = (toBlock - 1) / 64;
+
+        for (size_t word = firstWord; word <= lastWord; word++) {
+            uint64_t mask  = 0;
+            size_t   start = word * 64;
+            size_t   end   = start + 64 < set->blockCount ? start + 64
+                                                           : set->blockCount;
+            for (size_t block = start; block < end; block++) {
+                mask |= (uint64_t)(bits[block] != 0) << (block - start);
+            }
+            summary->words[word] = mask;
+        }
+
+        for (size_t group = firstWord / 64; group <= lastWord / 64; group++) {
+            uint64_t mask  = 0;
+            size_t   start = group * 64;
+            size_t   end   = start + 64 < summary->wordCount
+                                 ? start + 64 : summary->wordCount;
+            for (size_t word = start; word < end; word++) {
+                mask |= (uint64_t)(summary->words[word] != 0) << (word - start);
+            }
+            summary->groups[group] = mask;
+        }
+    }
+}
+
+// Первое непустое слово с номером не меньше block или blockCount
+static size_t summaryNextBlock(BitSet* set, size_t block) {
+    BitsetSummary* summary = set->summary;
+    size_t         word    = block / 64;
+    uint64_t       bits    = summary->words[word] &
+                             (~(uint64_t)0 << (block % 64));
+
+    if (bits == 0) {
+        size_t   group     = word / 64;
+        uint64_t groupBits = summary->groups[group] &
+                             (~(uint64_t)0 << (word % 64) << 1);
+
+        while (groupBits == 0 && ++group < summary->groupCount) {
+            groupBits = summary->groups[group];
+        }
+        if (groupBits != 0) {
+            word = group * 64 + (size_t)__builtin_ctzll(groupBits);
+            bits = summary->words[word];
+        }
+    }
+
+    return bits != 0 ? word * 64 + (size_t)__builtin_ctzll(bits)
+                     : set->blockCount;
+}
+
+// Последнее непустое слово с номером не больше block или 0
+static size_t summaryPrevBlock(BitSet* set, size_t block) {
+    BitsetSummary* summary = set->summary;
+    size_t         word    = block / 64;
+    uint64_t       bits    = summary->words[word] &
+                             (~(uint64_t)0 >> (63 - block % 64));
+
+    if (bits == 0) {
+        size_t   group     = word / 64;
+        uint64_t groupBits = summary->groups[group] &
+                             lowBitsMask(word % 64);
+
+        while (groupBits == 0 && group > 0) {
+            groupBits = summary->groups[--group];
+        }
+        if (groupBits != 0) {
+            word = group * 64 + 63 - (size_t)__builtin_clzll(groupBits);
+            bits = summary->words[word];
+        }
+    }
+
+    return bits != 0 ? word * 64 + 63 - (size_t)__builtin_clzll(bits) : 0;
+}
+
+/*
+ * Следующее слово для просмотра, начиная с block: со сводкой пустые слова
+ * пропускаются, без неё возвращается сам block.
+ */
+static size_t bitsetNextBlock(BitSet* set, size_t block) {
+    if (set->summary != NULL && block < set->blockCount) {
+        block = summaryNextBlock(set, block);
+    }
+    return block;
+}
+
+// Слова [fromBlock, toBlock) изменены: индекс устаревает, сводка обновляется
+static void bitsetTouch(BitSet* set, size_t fromBlock, size_t toBlock) {
+    indexTouch(set, fromBlock, toBlock);
+    summaryRefresh(set, fromBlock, toBlock);
+}
+
+void bitsetBlocksChanged(BitSet* set, size_t fromBlock, size_t toBlock) {
+    if (toBlock > set->blockCount) {
+        toBlock = set->blockCount;
+    }
+    bitsetTouch(set, fromBlock, toBlock);
+}
+
+int bitsetAdd(BitSet* set, int element) {
+    STATS_BEGIN();
+    bitsetGrowTo(set, element);
+    int status_code = elementCanBeCreated(element, set->capacity);
+    if (status_code == 0) {
+        bitsetAddUnchecked(set, element);
+    }
+    STATS_END(STATS_BITSET_ADD);
+    return status_code;
+}
+
+void bitsetAddUnchecked(BitSet* set, int element) {
+    uint64_t* block = &bitsetBlocks(set)[element / 64];
+    uint64_t  mask  = bitsetElementMask(element);
+
+    set->size += (*block & mask) == 0;
+    *block |= mask;
+    if (set->index != NULL) {
+        indexTouch(set, (size_t)element / 64, (size_t)element / 64 + 1);
+    } else {
+        wordsTouch(set, (size_t)element / 64, (size_t)element / 64 + 1);
+    }
+    if (set->summary != NULL) {
+        summaryMark(set->summary, (size_t)element / 64, *block != 0);
+    }
+}
+
+/*
+ * Подряд идущие элементы одного слова собираются в маску и записываются
+ * одной операцией; размер поправляется разницей popcount слова.
+ */
+static void bitsetApplyWordRuns(BitSet* set, const int* array, size_t count,
+                                bool isAdd) {
+    uint64_t* bits = bitsetBlocks(set);
+    size_t    iter = 0;
+
+    while (iter < count) {
+        size_t   block = (size_t)array[iter] / 64;
+        uint64_t mask  = 0;
+
+        while (iter < count && (size_t)array[iter] / 64 == block) {
+            mask |= bitsetElementMask(array[iter]);
+            iter++;
+        }
+
+        uint64_t before = bits[block];
+        uint64_t after  = isAdd ? before | mask : before & ~mask;
+
+        bits[block] = after;
+        indexTouch(set, block, block + 1);
+        if (set->summary != NULL) {
+            summaryMark(set->summary, block, after != 0);
+        }
+        set->size = set->size + (size_t)__builtin_popcountll(after) -
+                    (size_t)__builtin_popcountll(before);
+    }
+}
+
+/*
+ * Раскладывает элементы по корзинам старших бит (сортировка подсчётом),
+ * чтобы запись в большое множество шла по возрастанию адресов.
+ * Возвращает -1, если не удалось выделить память.
+ */
+static int bitsetApplyBucketed(BitSet* set, const int* array, size_t count,
+                               bool isAdd) {
+    int        status_code = 0;
+    int        shift       = 12;
+    Allocator* allocator   = allocatorResolve(set->allocator);
+
+    while ((set->capacity >> shift) >= BITSET_BUCKET_MAX_COUNT) {
+        shift++;
+    }
+
+    size_t  bucketCount = (set->capacity >> shift) + 1;
+    size_t* offsets     = (size_t*)allocatorAllocate(
+        allocator, (bucketCount + 1) * sizeof(size_t));
+    int*    sorted      = (int*)allocatorAllocate(allocator,
+                                                  count * sizeof(int));
+
+    if (offsets == NULL || sorted == NULL) {
+        status_code = -1;
+    } else {
+        for (size_t iter = 0; iter < count; iter++) {
+            offsets[((size_t)array[iter] >> shift) + 1]++;
+        }
+        for (size_t bucket = 1; bucket <= bucketCount; bucket++) {
+            offsets[bucket] += offsets[bucket - 1];
+        }
+        for (size_t iter = 0; iter < count; iter++) {
+            sorted[offsets[(size_t)array[iter] >> shift]++] = array[iter];
+        }
+        bitsetApplyWordRuns(set, sorted, count, isAdd);
+    }
+
+    allocatorRelease(allocator, offsets, (bucketCount + 1) * sizeof(size_t));
+    allocatorRelease(allocator, sorted, count * sizeof(int));
+
+    return status_code;
+}
+
+/*
+ * Пакетная обработка: границы проверяются один раз по минимуму и максимуму.
+ * Пачка с выходом за границы обрабатывается поэлементно, чтобы сообщить
+ * о каждом неверном элементе.
+ */
+static void bitsetApplyMany(BitSet* set, int* array, int elementsCount,
+                            bool isAdd) {
+    if (elementsCount > 0 && bitsetBlocks(set) != NULL) {
+        size_t count    = (size_t)elementsCount;
+        int    minimum  = array[0];
+        int    maximum  = array[0];
+        size_t descents = 0;
+
+        for (size_t iter = 1; iter < count; iter++) {
+            minimum = array[iter] < minimum ? array[iter] : minimum;
+            maximum = array[iter] > maximum ? array[iter] : maximum;
+            descents += array[iter] < array[iter - 1];
+        }
+        if (isAdd) {
+            bitsetGrowTo(set, maximum);
+        }
+
+        if (minimum < 0 || set->capacity < (size_t)maximum) {
+            for (size_t iter = 0; iter < count; iter++) {
+                if (isAdd) {
+                    bitsetAdd(set, array[iter]);
+                } else {
+                    bitsetRemove(set, array[iter]);
+                }
+            }
+        } else if (descents == 0 || count < BITSET_BUCKET_MIN_ELEMENTS ||
+                   set->blockCount < BITSET_BUCKET_MIN_BLOCKS ||
+                   bitsetApplyBucketed(set, array, count, isAdd) != 0) {
+            bitsetApplyWordRuns(set, array, count, isAdd);
+        }
     }
 }
 
 void bitsetAddMany(BitSet* set, int* array, int elementsCount) {
-    for (int iter = 0; iter < elementsCount; iter++) {
-        bitsetAdd(set, array[iter]);
+    STATS_BEGIN();
+    bitsetApplyMany(set, array, elementsCount, true);
+    STATS_END(STATS_BITSET_ADD_MANY);
+}
+
+int bitsetRemove(BitSet* set, int element) {
+    STATS_BEGIN();
+    int status_code = 0;
+
+    // В растущем множестве элементов за capacity просто нет
+    if (!set->growable || element < 0 || (size_t)element <= set->capacity) {
+        status_code = elementCanBeCreated(element, set->capacity);
     }
+    if (status_code == 0 && (size_t)element <= set->capacity) {
+        bitsetRemoveUnchecked(set, element);
+    }
+    STATS_END(STATS_BITSET_REMOVE);
+    return status_code;
 }
 
-void bitsetRemove(BitSet* set, int element) {
-    if (elementCanBeCreated(element, set->capacity) == 0 && bitsetContains(set, element)) {
-        int arrayBlock = element / 64;
-        int elementBit = element % 64;
-        set->bits[arrayBlock] &= ~((uint64_t)1 << (63 - elementBit));
-        set->size -= 1;
+void bitsetRemoveUnchecked(BitSet* set, int element) {
+    uint64_t* block = &bitsetBlocks(set)[element / 64];
+    uint64_t  mask  = bitsetElementMask(element);
+
+    set->size -= (*block & mask) != 0;
+    *block &= ~mask;
+    if (set->index != NULL) {
+        indexTouch(set, (size_t)element / 64, (size_t)element / 64 + 1);
+    } else {
+        wordsTouch(set, (size_t)element / 64, (size_t)element / 64 + 1);
+    }
+    if (set->summary != NULL) {
+        summaryMark(set->summary, (size_t)element / 64, *block != 0);
     }
 }
 
 void bitsetRemoveMany(BitSet* set, int* array, int elementsCount) {
-    for (int iter = 0; iter < elementsCount; iter++) {
-        bitsetRemove(set, array[iter]);
-    }
+    STATS_BEGIN();
+    bitsetApplyMany(set, array, elementsCount, false);
+    STATS_END(STATS_BITSET_REMOVE_MANY);
 }
 
 bool bitsetContains(BitSet* set, int element) {
+    STATS_BEGIN();
     bool isContains = true;
 
     if (element < 0 || set->capacity < (size_t)element) {
         isContains = false;
     } else {
-        int arrayBlock = element / 64;
-        int elementBit = element % 64;
-        isContains = (set->bits[arrayBlock] >> (63 - elementBit)) & 1;
+        isContains =
+            (bitsetBlocks(set)[element / 64] & bitsetElementMask(element)) != 0;
     }
 
+    STATS_END(STATS_BITSET_CONTAINS);
     return isContains;
 }
 
+/*
+ * Пакетная проверка: границы пачки проверяются один раз по минимуму и
+ * максимуму, после чего слова выбираются с предвыборкой (и инструкциями
+ * gather, где они есть). Пачка с элементами за границами проверяется
+ * поэлементно, такие элементы отсутствуют.
+ */
+static void bitsetContainsPacked(BitSet* set, const int* ids, size_t count,
+                                 uint64_t* out) {
+    uint64_t* bits    = bitsetBlocks(set);
+    int       minimum = ids[0];
+    int       maximum = ids[0];
+
+    for (size_t iter = 1; iter < count; iter++) {
+        minimum = ids[iter] < minimum ? ids[iter] : minimum;
+        maximum = ids[iter] > maximum ? ids[iter] : maximum;
+    }
+
+    if (bits != NULL && minimum >= 0 && (size_t)maximum <= set->capacity) {
+        gatherBits(bits, ids, count, out);
+    } else {
+        memset(out, 0, (count + 63) / 64 * sizeof(uint64_t));
+        for (size_t iter = 0; iter < count; iter++) {
+            out[iter / 64] |= (uint64_t)bitsetContains(set, ids[iter])
+                              << (iter % 64);
+        }
+    }
+}
+
+void bitsetContainsMany(BitSet* set, int* ids, int elementsCount,
+                        bool* out) {
+    STATS_BEGIN();
+    uint64_t packed[BITSET_BATCH_WORDS];
+    size_t   count = elementsCount > 0 ? (size_t)elementsCount : 0;
+
+    // Ответы распаковываются порциями, чтобы не выделять память
+    for (size_t start = 0; start < count; start += BITSET_BATCH_WORDS * 64) {
+        size_t batch = count - start < BITSET_BATCH_WORDS * 64
+                           ? count - start : BITSET_BATCH_WORDS * 64;
+
+        bitsetContainsPacked(set, ids + start, batch, packed);
+        for (size_t iter = 0; iter < batch; iter++) {
+            out[start + iter] = (packed[iter / 64] >> (iter % 64)) & 1;
+        }
+    }
+
+    STATS_END(STATS_BITSET_CONTAINS_MANY);
+}
+
+void bitsetContainsManyPacked(BitSet* set, int* ids, int elementsCount,
+                              uint64_t* out) {
+    STATS_BEGIN();
+    if (elementsCount > 0) {
+        bitsetContainsPacked(set, ids, (size_t)elementsCount, out);
+    }
+    STATS_END(STATS_BITSET_CONTAINS_MANY);
+}
+
+bool bitsetContainsUnchecked(BitSet* set, int element) {
+    return (bitsetBlocks(set)[element / 64] & bitsetElementMask(element)) != 0;
+}
+
 void bitsetDestroy(BitSet* set) {
-    free(set->bits);
+    STATS_BEGIN();
+    bitsetIndexDestroy(set);
+    bitsetSummaryDestroy(set);
+    if (bitsetBlocks(set) != NULL) {
+        STATS_MEMORY(-1, -(int64_t)heapBytes(set));
+    }
+    allocatorRelease(set->allocator, set->bits,
+                     set->blockCount * sizeof(uint64_t));
     set->bits = NULL;
     set->blockCount = 0;
     set->capacity = 0;
     set->size = 0;
+    STATS_END(STATS_BITSET_DESTROY);
+}
+
+static void countTask(size_t fromBlock, size_t toBlock, size_t part,
+                      void* context) {
+    BitsetTask* task = (BitsetTask*)context;
+    task->partial[part] = popcountBlocks(bitsetBlocks(task->setA) + fromBlock,
+                                         toBlock - fromBlock);
 }
 
 size_t findSetSize(BitSet* set) {
-    size_t counter = 0;
-    for (size_t block = 0; block < set->blockCount; block++) {
-        for (int8_t iter = 0; iter < 64; iter++) {
-            int8_t bit = ((set->bits[block] >> (64 - iter)) & 1);
-            counter += (size_t)bit;
+    STATS_BEGIN();
+    size_t size = 0;
+
+    if (set->summary != NULL) {
+        uint64_t* bits = bitsetBlocks(set);
+
+        for (size_t block = bitsetNextBlock(set, 0); block < set->blockCount;
+             block = bitsetNextBlock(set, block + 1)) {
+            size += (size_t)__builtin_popcountll(bits[block]);
         }
+    } else {
+        BitsetTask task;
+        task.setA = set;
+
+        size_t parts = parallelFor(set->blockCount, countTask, &task);
+        size = bitsetTaskTotal(&task, parts);
     }
-    
-    return counter;
+
+    STATS_END(STATS_FIND_SET_SIZE);
+    return size;
 }
 
-bool setsIsEqual(BitSet* setA, BitSet* setB) {
-    bool isEqual = (setA->size == setB->size);
+size_t bitsetCountBlocks(BitSet* set, size_t fromBlock, size_t toBlock) {
+    size_t counter = 0;
 
-    for (size_t block = 0; block < setA->blockCount && isEqual; block++) {
-        if (setA->bits[block] != setB->bits[block]) {
-            isEqual = false;
-        }
+    if (toBlock > set->blockCount) {
+        toBlock = set->blockCount;
+    }
+    if (fromBlock < toBlock) {
+        counter = popcountBlocks(bitsetBlocks(set) + fromBlock,
+                                 toBlock - fromBlock);
     }
 
-    return isEqual;
+    return counter;
 }
 
-bool setIsSubset(BitSet* setA, BitSet* setB) {
-    bool isSubset = true;
+// Маска допустимых битов последнего блока (элементы до capacity включительно)
+uint64_t bitsetLastBlockMask(size_t capacity) {
+    return ~(uint64_t)0 >> (63 - capacity % 64);
+}
+
+// Бит элемента внутри его блока: элемент k блока хранится в бите k
+uint64_t bitsetElementMask(size_t element) {
+    return (uint64_t)1 << (element % 64);
+}
+
+// Диапазон [lo, hi) лежит в пределах 0..capacity
+static bool rangeIsValid(BitSet* set, int lo, int hi) {
+    return bitsetBlocks(set) != NULL && lo >= 0 && lo <= hi &&
+           (size_t)hi <= set->capacity + 1;
+}
 
-    for (size_t iter = 0; iter < setA->capacity && isSubset; iter++) {
-        bool numberInA = setA->bits[iter / 64] >> (iter) & 1;
-        bool numberInB = setB->bits[iter / 64] >> (iter) & 1;
-        if ((numberInA & numberInB) != numberInA) {
-            isSubset = false;
+size_t bitsetCountRange(BitSet* set, int lo, int hi) {
+    size_t counter = 0;
+
+    if (rangeIsValid(set, lo, hi) && lo < hi) {
+        uint64_t* bits      = bitsetBlocks(set);
+        size_t    first     = (size_t)lo / 64;
+        size_t    last      = (size_t)(hi - 1) / 64;
+        uint64_t  firstMask = ~(uint64_t)0 << (lo % 64);
+        uint64_t  lastMask  = ~(uint64_t)0 >> (63 - (hi - 1) % 64);
+
+        if (first == last) {
+            counter = (size_t)__builtin_popcountll(bits[first] & firstMask &
+                                                   lastMask);
+        } else {
+            counter = (size_t)__builtin_popcountll(bits[first] & firstMask) +
+                      popcountBlocks(bits + first + 1, last - first - 1) +
+                      (size_t)__builtin_popcountll(bits[last] & lastMask);
         }
     }
 
-    return isSubset;
+    return counter;
 }
 
-bool setIsStrictSubset(BitSet* setA, BitSet* setB) {
-    bool isStrictSubset = setIsSubset(setA, setB) && (setA->size < setB->size);
+bool bitsetContainsRange(BitSet* set, int lo, int hi) {
+    bool isContains = rangeIsValid(set, lo, hi);
 
-    return isStrictSubset;
+    if (isContains && lo < hi) {
+        uint64_t* bits      = bitsetBlocks(set);
+        size_t    first     = (size_t)lo / 64;
+        size_t    last      = (size_t)(hi - 1) / 64;
+        uint64_t  firstMask = ~(uint64_t)0 << (lo % 64);
+        uint64_t  lastMask  = ~(uint64_t)0 >> (63 - (hi - 1) % 64);
+
+        if (first == last) {
+            firstMask &= lastMask;
+            isContains = (bits[first] & firstMask) == firstMask;
+        } else {
+            isContains = (bits[first] & firstMask) == firstMask &&
+                         (bits[last] & lastMask) == lastMask;
+            for (size_t block = first + 1; block < last && isContains;
+                 block++) {
+                isContains = bits[block] == ~(uint64_t)0;
+            }
+        }
+    }
+
+    return isContains;
 }
 
-BitSet getSetsUnion(BitSet* setA, BitSet* setB) {
-    int maxCapacity = setB->capacity;
-    if (setA->capacity > setB->capacity) {
-        maxCapacity = setA->capacity;
+static void applyRangeMask(uint64_t* word, uint64_t mask,
+                           RangeOperation operation) {
+    if (operation == RANGE_ADD) {
+        *word |= mask;
+    } else if (operation == RANGE_REMOVE) {
+        *word &= ~mask;
+    } else {
+        *word ^= mask;
     }
+}
 
-    BitSet setC = bitsetCreate(maxCapacity);
+/*
+ * Крайние блоки диапазона изменяются по маске, внутренние заполняются
+ * целиком. Размер пересчитывается по числу элементов диапазона до изменения.
+ */
+static int bitsetModifyRange(BitSet* set, int lo, int hi,
+                             RangeOperation operation) {
+    STATS_BEGIN();
+    int status_code = rangeIsValid(set, lo, hi) ? 0 : -1;
 
-    for (size_t block = 0; block < setC.blockCount; block++) {
-        setC.bits[block] = setA->bits[block] | setB->bits[block];
+    if (status_code == 0 && lo < hi) {
+        uint64_t* bits      = bitsetBlocks(set);
+        size_t    before    = bitsetCountRange(set, lo, hi);
+        size_t    length    = (size_t)(hi - lo);
+        size_t    first     = (size_t)lo / 64;
+        size_t    last      = (size_t)(hi - 1) / 64;
+        uint64_t  firstMask = ~(uint64_t)0 << (lo % 64);
+        uint64_t  lastMask  = ~(uint64_t)0 >> (63 - (hi - 1) % 64);
+
+        if (first == last) {
+            applyRangeMask(&bits[first], firstMask & lastMask, operation);
+        } else {
+            applyRangeMask(&bits[first], firstMask, operation);
+            if (operation == RANGE_FLIP) {
+                for (size_t block = first + 1; block < last; block++) {
+                    bits[block] = ~bits[block];
+                }
+            } else if (last > first + 1) {
+                memset(bits + first + 1, operation == RANGE_ADD ? 0xFF : 0,
+                       (last - first - 1) * sizeof(uint64_t));
+            }
+            applyRangeMask(&bits[last], lastMask, operation);
+        }
+        bitsetTouch(set, first, last + 1);
+
+        if (operation == RANGE_ADD) {
+            set->size += length - before;
+        } else if (operation == RANGE_REMOVE) {
+            set->size -= before;
+        } else {
+            set->size = set->size - before + (length - before);
+        }
     }
-    setC.size = findSetSize(&setC);
 
-    return setC;
+    STATS_END(STATS_BITSET_RANGE);
+    return status_code;
 }
 
-BitSet getSetsIntersection(BitSet* setA, BitSet* setB) {
-    int maxCapacity = setB->capacity;
-    if (setA->capacity > setB->capacity) {
-        maxCapacity = setA->capacity;
+int bitsetAddRange(BitSet* set, int lo, int hi) {
+    if (lo >= 0 && lo < hi) {
+        bitsetGrowTo(set, hi - 1);
     }
+    return bitsetModifyRange(set, lo, hi, RANGE_ADD);
+}
 
-    BitSet setC = bitsetCreate(maxCapacity);
+int bitsetRemoveRange(BitSet* set, int lo, int hi) {
+    return bitsetModifyRange(set, lo, hi, RANGE_REMOVE);
+}
+
+int bitsetFlipRange(BitSet* set, int lo, int hi) {
+    return bitsetModifyRange(set, lo, hi, RANGE_FLIP);
+}
 
-    for (size_t block = 0; block < setC.blockCount; block++) {
-        setC.bits[block] = setA->bits[block] & setB->bits[block];
+// Пересчёт суммы по блокам суперблока; возвращает число его элементов
+static uint64_t indexCountSuper(BitSet* set, size_t super) {
+    BitsetIndex* index = set->index;
+    uint64_t*    bits  = bitsetBlocks(set);
+    uint64_t     count = 0;
+    size_t       start = super * INDEX_SUPER_WORDS;
+    size_t       end   = start + INDEX_SUPER_WORDS;
+    if (end > set->blockCount) {
+        end = set->blockCount;
     }
-    setC.size = findSetSize(&setC);
 
-    return setC;
+    for (size_t block = start; block < end; block += INDEX_BLOCK_WORDS) {
+        size_t blockEnd = block + INDEX_BLOCK_WORDS;
+        if (blockEnd > end) {
+            blockEnd = end;
+        }
+        index->blockCounts[block / INDEX_BLOCK_WORDS] = (uint16_t)count;
+        count += popcountBlocks(bits + block, blockEnd - block);
+    }
+
+    return count;
 }
 
-BitSet getSetsDifference(BitSet* setA, BitSet* setB) {
-    BitSet setC = bitsetCreate(setA->capacity);
-    for (size_t block = 0; block < setC.blockCount; block++) {
-        setC.bits[block] = setA->bits[block] & (~setB->bits[block]);
+/*
+ * Пересчитывает устаревшие суперблоки; накопленные суммы после них
+ * сдвигаются на изменение числа элементов, без подсчёта их слов.
+ */
+static void indexRefresh(BitSet* set) {
+    BitsetIndex* index = set->index;
+
+    if (index->dirtyFrom < index->dirtyTo) {
+        uint64_t oldEnd = index->superCounts[index->dirtyTo];
+
+        for (size_t super = index->dirtyFrom; super < index->dirtyTo; super++) {
+            index->superCounts[super + 1] =
+                index->superCounts[super] + indexCountSuper(set, super);
+        }
+
+        uint64_t newEnd = index->superCounts[index->dirtyTo];
+        for (size_t super = index->dirtyTo + 1; super <= index->superCount;
+             super++) {
+            index->superCounts[super] = index->superCounts[super] - oldEnd +
+                                        newEnd;
+        }
+
+        index->dirtyFrom = 0;
+        index->dirtyTo = 0;
     }
-    setC.size = findSetSize(&setC);
-    return setC;
 }
 
-BitSet getSetsSymmetricDifference(BitSet* setA, BitSet* setB) {
-    int maxCapacity = setB->capacity;
-    if (setA->capacity > setB->capacity) {
-        maxCapacity = setA->capacity;
-    }
+int bitsetIndexBuild(BitSet* set) {
+    int status_code = bitsetBlocks(set) != NULL ? 0 : -1;
 
-    BitSet setC = bitsetCreate(maxCapacity);
+    if (status_code == 0 && set->index == NULL) {
+        Allocator*   allocator = allocatorResolve(set->allocator);
+        size_t       supers    = (set->blockCount + INDEX_SUPER_WORDS - 1) /
+                                 INDEX_SUPER_WORDS;
+        size_t       blocks    = (set->blockCount + INDEX_BLOCK_WORDS - 1) /
+                                 INDEX_BLOCK_WORDS;
+        BitsetIndex* index     = (BitsetIndex*)allocatorAllocate(
+            allocator, sizeof(BitsetIndex));
+
+        if (index != NULL) {
+            index->superCounts = (uint64_t*)allocatorAllocate(
+                allocator, (supers + 1) * sizeof(uint64_t));
+            index->blockCounts = (uint16_t*)allocatorAllocate(
+                allocator, blocks * sizeof(uint16_t));
+            index->superCount = supers;
+            index->blockCount = blocks;
+        }
 
-    for (size_t block = 0; block < setC.blockCount; block++) {
-        setC.bits[block] = setA->bits[block] ^ setB->bits[block];
+        set->index = index;
+        if (index == NULL || index->superCounts == NULL ||
+            index->blockCounts == NULL) {
+            bitsetIndexDestroy(set);
+            status_code = memoryIsAllocated(NULL);
+        }
     }
-    setC.size = findSetSize(&setC);
 
-    return setC;
+    if (status_code == 0) {
+        set->index->dirtyFrom = 0;
+        set->index->dirtyTo = set->index->superCount;
+        set->index->superCounts[0] = 0;
+        for (size_t super = 1; super <= set->index->superCount; super++) {
+            set->index->superCounts[super] = 0;
+        }
+        indexRefresh(set);
+    }
+
+    return status_code;
 }
 
-BitSet getComplementSet(BitSet* setA) {
-    BitSet set = bitsetCreate(setA->capacity);
-    set.size = setA->capacity - setA->size;
+void bitsetIndexDestroy(BitSet* set) {
+    BitsetIndex* index = set->index;
 
-    for (size_t block = 0; block < set.blockCount; block++) {
-        set.bits[block] = ~setA->bits[block];
+    if (index != NULL) {
+        Allocator* allocator = allocatorResolve(set->allocator);
+        allocatorRelease(allocator, index->superCounts,
+                         (index->superCount + 1) * sizeof(uint64_t));
+        allocatorRelease(allocator, index->blockCounts,
+                         index->blockCount * sizeof(uint16_t));
+        allocatorRelease(allocator, index, sizeof(BitsetIndex));
+        set->index = NULL;
     }
+}
+
+size_t bitsetRank(BitSet* set, size_t x) {
+    size_t rank = set->size;
 
-    int excessBits = set.capacity % 64;
-    uint64_t mask = ~(((uint64_t)1 << (64 - excessBits - 1)) - 1);
-    set.bits[set.blockCount - 1] &= mask;
+    if (x <= set->capacity) {
+        uint64_t* bits  = bitsetBlocks(set);
+        size_t    block = x / 64;
+        uint64_t  tail  = bits[block] & ~(~(uint64_t)0 << (x % 64));
+
+        if (set->index != NULL) {
+            size_t blockStart = block / INDEX_BLOCK_WORDS * INDEX_BLOCK_WORDS;
+
+            indexRefresh(set);
+            rank = set->index->superCounts[block / INDEX_SUPER_WORDS] +
+                   set->index->blockCounts[block / INDEX_BLOCK_WORDS] +
+                   popcountBlocks(bits + blockStart, block - blockStart);
+        } else {
+            rank = popcountBlocks(bits, block);
+        }
+        rank += (size_t)__builtin_popcountll(tail);
+    }
+
+    return rank;
+}
+
+// Позиция k-го (с нуля) единичного бита слова
+static unsigned selectInWord(uint64_t word, unsigned k) {
+    unsigned offset = 0;
+    unsigned count  = (unsigned)__builtin_popcountll(word & 0xFF);
+
+    while (k >= count) {
+        k -= count;
+        word >>= 8;
+        offset += 8;
+        count = (unsigned)__builtin_popcountll(word & 0xFF);
+    }
+    for (; k > 0; k--) {
+        word &= word - 1;
+    }
+
+    return offset + (unsigned)__builtin_ctzll(word);
+}
+
+int bitsetSelect(BitSet* set, size_t k) {
+    int element = -1;
+
+    if (k < set->size) {
+        uint64_t* bits  = bitsetBlocks(set);
+        size_t    block = 0;
+
+        if (set->index != NULL) {
+            BitsetIndex* index = set->index;
+            size_t       lo    = 0;
+            size_t       hi    = index->superCount;
+
+            indexRefresh(set);
+            // Последний суперблок, перед которым не больше k элементов
+            while (hi - lo > 1) {
+                size_t middle = lo + (hi - lo) / 2;
+                if (index->superCounts[middle] <= k) {
+                    lo = middle;
+                } else {
+                    hi = middle;
+                }
+            }
+            k -= index->superCounts[lo];
+
+            size_t first = lo * (INDEX_SUPER_WORDS / INDEX_BLOCK_WORDS);
+            size_t last  = first + INDEX_SUPER_WORDS / INDEX_BLOCK_WORDS;
+            if (last > index->blockCount) {
+                last = index->blockCount;
+            }
+            size_t inner = first;
+            while (inner + 1 < last && index->blockCounts[inner + 1] <= k) {
+                inner++;
+            }
+            k -= index->blockCounts[inner];
+            block = inner * INDEX_BLOCK_WORDS;
+        }
+
+        size_t count = (size_t)__builtin_popcountll(bits[block]);
+        while (k >= count) {
+            k -= count;
+            block++;
+            count = (size_t)__builtin_popcountll(bits[block]);
+        }
+        element = (int)(block * 64 + selectInWord(bits[block], (unsigned)k));
+    }
+
+    return element;
+}
+
+int bitsetMin(BitSet* set) {
+    int element = -1;
+    if (set->index != NULL) {
+        element = bitsetSelect(set, 0);
+    } else if (bitsetBlocks(set) != NULL) {
+        element = bitsetNextSet(set, 0);
+    }
+    return element;
+}
+
+int bitsetMax(BitSet* set) {
+    int element = -1;
+    if (set->index != NULL) {
+        element = set->size > 0 ? bitsetSelect(set, set->size - 1) : -1;
+    } else if (bitsetBlocks(set) != NULL) {
+        element = bitsetPrevSet(set, (int)set->capacity);
+    }
+    return element;
+}
+
+int bitsetSummaryBuild(BitSet* set) {
+    int status_code = bitsetBlocks(set) != NULL ? 0 : -1;
+
+    if (status_code == 0 && set->summary == NULL) {
+        Allocator*     allocator = allocatorResolve(set->allocator);
+        size_t         words     = (set->blockCount + 63) / 64;
+        size_t         groups    = (words + 63) / 64;
+        BitsetSummary* summary   = (BitsetSummary*)allocatorAllocate(
+            allocator, sizeof(BitsetSummary));
+
+        if (summary != NULL) {
+            summary->words = (uint64_t*)allocatorAllocate(
+                allocator, words * sizeof(uint64_t));
+            summary->groups = (uint64_t*)allocatorAllocate(
+                allocator, groups * sizeof(uint64_t));
+            summary->wordCount = words;
+            summary->groupCount = groups;
+        }
+
+        set->summary = summary;
+        if (summary == NULL || summary->words == NULL ||
+            summary->groups == NULL) {
+            bitsetSummaryDestroy(set);
+            status_code = memoryIsAllocated(NULL);
+        } else if (set->size > 0) {
+            // Память сводки обнулена, пустое множество не просматривается
+            summaryRefresh(set, 0, set->blockCount);
+        }
+    }
+
+    return status_code;
+}
+
+void bitsetSummaryDestroy(BitSet* set) {
+    BitsetSummary* summary = set->summary;
+
+    if (summary != NULL) {
+        Allocator* allocator = allocatorResolve(set->allocator);
+        allocatorRelease(allocator, summary->words,
+                         summary->wordCount * sizeof(uint64_t));
+        allocatorRelease(allocator, summary->groups,
+                         summary->groupCount * sizeof(uint64_t));
+        allocatorRelease(allocator, summary, sizeof(BitsetSummary));
+        set->summary = NULL;
+    }
+}
+
+int bitsetNextSet(BitSet* set, int from) {
+    int element = -1;
+
+    if (from < 0) {
+        from = 0;
+    }
+    if ((size_t)from <= set->capacity) {
+        uint64_t* bits  = bitsetBlocks(set);
+        size_t    block = (size_t)from / 64;
+        uint64_t  word  = bits[block] & (~(uint64_t)0 << (from % 64));
+
+        // Нулевые блоки пропускаются целиком, со сводкой — не читаясь
+        while (word == 0 &&
+               (block = bitsetNextBlock(set, block + 1)) < set->blockCount) {
+            word = bits[block];
+        }
+        if (word != 0) {
+            element = (int)(block * 64 + (size_t)__builtin_ctzll(word));
+        }
+    }
+
+    return element;
+}
+
+int bitsetPrevSet(BitSet* set, int from) {
+    int element = -1;
+
+    if (from >= 0 && set->blockCount > 0) {
+        if ((size_t)from > set->capacity) {
+            from = (int)set->capacity;
+        }
+        uint64_t* bits  = bitsetBlocks(set);
+        size_t    block = (size_t)from / 64;
+        uint64_t  word  = bits[block] & (~(uint64_t)0 >> (63 - from % 64));
+
+        while (word == 0 && block > 0) {
+            block--;
+            if (set->summary != NULL) {
+                block = summaryPrevBlock(set, block);
+            }
+            word = bits[block];
+        }
+        if (word != 0) {
+            element = (int)(block * 64 + 63 - (size_t)__builtin_clzll(word));
+        }
+    }
+
+    return element;
+}
+
+void bitsetForEach(BitSet* set, BitsetVisitor visitor, void* context) {
+    uint64_t* bits = bitsetBlocks(set);
+
+    for (size_t block = bitsetNextBlock(set, 0); block < set->blockCount;
+         block = bitsetNextBlock(set, block + 1)) {
+        uint64_t word = bits[block];
+        while (word != 0) {
+            visitor((int)(block * 64 + (size_t)__builtin_ctzll(word)), context);
+            word &= word - 1;
+        }
+    }
+}
+
+size_t bitsetToArray(BitSet* set, int from, int* output, size_t maxCount) {
+    size_t count = 0;
+
+    if (from < 0) {
+        from = 0;
+    }
+    if ((size_t)from <= set->capacity) {
+        uint64_t* bits  = bitsetBlocks(set);
+        size_t    block = (size_t)from / 64;
+        uint64_t  word  = bits[block] & (~(uint64_t)0 << (from % 64));
+
+        while (count < maxCount) {
+            while (word != 0 && count < maxCount) {
+                output[count++] =
+                    (int)(block * 64 + (size_t)__builtin_ctzll(word));
+                word &= word - 1;
+            }
+            block = bitsetNextBlock(set, block + 1);
+            if (block >= set->blockCount) {
+                break;
+            }
+            word = bits[block];
+        }
+    }
+
+    return count;
+}
+
+// Слово множества; отсутствующие старшие слова считаются нулевыми
+static uint64_t bitsetBlockOrZero(BitSet* set, size_t block) {
+    uint64_t word = 0;
+    if (block < set->blockCount) {
+        word = bitsetBlocks(set)[block];
+    }
+    return word;
+}
+
+/*
+ * Отношение слов двух множеств: общая часть сравнивается векторно, слова
+ * за концом более короткого множества считаются нулевыми. Части
+ * проверяют накопленные признаки между порциями, чтобы остальные
+ * завершились, как только одна из них нашла признак из stopMask.
+ */
+static void relationTask(size_t fromBlock, size_t toBlock, size_t part,
+                         void* context) {
+    BitsetTask* task   = (BitsetTask*)context;
+    uint64_t*   bitsA  = bitsetBlocks(task->setA);
+    uint64_t*   bitsB  = bitsetBlocks(task->setB);
+    size_t      common = task->setA->blockCount < task->setB->blockCount
+                             ? task->setA->blockCount
+                             : task->setB->blockCount;
+    (void)part;
+
+    for (size_t start = fromBlock; start < toBlock &&
+         (atomic_load_explicit(&task->relation, memory_order_relaxed) &
+          task->stopMask) == 0;
+         start += BITSET_CHUNK_BLOCKS) {
+        size_t   end   = start + BITSET_CHUNK_BLOCKS < toBlock
+                             ? start + BITSET_CHUNK_BLOCKS : toBlock;
+        size_t   split = end < common ? end : common;
+        unsigned flags = 0;
+
+        if (start < split) {
+            flags = compareBlocks(bitsA + start, bitsB + start, split - start,
+                                  task->stopMask);
+        }
+        if (split < start) {
+            split = start;
+        }
+        if (split < end && (flags & task->stopMask) == 0) {
+            if (task->setA->blockCount > common &&
+                (task->wantMask & COMPARE_EXTRA_A) != 0 &&
+                compareAnyBits(bitsA + split, end - split)) {
+                flags |= COMPARE_EXTRA_A;
+            } else if (task->setB->blockCount > common &&
+                       (task->wantMask & COMPARE_EXTRA_B) != 0 &&
+                       compareAnyBits(bitsB + split, end - split)) {
+                flags |= COMPARE_EXTRA_B;
+            }
+        }
+        if (flags != 0) {
+            atomic_fetch_or_explicit(&task->relation, flags,
+                                     memory_order_relaxed);
+        }
+    }
+}
+
+/*
+ * Признаки отношения множеств (COMPARE_*) за один проход. wantMask —
+ * нужные вызывающему признаки, stopMask — признаки досрочного выхода.
+ */
+static unsigned bitsetRelation(BitSet* setA, BitSet* setB, unsigned wantMask,
+                               unsigned stopMask) {
+    BitsetTask task;
+    size_t     blockCount = setA->blockCount > setB->blockCount
+                                ? setA->blockCount : setB->blockCount;
+
+    task.setA     = setA;
+    task.setB     = setB;
+    task.wantMask = wantMask;
+    task.stopMask = stopMask;
+    atomic_init(&task.relation, 0u);
+    parallelFor(blockCount, relationTask, &task);
+
+    return atomic_load(&task.relation) & wantMask;
+}
+
+// Слово уровня 2 сводки; отсутствующие слова считаются нулевыми
+static uint64_t summaryGroupOrZero(BitSet* set, size_t group) {
+    uint64_t word = 0;
+    if (group < set->summary->groupCount) {
+        word = set->summary->groups[group];
+    }
+    return word;
+}
+
+// Слово уровня 1 сводки; отсутствующие слова считаются нулевыми
+static uint64_t summaryWordOrZero(BitSet* set, size_t word) {
+    uint64_t bits = 0;
+    if (word < set->summary->wordCount) {
+        bits = set->summary->words[word];
+    }
+    return bits;
+}
+
+/*
+ * Равенство по сводкам: сравниваются уровни сводки сверху вниз, а слова
+ * множеств — только непустые.
+ */
+static bool summaryIsEqual(BitSet* setA, BitSet* setB) {
+    bool      isEqual    = true;
+    uint64_t* bitsA      = bitsetBlocks(setA);
+    uint64_t* bitsB      = bitsetBlocks(setB);
+    size_t    groupCount = setA->summary->groupCount > setB->summary->groupCount
+                            ? setA->summary->groupCount
+                            : setB->summary->groupCount;
+
+    for (size_t group = 0; group < groupCount && isEqual; group++) {
+        uint64_t groupBits = summaryGroupOrZero(setA, group);
+
+        isEqual = groupBits == summaryGroupOrZero(setB, group);
+        while (isEqual && groupBits != 0) {
+            size_t   word  = group * 64 + (size_t)__builtin_ctzll(groupBits);
+            uint64_t words = setA->summary->words[word];
+
+            isEqual = words == setB->summary->words[word];
+            while (isEqual && words != 0) {
+                size_t block = word * 64 + (size_t)__builtin_ctzll(words);
+                isEqual = bitsA[block] == bitsB[block];
+                words &= words - 1;
+            }
+            groupBits &= groupBits - 1;
+        }
+    }
+
+    return isEqual;
+}
+
+bool setsIsEqual(BitSet* setA, BitSet* setB) {
+    STATS_BEGIN();
+    bool isEqual = (setA->size == setB->size);
+
+    if (isEqual && setA->summary != NULL && setB->summary != NULL) {
+        isEqual = summaryIsEqual(setA, setB);
+    } else if (isEqual) {
+        unsigned extra = COMPARE_EXTRA_A | COMPARE_EXTRA_B;
+        isEqual = bitsetRelation(setA, setB, extra, extra) == 0;
+    }
+
+    STATS_END(STATS_SETS_IS_EQUAL);
+    return isEqual;
+}
+
+bool setIsSubset(BitSet* setA, BitSet* setB) {
+    STATS_BEGIN();
+    bool isSubset = setA->size <= setB->size &&
+                    bitsetRelation(setA, setB, COMPARE_EXTRA_A,
+                                   COMPARE_EXTRA_A) == 0;
+
+    STATS_END(STATS_SET_IS_SUBSET);
+    return isSubset;
+}
+
+// Строгость определяется тем же проходом: в B нашлись биты не из A
+bool setIsStrictSubset(BitSet* setA, BitSet* setB) {
+    bool isStrictSubset = false;
+
+    if (setA->size < setB->size) {
+        unsigned relation = bitsetRelation(
+            setA, setB, COMPARE_EXTRA_A | COMPARE_EXTRA_B, COMPARE_EXTRA_A);
+        isStrictSubset = relation == COMPARE_EXTRA_B;
+    }
+
+    return isStrictSubset;
+}
+
+bool setIsSuperset(BitSet* setA, BitSet* setB) {
+    bool isSuperset = setIsSubset(setB, setA);
+
+    return isSuperset;
+}
+
+bool bitsetIntersects(BitSet* setA, BitSet* setB) {
+    bool intersects = setA->size != 0 && setB->size != 0 &&
+                      bitsetRelation(setA, setB, COMPARE_COMMON,
+                                     COMPARE_COMMON) != 0;
+
+    return intersects;
+}
+
+
+static void intersectionCountTask(size_t fromBlock, size_t toBlock,
+                                  size_t part, void* context) {
+    BitsetTask* task  = (BitsetTask*)context;
+    uint64_t*   bitsA = bitsetBlocks(task->setA);
+    uint64_t*   bitsB = bitsetBlocks(task->setB);
+
+    task->partial[part] = popcountAndBlocks(bitsA + fromBlock,
+                                            bitsB + fromBlock,
+                                            toBlock - fromBlock);
+}
+
+// Мощность пересечения по сводкам: читаются только общие непустые слова
+static size_t intersectionSizeSparse(BitSet* setA, BitSet* setB) {
+    size_t    size       = 0;
+    uint64_t* bitsA      = bitsetBlocks(setA);
+    uint64_t* bitsB      = bitsetBlocks(setB);
+    size_t    groupCount = setA->summary->groupCount < setB->summary->groupCount
+                            ? setA->summary->groupCount
+                            : setB->summary->groupCount;
+
+    for (size_t group = 0; group < groupCount; group++) {
+        uint64_t groupBits = setA->summary->groups[group] &
+                             setB->summary->groups[group];
+
+        while (groupBits != 0) {
+            size_t   word  = group * 64 + (size_t)__builtin_ctzll(groupBits);
+            uint64_t words = summaryWordOrZero(setA, word) &
+                             summaryWordOrZero(setB, word);
+
+            while (words != 0) {
+                size_t block = word * 64 + (size_t)__builtin_ctzll(words);
+                size += (size_t)__builtin_popcountll(bitsA[block] &
+                                                     bitsB[block]);
+                words &= words - 1;
+            }
+            groupBits &= groupBits - 1;
+        }
+    }
+
+    return size;
+}
+
+/*
+ * Мощности результатов операций без построения результата: считается
+ * только |A ∩ B|, остальное следует из точных размеров операндов.
+ */
+size_t bitsetIntersectionSize(BitSet* setA, BitSet* setB) {
+    size_t size     = 0;
+    bool   nonEmpty = setA->size != 0 && setB->size != 0;
+
+    if (nonEmpty && setA->summary != NULL && setB->summary != NULL) {
+        size = intersectionSizeSparse(setA, setB);
+    } else if (nonEmpty) {
+        BitsetTask task;
+        size_t     blockCount = setA->blockCount < setB->blockCount
+                                    ? setA->blockCount : setB->blockCount;
+
+        task.setA = setA;
+        task.setB = setB;
+
+        size_t parts = parallelFor(blockCount, intersectionCountTask, &task);
+        size = bitsetTaskTotal(&task, parts);
+    }
+
+    return size;
+}
+
+size_t bitsetUnionSize(BitSet* setA, BitSet* setB) {
+    return setA->size + setB->size - bitsetIntersectionSize(setA, setB);
+}
+
+size_t bitsetDifferenceSize(BitSet* setA, BitSet* setB) {
+    return setA->size - bitsetIntersectionSize(setA, setB);
+}
+
+size_t bitsetSymmetricDifferenceSize(BitSet* setA, BitSet* setB) {
+    return setA->size + setB->size - 2 * bitsetIntersectionSize(setA, setB);
+}
+
+// Сходство по мощностям; два пустых множества считаются совпадающими
+static double similarityRatio(size_t numerator, size_t denominator) {
+    double ratio = 1.0;
+    if (denominator != 0) {
+        ratio = (double)numerator / (double)denominator;
+    }
+    return ratio;
+}
+
+double bitsetJaccard(BitSet* setA, BitSet* setB) {
+    size_t common = bitsetIntersectionSize(setA, setB);
+
+    return similarityRatio(common, setA->size + setB->size - common);
+}
+
+double bitsetDice(BitSet* setA, BitSet* setB) {
+    size_t common = bitsetIntersectionSize(setA, setB);
+
+    return similarityRatio(2 * common, setA->size + setB->size);
+}
+
+size_t bitsetHamming(BitSet* setA, BitSet* setB) {
+    return bitsetSymmetricDifferenceSize(setA, setB);
+}
+
+/*
+ * Мощности пересечения запроса с каждым из count кандидатов. Запрос
+ * обходится порциями из кэша L1, и каждая порция сравнивается со всеми
+ * кандидатами, поэтому слова каждого кандидата читаются один раз.
+ */
+void bitsetIntersectionSizeMany(BitSet* query, BitSet* candidates,
+                                size_t count, size_t* sizes) {
+    uint64_t* bitsQuery = bitsetBlocks(query);
+
+    for (size_t iter = 0; iter < count; iter++) {
+        sizes[iter] = 0;
+    }
+    for (size_t start = 0; start < query->blockCount && query->size != 0;
+         start += BITSET_CHUNK_BLOCKS) {
+        size_t end = start + BITSET_CHUNK_BLOCKS < query->blockCount
+                         ? start + BITSET_CHUNK_BLOCKS : query->blockCount;
+
+        for (size_t iter = 0; iter < count; iter++) {
+            size_t limit = end < candidates[iter].blockCount
+                               ? end : candidates[iter].blockCount;
+
+            if (start < limit) {
+                sizes[iter] += popcountAndBlocks(
+                    bitsQuery + start, bitsetBlocks(&candidates[iter]) + start,
+                    limit - start);
+            }
+        }
+    }
+}
+
+// Кандидаты обрабатываются пачками, чтобы не выделять память под мощности
+void bitsetJaccardMany(BitSet* query, BitSet* candidates, size_t count,
+                       double* scores) {
+    for (size_t start = 0; start < count; start += BITSET_BATCH_CANDIDATES) {
+        size_t sizes[BITSET_BATCH_CANDIDATES];
+        size_t batch = count - start < BITSET_BATCH_CANDIDATES
+                           ? count - start : BITSET_BATCH_CANDIDATES;
+
+        bitsetIntersectionSizeMany(query, candidates + start, batch, sizes);
+        for (size_t iter = 0; iter < batch; iter++) {
+            size_t common = sizes[iter];
+            scores[start + iter] = similarityRatio(
+                common, query->size + candidates[start + iter].size - common);
+        }
+    }
+}
+
+
+static uint64_t applyOperation(SetOperation operation, uint64_t a, uint64_t b) {
+    uint64_t word = 0;
+
+    switch (operation) {
+        case SET_UNION:
+            word = a | b;
+            break;
+        case SET_INTERSECTION:
+            word = a & b;
+            break;
+        case SET_DIFFERENCE:
+            word = a & ~b;
+            break;
+        case SET_SYMMETRIC_DIFFERENCE:
+            word = a ^ b;
+            break;
+    }
+
+    return word;
+}
+
+static void operationOnRange(SetOperation operation, uint64_t* result,
+                             const uint64_t* a, const uint64_t* b,
+                             size_t count) {
+    switch (operation) {
+        case SET_UNION:
+            for (size_t block = 0; block < count; block++) {
+                result[block] = a[block] | b[block];
+            }
+            break;
+        case SET_INTERSECTION:
+            for (size_t block = 0; block < count; block++) {
+                result[block] = a[block] & b[block];
+            }
+            break;
+        case SET_DIFFERENCE:
+            for (size_t block = 0; block < count; block++) {
+                result[block] = a[block] & ~b[block];
+            }
+            break;
+        case SET_SYMMETRIC_DIFFERENCE:
+            for (size_t block = 0; block < count; block++) {
+                result[block] = a[block] ^ b[block];
+            }
+            break;
+    }
+}
+
+/*
+ * Вычисляет результат операции порциями по BITSET_CHUNK_BLOCKS слов и
+ * подсчитывает размер порции, пока она находится в кэше. result может
+ * совпадать с setA или setB.
+ */
+static void operationTask(size_t fromBlock, size_t toBlock, size_t part,
+                          void* context) {
+    BitsetTask* task   = (BitsetTask*)context;
+    uint64_t*   bits   = bitsetBlocks(task->result);
+    uint64_t*   bitsA  = bitsetBlocks(task->setA);
+    uint64_t*   bitsB  = bitsetBlocks(task->setB);
+
+    size_t commonBlocks = task->setA->blockCount;
+    if (task->setB->blockCount < commonBlocks) {
+        commonBlocks = task->setB->blockCount;
+    }
+
+    size_t size = 0;
+    for (size_t start = fromBlock; start < toBlock;
+         start += BITSET_CHUNK_BLOCKS) {
+        size_t end = start + BITSET_CHUNK_BLOCKS;
+        if (end > toBlock) {
+            end = toBlock;
+        }
+
+        size_t common = end < commonBlocks ? end : commonBlocks;
+        if (start < common) {
+            operationOnRange(task->operation, bits + start, bitsA + start,
+                             bitsB + start, common - start);
+        }
+        for (size_t block = common > start ? common : start; block < end;
+             block++) {
+            bits[block] = applyOperation(
+                task->operation, bitsetBlockOrZero(task->setA, block),
+                bitsetBlockOrZero(task->setB, block));
+        }
+
+        size += popcountBlocks(bits + start, end - start);
+    }
+
+    task->partial[part] = size;
+}
+
+// Непустые слова результата по непустым словам операндов
+static uint64_t summaryOperation(SetOperation operation, uint64_t a,
+                                 uint64_t b) {
+    uint64_t bits = a | b;
+    if (operation == SET_INTERSECTION) {
+        bits = a & b;
+    } else if (operation == SET_DIFFERENCE) {
+        bits = a;
+    }
+    return bits;
+}
+
+/*
+ * Операция по сводкам: вычисляются только слова, которые непусты в
+ * операндах (с учётом операции) или в прежнем результате; остальные слова
+ * результата и так нулевые. Сводка результата перестраивается по ходу.
+ * Возвращает размер результата.
+ */
+static size_t operationSparse(SetOperation operation, BitSet* result,
+                              BitSet* setA, BitSet* setB) {
+    BitsetSummary* summary = result->summary;
+    uint64_t*      bits    = bitsetBlocks(result);
+    size_t         size    = 0;
+
+    for (size_t group = 0; group < summary->groupCount; group++) {
+        uint64_t groupBits = summaryOperation(
+            operation, summaryGroupOrZero(setA, group),
+            setB->summary != NULL ? summaryGroupOrZero(setB, group) : 0);
+        uint64_t newGroups = 0;
+
+        groupBits = (groupBits | summary->groups[group]) &
+                    lowBitsMask(summary->wordCount - group * 64);
+        while (groupBits != 0) {
+            size_t   word      = group * 64 + (size_t)__builtin_ctzll(groupBits);
+            uint64_t words     = summaryOperation(
+                operation, summaryWordOrZero(setA, word),
+                setB->summary != NULL ? summaryWordOrZero(setB, word) : 0);
+            uint64_t newWords  = 0;
+
+            words = (words | summary->words[word]) &
+                    lowBitsMask(result->blockCount - word * 64);
+            while (words != 0) {
+                size_t   block = word * 64 + (size_t)__builtin_ctzll(words);
+                uint64_t value = applyOperation(
+                    operation, bitsetBlockOrZero(setA, block),
+                    bitsetBlockOrZero(setB, block));
+
+                bits[block] = value;
+                newWords |= (uint64_t)(value != 0) << (block % 64);
+                size += (size_t)__builtin_popcountll(value);
+                words &= words - 1;
+            }
+
+            summary->words[word] = newWords;
+            newGroups |= (uint64_t)(newWords != 0) << (word % 64);
+            groupBits &= groupBits - 1;
+        }
+        summary->groups[group] = newGroups;
+    }
+
+    return size;
+}
+
+static void bitsetOperationInto(SetOperation operation, BitSet* result,
+                                BitSet* setA, BitSet* setB) {
+    // Разности достаточно сводки уменьшаемого
+    bool sparse = result->summary != NULL && setA->summary != NULL &&
+                  (setB->summary != NULL || operation == SET_DIFFERENCE);
+
+    if (sparse) {
+        result->size = operationSparse(operation, result, setA, setB);
+        indexTouch(result, 0, result->blockCount);
+    } else {
+        BitsetTask task;
+
+        task.operation = operation;
+        task.result = result;
+        task.setA = setA;
+        task.setB = setB;
+
+        size_t parts = 1;
+
+        // Малые множества вычисляются на месте, без пула потоков
+        if (result->blockCount <= BITSET_INLINE_WORDS) {
+            operationTask(0, result->blockCount, 0, &task);
+        } else {
+            parts = parallelFor(result->blockCount, operationTask, &task);
+        }
+
+        bitsetTouch(result, 0, result->blockCount);
+        result->size = bitsetTaskTotal(&task, parts);
+    }
+}
+
+static size_t maxCapacity(BitSet* setA, BitSet* setB) {
+    size_t capacity = setB->capacity;
+    if (setA->capacity > setB->capacity) {
+        capacity = setA->capacity;
+    }
+    return capacity;
+}
+
+static int resultCanHold(BitSet* result, size_t capacity) {
+    int status_code = 0;
+    if (result->growable && result->capacity < capacity) {
+        bitsetReserve(result, capacity);
+    }
+    if (bitsetBlocks(result) == NULL || result->capacity < capacity) {
+        status_code = -1;
+    }
+    return status_code;
+}
+
+int getSetsUnionInto(BitSet* result, BitSet* setA, BitSet* setB) {
+    STATS_BEGIN();
+    int status_code = resultCanHold(result, maxCapacity(setA, setB));
+    if (status_code == 0) {
+        bitsetOperationInto(SET_UNION, result, setA, setB);
+    }
+    STATS_END(STATS_SETS_UNION);
+    return status_code;
+}
+
+int getSetsIntersectionInto(BitSet* result, BitSet* setA, BitSet* setB) {
+    STATS_BEGIN();
+    size_t minCapacity = setA->capacity;
+    if (setB->capacity < minCapacity) {
+        minCapacity = setB->capacity;
+    }
+
+    int status_code = resultCanHold(result, minCapacity);
+    if (status_code == 0) {
+        bitsetOperationInto(SET_INTERSECTION, result, setA, setB);
+    }
+    STATS_END(STATS_SETS_INTERSECTION);
+    return status_code;
+}
+
+int getSetsDifferenceInto(BitSet* result, BitSet* setA, BitSet* setB) {
+    STATS_BEGIN();
+    int status_code = resultCanHold(result, setA->capacity);
+    if (status_code == 0) {
+        bitsetOperationInto(SET_DIFFERENCE, result, setA, setB);
+    }
+    STATS_END(STATS_SETS_DIFFERENCE);
+    return status_code;
+}
+
+int getSetsSymmetricDifferenceInto(BitSet* result, BitSet* setA,
+                                   BitSet* setB) {
+    STATS_BEGIN();
+    int status_code = resultCanHold(result, maxCapacity(setA, setB));
+    if (status_code == 0) {
+        bitsetOperationInto(SET_SYMMETRIC_DIFFERENCE, result, setA, setB);
+    }
+    STATS_END(STATS_SETS_SYMMETRIC_DIFFERENCE);
+    return status_code;
+}
+
+static void complementTask(size_t fromBlock, size_t toBlock, size_t part,
+                           void* context) {
+    BitsetTask* task   = (BitsetTask*)context;
+    BitSet*     setA   = task->setA;
+    uint64_t*   bits   = bitsetBlocks(task->result);
+    uint64_t*   bitsA  = bitsetBlocks(setA);
+    size_t      last   = setA->blockCount - 1;
+    size_t      size   = 0;
+
+    for (size_t start = fromBlock; start < toBlock;
+         start += BITSET_CHUNK_BLOCKS) {
+        size_t end = start + BITSET_CHUNK_BLOCKS;
+        if (end > toBlock) {
+            end = toBlock;
+        }
+
+        for (size_t block = start; block < end; block++) {
+            if (block < last) {
+                bits[block] = ~bitsA[block];
+            } else if (block == last) {
+                bits[block] =
+                    ~bitsA[block] & bitsetLastBlockMask(setA->capacity);
+            } else {
+                bits[block] = 0;
+            }
+        }
+
+        size += popcountBlocks(bits + start, end - start);
+    }
+
+    task->partial[part] = size;
+}
+
+int getComplementSetInto(BitSet* result, BitSet* setA) {
+    STATS_BEGIN();
+    int status_code = resultCanHold(result, setA->capacity);
+    if (bitsetBlocks(setA) == NULL) {
+        status_code = -1;
+    }
+
+    if (status_code == 0) {
+        BitsetTask task;
+
+        task.result = result;
+        task.setA = setA;
+
+        size_t parts = parallelFor(result->blockCount, complementTask, &task);
+
+        bitsetTouch(result, 0, result->blockCount);
+        result->size = bitsetTaskTotal(&task, parts);
+    }
+
+    STATS_END(STATS_COMPLEMENT_SET);
+    return status_code;
+}
+
+int bitsetUnionInPlace(BitSet* setA, BitSet* setB) {
+    return getSetsUnionInto(setA, setA, setB);
+}
+
+int bitsetIntersectionInPlace(BitSet* setA, BitSet* setB) {
+    return getSetsIntersectionInto(setA, setA, setB);
+}
+
+int bitsetDifferenceInPlace(BitSet* setA, BitSet* setB) {
+    return getSetsDifferenceInto(setA, setA, setB);
+}
+
+int bitsetSymmetricDifferenceInPlace(BitSet* setA, BitSet* setB) {
+    return getSetsSymmetricDifferenceInto(setA, setA, setB);
+}
+
+int bitsetComplementInPlace(BitSet* setA) {
+    return getComplementSetInto(setA, setA);
+}
+
+/*
+ * Объединение и пересечение массива множеств за один проход: порция
+ * результата остаётся в L1, пока к ней по очереди применяются все входы.
+ * Пересечение бросает порцию, как только она обнулилась.
+ */
+static void manyTask(size_t fromBlock, size_t toBlock, size_t part,
+                     void* context) {
+    BitsetTask* task = (BitsetTask*)context;
+    uint64_t*   bits = bitsetBlocks(task->result);
+    size_t      size = 0;
+
+    for (size_t start = fromBlock; start < toBlock;
+         start += BITSET_CHUNK_BLOCKS) {
+        size_t end = start + BITSET_CHUNK_BLOCKS < toBlock
+                         ? start + BITSET_CHUNK_BLOCKS : toBlock;
+
+        for (size_t iter = 0; iter < task->setsCount; iter++) {
+            BitSet*   set   = task->sets[iter];
+            uint64_t* input = bitsetBlocks(set);
+            size_t    limit = end < set->blockCount ? end : set->blockCount;
+            size_t    tail  = limit > start ? limit : start;
+
+            if (iter == 0 && start < limit && input != bits) {
+                memcpy(bits + start, input + start,
+                       (limit - start) * sizeof(uint64_t));
+            } else if (iter != 0 && start < limit) {
+                operationOnRange(task->operation, bits + start, bits + start,
+                                 input + start, limit - start);
+            }
+            // Недостающие слова входа нулевые
+            if (iter == 0 || task->operation == SET_INTERSECTION) {
+                memset(bits + tail, 0, (end - tail) * sizeof(uint64_t));
+            }
+            if (task->operation == SET_INTERSECTION &&
+                !compareAnyBits(bits + start, end - start)) {
+                break;
+            }
+        }
+
+        size += popcountBlocks(bits + start, end - start);
+    }
+
+    task->partial[part] = size;
+}
+
+// Маски битов порции, счётчик которых в разрядных срезах не меньше
+// threshold; срезы обходятся от старшего разряда к младшему. Циклы
+// всегда проходят порцию целиком, чтобы компилятор их векторизовал
+static void counterAtLeast(
+    uint64_t planes[BITSET_COUNTER_PLANES][BITSET_THRESHOLD_BLOCKS],
+    size_t planeCount, size_t threshold,
+    uint64_t masks[BITSET_THRESHOLD_BLOCKS]) {
+    uint64_t equal[BITSET_THRESHOLD_BLOCKS];
+
+    for (size_t word = 0; word < BITSET_THRESHOLD_BLOCKS; word++) {
+        masks[word] = 0;
+        equal[word] = ~(uint64_t)0;
+    }
+    for (size_t plane = planeCount; plane-- > 0;) {
+        if ((threshold >> plane) & 1) {
+            for (size_t word = 0; word < BITSET_THRESHOLD_BLOCKS; word++) {
+                equal[word] &= planes[plane][word];
+            }
+        } else {
+            for (size_t word = 0; word < BITSET_THRESHOLD_BLOCKS; word++) {
+                masks[word] |= equal[word] & planes[plane][word];
+                equal[word] &= ~planes[plane][word];
+            }
+        }
+    }
+    for (size_t word = 0; word < BITSET_THRESHOLD_BLOCKS; word++) {
+        masks[word] |= equal[word];
+    }
+}
+
+// Прибавление слов входа к счётчикам порции с переносом по срезам
+static void counterAdd(
+    uint64_t planes[BITSET_COUNTER_PLANES][BITSET_THRESHOLD_BLOCKS],
+    size_t planeCount, uint64_t carry[BITSET_THRESHOLD_BLOCKS]) {
+    uint64_t carries = 1;
+
+    for (size_t plane = 0; plane < planeCount && carries != 0; plane++) {
+        carries = 0;
+        for (size_t word = 0; word < BITSET_THRESHOLD_BLOCKS; word++) {
+            uint64_t next = planes[plane][word] & carry[word];
+            planes[plane][word] ^= carry[word];
+            carry[word] = next;
+            carries |= next;
+        }
+    }
+}
+
+/*
+ * Порог по массиву множеств: на каждый бит порции ведётся счётчик в
+ * разрядных срезах (срез p хранит разряд p счётчиков 64 битов слова).
+ * Входы идут от разреженных к плотным; если первые count - threshold + 1
+ * из них не задели порцию, порог в ней недостижим и она бросается.
+ */
+static void thresholdTask(size_t fromBlock, size_t toBlock, size_t part,
+                          void* context) {
+    BitsetTask* task       = (BitsetTask*)context;
+    uint64_t*   bits       = bitsetBlocks(task->result);
+    size_t      planeCount = 0;
+    size_t      size       = 0;
+    uint64_t    planes[BITSET_COUNTER_PLANES][BITSET_THRESHOLD_BLOCKS];
+    uint64_t    carry[BITSET_THRESHOLD_BLOCKS];
+
+    while (planeCount < BITSET_COUNTER_PLANES &&
+           (task->setsCount >> planeCount) != 0) {
+        planeCount++;
+    }
+
+    for (size_t start = fromBlock; start < toBlock;
+         start += BITSET_THRESHOLD_BLOCKS) {
+        size_t end    = start + BITSET_THRESHOLD_BLOCKS < toBlock
+                            ? start + BITSET_THRESHOLD_BLOCKS : toBlock;
+        size_t words  = end - start;
+        bool   pruned = false;
+
+        memset(planes, 0, planeCount * sizeof(planes[0]));
+        for (size_t iter = 0; iter < task->setsCount && !pruned; iter++) {
+            BitSet*   set   = task->sets[iter];
+            uint64_t* input = bitsetBlocks(set);
+            size_t    limit = end < set->blockCount ? end : set->blockCount;
+            size_t    count = limit > start ? limit - start : 0;
+            size_t    rest  = task->setsCount - iter - 1;
+
+            // Недостающие слова входа нулевые
+            memcpy(carry, input + start, count * sizeof(uint64_t));
+            memset(carry + count, 0,
+                   (BITSET_THRESHOLD_BLOCKS - count) * sizeof(uint64_t));
+            counterAdd(planes, planeCount, carry);
+
+            // Когда остаётся threshold - 1 входов, порог могут набрать
+            // только биты, уже встреченные хотя бы раз
+            if (rest + 1 == task->threshold) {
+                pruned = true;
+                for (size_t plane = 0; plane < planeCount && pruned;
+                     plane++) {
+                    pruned = !compareAnyBits(planes[plane], words);
+                }
+            }
+        }
+
+        if (pruned) {
+            memset(bits + start, 0, words * sizeof(uint64_t));
+        } else {
+            counterAtLeast(planes, planeCount, task->threshold, carry);
+            memcpy(bits + start, carry, words * sizeof(uint64_t));
+        }
+        size += popcountBlocks(bits + start, words);
+    }
+
+    task->partial[part] = size;
+}
+
+static int compareSetSizes(const void* left, const void* right) {
+    size_t a = (*(BitSet* const*)left)->size;
+    size_t b = (*(BitSet* const*)right)->size;
+    return (a > b) - (a < b);
+}
+
+/*
+ * Входы по возрастанию мощности, чтобы самое разреженное множество
+ * отсекало слова первым. Результат, совпадающий с одним из входов,
+ * ставится первым: его слова читаются раньше, чем перезаписываются.
+ */
+static void orderBySize(BitSet** order, BitSet* result, BitSet** sets,
+                        size_t count) {
+    memcpy(order, sets, count * sizeof(BitSet*));
+    qsort(order, count, sizeof(BitSet*), compareSetSizes);
+    for (size_t iter = 1; iter < count; iter++) {
+        if (order[iter] == result) {
+            memmove(order + 1, order, iter * sizeof(BitSet*));
+            order[0] = result;
+        }
+    }
+}
+
+// Проверка входов и ёмкости результата операции над массивом множеств
+static int manyCanHold(BitSet* result, BitSet** sets, size_t count,
+                       bool intersection) {
+    int    status_code = count == 0 ? -1 : 0;
+    size_t capacity    = 0;
+
+    for (size_t iter = 0; iter < count && status_code == 0; iter++) {
+        if (bitsetBlocks(sets[iter]) == NULL) {
+            status_code = -1;
+        } else if (iter == 0 || (intersection
+                                     ? sets[iter]->capacity < capacity
+                                     : sets[iter]->capacity > capacity)) {
+            capacity = sets[iter]->capacity;
+        }
+    }
+    if (status_code == 0) {
+        status_code = resultCanHold(result, capacity);
+    }
+
+    return status_code;
+}
+
+static int bitsetManyInto(SetOperation operation, BitSet* result,
+                          BitSet** sets, size_t count, size_t threshold) {
+    bool       intersection = operation == SET_INTERSECTION;
+    int        status_code  = manyCanHold(result, sets, count, intersection);
+    Allocator* allocator    = allocatorResolve(result->allocator);
+    BitSet*    local[BITSET_MANY_STACK_SETS];
+    BitSet**   order        = local;
+
+    if (status_code == 0 && count > BITSET_MANY_STACK_SETS) {
+        order = (BitSet**)allocatorAllocate(allocator,
+                                            count * sizeof(BitSet*));
+        status_code = memoryIsAllocated(order);
+    }
+    if (status_code == 0) {
+        BitsetTask task;
+
+        orderBySize(order, result, sets, count);
+        task.operation = operation;
+        task.result = result;
+        task.sets = order;
+        task.setsCount = count;
+        task.threshold = threshold;
+
+        size_t parts = parallelFor(result->blockCount,
+                                   threshold != 0 ? thresholdTask : manyTask,
+                                   &task);
+
+        bitsetTouch(result, 0, result->blockCount);
+        result->size = bitsetTaskTotal(&task, parts);
+    }
+    if (order != local) {
+        allocatorRelease(allocator, order, count * sizeof(BitSet*));
+    }
+
+    return status_code;
+}
+
+int bitsetUnionManyInto(BitSet* result, BitSet** sets, size_t count) {
+    return bitsetManyInto(SET_UNION, result, sets, count, 0);
+}
+
+int bitsetIntersectionManyInto(BitSet* result, BitSet** sets, size_t count) {
+    return bitsetManyInto(SET_INTERSECTION, result, sets, count, 0);
+}
+
+/*
+ * Порог 1 — объединение, порог count — пересечение; при пороге больше
+ * count результат пуст.
+ */
+int bitsetThresholdManyInto(BitSet* result, BitSet** sets, size_t count,
+                            size_t threshold) {
+    int status_code = 0;
+
+    if (threshold == 0 || count >= ((size_t)1 << BITSET_COUNTER_PLANES)) {
+        status_code = -1;
+    } else if (threshold == 1) {
+        status_code = bitsetUnionManyInto(result, sets, count);
+    } else if (threshold == count) {
+        status_code = bitsetIntersectionManyInto(result, sets, count);
+    } else if (threshold > count) {
+        status_code = manyCanHold(result, sets, count, false);
+        if (status_code == 0) {
+            memset(bitsetBlocks(result), 0,
+                   result->blockCount * sizeof(uint64_t));
+            bitsetTouch(result, 0, result->blockCount);
+            result->size = 0;
+        }
+    } else {
+        status_code = bitsetManyInto(SET_UNION, result, sets, count,
+                                     threshold);
+    }
+
+    return status_code;
+}
+
+int bitsetMajorityManyInto(BitSet* result, BitSet** sets, size_t count) {
+    return bitsetThresholdManyInto(result, sets, count, count / 2 + 1);
+}
+
+// Результат операции над множествами со сводкой тоже получает сводку,
+// над растущими множествами — сам становится растущим
+static void inheritLayoutMany(BitSet* result, BitSet** sets, size_t count) {
+    bool summary  = false;
+    bool growable = false;
+
+    for (size_t iter = 0; iter < count; iter++) {
+        summary |= sets[iter]->summary != NULL;
+        growable |= sets[iter]->growable;
+    }
+    if (summary) {
+        bitsetSummaryBuild(result);
+    }
+    if (growable && bitsetBlocks(result) != NULL) {
+        result->capacity = result->blockCount * 64 - 1;
+        result->growable = true;
+    }
+}
+
+static void inheritLayout(BitSet* result, BitSet* setA, BitSet* setB) {
+    BitSet* sets[2] = {setA, setB};
+    inheritLayoutMany(result, sets, 2);
+}
+
+// Множество для результата операции над массивом: наибольшая ёмкость входов
+static BitSet manyResultCreate(BitSet** sets, size_t count) {
+    size_t     capacity  = 0;
+    Allocator* allocator = count != 0 ? sets[0]->allocator : NULL;
+
+    for (size_t iter = 0; iter < count; iter++) {
+        if (sets[iter]->capacity > capacity) {
+            capacity = sets[iter]->capacity;
+        }
+    }
+
+    BitSet set = bitsetCreateWith(capacity, allocator);
+    inheritLayoutMany(&set, sets, count);
+
+    return set;
+}
+
+BitSet bitsetUnionMany(BitSet** sets, size_t count) {
+    BitSet set = manyResultCreate(sets, count);
+    bitsetUnionManyInto(&set, sets, count);
+
+    return set;
+}
+
+BitSet bitsetIntersectionMany(BitSet** sets, size_t count) {
+    BitSet set = manyResultCreate(sets, count);
+    bitsetIntersectionManyInto(&set, sets, count);
+
+    return set;
+}
+
+BitSet bitsetThresholdMany(BitSet** sets, size_t count, size_t threshold) {
+    BitSet set = manyResultCreate(sets, count);
+    bitsetThresholdManyInto(&set, sets, count, threshold);
+
+    return set;
+}
+
+BitSet bitsetMajorityMany(BitSet** sets, size_t count) {
+    BitSet set = manyResultCreate(sets, count);
+    bitsetMajorityManyInto(&set, sets, count);
+
+    return set;
+}
+
+BitSet getSetsUnion(BitSet* setA, BitSet* setB) {
+    BitSet setC = bitsetCreateWith(maxCapacity(setA, setB), setA->allocator);
+    inheritLayout(&setC, setA, setB);
+    getSetsUnionInto(&setC, setA, setB);
+
+    return setC;
+}
+
+BitSet getSetsIntersection(BitSet* setA, BitSet* setB) {
+    BitSet setC = bitsetCreateWith(maxCapacity(setA, setB), setA->allocator);
+    inheritLayout(&setC, setA, setB);
+    getSetsIntersectionInto(&setC, setA, setB);
+
+    return setC;
+}
+
+BitSet getSetsDifference(BitSet* setA, BitSet* setB) {
+    BitSet setC = bitsetCreateWith(setA->capacity, setA->allocator);
+    inheritLayout(&setC, setA, setB);
+    getSetsDifferenceInto(&setC, setA, setB);
+
+    return setC;
+}
+
+BitSet getSetsSymmetricDifference(BitSet* setA, BitSet* setB) {
+    BitSet setC = bitsetCreateWith(maxCapacity(setA, setB), setA->allocator);
+    inheritLayout(&setC, setA, setB);
+    getSetsSymmetricDifferenceInto(&setC, setA, setB);
+
+    return setC;
+}
+
+BitSet getComplementSet(BitSet* setA) {
+    BitSet set = bitsetCreateWith(setA->capacity, setA->allocator);
+    getComplementSetInto(&set, setA);
 
     return set;
 }
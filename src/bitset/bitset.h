@@ -6,32 +6,174 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "../allocator/allocator.h"
 #include "../handlers/errors.h"
-#include "../output/output.h"
+
+// Индекс rank/select (см. bitsetIndexBuild)
+typedef struct BitsetIndex BitsetIndex;
+
+// Сводка непустых слов (см. bitsetSummaryBuild)
+typedef struct BitsetSummary BitsetSummary;
+
+// Множества до BITSET_INLINE_WORDS слов (256 элементов) хранятся внутри
+// структуры без выделения памяти
+#define BITSET_INLINE_WORDS 4
 
 typedef struct {
-    uint64_t* bits;        // Динамический блок битов
-    size_t    blockCount;  // Количество элементов динамического массива bits
-    size_t    size;        // Количество блоков
-    size_t    capacity;    // Максимальное число элементов в множестве
+    uint64_t*      bits;        // Динамический блок битов или NULL для малых
+    size_t         blockCount;  // Количество элементов динамического массива bits
+    size_t         size;        // Количество блоков
+    size_t         capacity;    // Максимальное число элементов в множестве
+    Allocator*     allocator;   // Распределитель памяти блоков
+    BitsetIndex*   index;       // Индекс rank/select или NULL
+    BitsetSummary* summary;     // Сводка непустых слов или NULL
+    bool           growable;    // Расширяется при добавлении за capacity
+    uint64_t       inlineBits[BITSET_INLINE_WORDS];  // Слова малого множества
 } BitSet;
 
+// Обработчик элемента при обходе множества
+typedef void (*BitsetVisitor)(int element, void* context);
+
+/* Слова множества: bits или встроенный буфер; NULL, если создать не удалось.
+ * Копия структуры малого множества независима от оригинала */
+uint64_t* bitsetBlocks(BitSet* set);
+
 /* Функции работы с множеством */
 BitSet bitsetCreate(size_t capacity);
-void bitsetAdd(BitSet* set, int element);
+BitSet bitsetCreateWith(size_t capacity, Allocator* allocator);
+BitSet bitsetCreateGrowable(size_t capacity);
+int bitsetAdd(BitSet* set, int element);
 void bitsetAddMany(BitSet* set, int* array, int elementsCount);
-void bitsetRemove(BitSet* set, int element);
+int bitsetRemove(BitSet* set, int element);
 void bitsetRemoveMany(BitSet* set, int* array, int elementsCount);
 bool bitsetContains(BitSet* set, int element);
 void bitsetDestroy(BitSet* set);
 size_t findSetSize(BitSet* set);
+
+/*
+ * Растущее множество при добавлении элемента, пачки или диапазона за
+ * capacity удваивает число слов; удаление и проверка элементов за
+ * capacity не считаются ошибкой. Reserve расширяет любое множество,
+ * ShrinkToFit ужимает растущее множество до наибольшего элемента.
+ */
+int bitsetReserve(BitSet* set, size_t capacity);
+int bitsetShrinkToFit(BitSet* set);
+
+/* Варианты без проверки границ: элемент обязан лежать в 0..capacity */
+void bitsetAddUnchecked(BitSet* set, int element);
+void bitsetRemoveUnchecked(BitSet* set, int element);
+bool bitsetContainsUnchecked(BitSet* set, int element);
+
+/*
+ * Пакетная проверка наличия: out[i] — есть ли ids[i] в множестве.
+ * Packed-вариант пишет ответ i в бит i % 64 слова out[i / 64];
+ * out содержит (elementsCount + 63) / 64 слов.
+ */
+void bitsetContainsMany(BitSet* set, int* ids, int elementsCount,
+                        bool* out);
+void bitsetContainsManyPacked(BitSet* set, int* ids, int elementsCount,
+                              uint64_t* out);
+
+size_t bitsetCountBlocks(BitSet* set, size_t fromBlock, size_t toBlock);
+uint64_t bitsetLastBlockMask(size_t capacity);
+uint64_t bitsetElementMask(size_t element);
 bool setsIsEqual(BitSet* setA, BitSet* setB);
 bool setIsSubset(BitSet* setA, BitSet* setB);
 bool setIsStrictSubset(BitSet* setA, BitSet* setB);
+bool setIsSuperset(BitSet* setA, BitSet* setB);
+bool bitsetIntersects(BitSet* setA, BitSet* setB);
+
+/* Мощности результатов операций и сходство без построения результата */
+size_t bitsetIntersectionSize(BitSet* setA, BitSet* setB);
+size_t bitsetUnionSize(BitSet* setA, BitSet* setB);
+size_t bitsetDifferenceSize(BitSet* setA, BitSet* setB);
+size_t bitsetSymmetricDifferenceSize(BitSet* setA, BitSet* setB);
+double bitsetJaccard(BitSet* setA, BitSet* setB);
+double bitsetDice(BitSet* setA, BitSet* setB);
+size_t bitsetHamming(BitSet* setA, BitSet* setB);
+void bitsetIntersectionSizeMany(BitSet* query, BitSet* candidates,
+                                size_t count, size_t* sizes);
+void bitsetJaccardMany(BitSet* query, BitSet* candidates, size_t count,
+                       double* scores);
+
 BitSet getSetsUnion(BitSet* setA, BitSet* setB);
 BitSet getSetsIntersection(BitSet* setA, BitSet* setB);
 BitSet getSetsDifference(BitSet* setA, BitSet* setB);
 BitSet getSetsSymmetricDifference(BitSet* setA, BitSet* setB);
 BitSet getComplementSet(BitSet* setA);
 
+/*
+ * Операции над массивом из count множеств за один проход по словам:
+ * элементы всех множеств, общие элементы и элементы, входящие хотя бы в
+ * threshold множеств (majority — больше чем в половину). Into-варианты
+ * возвращают -1 при пустом массиве, нулевом пороге или нехватке ёмкости.
+ */
+BitSet bitsetUnionMany(BitSet** sets, size_t count);
+BitSet bitsetIntersectionMany(BitSet** sets, size_t count);
+BitSet bitsetThresholdMany(BitSet** sets, size_t count, size_t threshold);
+BitSet bitsetMajorityMany(BitSet** sets, size_t count);
+int bitsetUnionManyInto(BitSet* result, BitSet** sets, size_t count);
+int bitsetIntersectionManyInto(BitSet* result, BitSet** sets, size_t count);
+int bitsetThresholdManyInto(BitSet* result, BitSet** sets, size_t count,
+                            size_t threshold);
+int bitsetMajorityManyInto(BitSet* result, BitSet** sets, size_t count);
+
+/* Операции с записью в готовое множество (result может совпадать с setA/setB)
+ * Возвращают -1, если ёмкости result недостаточно для результата */
+int getSetsUnionInto(BitSet* result, BitSet* setA, BitSet* setB);
+int getSetsIntersectionInto(BitSet* result, BitSet* setA, BitSet* setB);
+int getSetsDifferenceInto(BitSet* result, BitSet* setA, BitSet* setB);
+int getSetsSymmetricDifferenceInto(BitSet* result, BitSet* setA,
+                                   BitSet* setB);
+int getComplementSetInto(BitSet* result, BitSet* setA);
+
+/* Операции на месте: setA op= setB */
+int bitsetUnionInPlace(BitSet* setA, BitSet* setB);
+int bitsetIntersectionInPlace(BitSet* setA, BitSet* setB);
+int bitsetDifferenceInPlace(BitSet* setA, BitSet* setB);
+int bitsetSymmetricDifferenceInPlace(BitSet* setA, BitSet* setB);
+int bitsetComplementInPlace(BitSet* setA);
+
+/* Операции над диапазоном элементов [lo, hi); -1 — диапазон вне множества */
+int bitsetAddRange(BitSet* set, int lo, int hi);
+int bitsetRemoveRange(BitSet* set, int lo, int hi);
+int bitsetFlipRange(BitSet* set, int lo, int hi);
+size_t bitsetCountRange(BitSet* set, int lo, int hi);
+bool bitsetContainsRange(BitSet* set, int lo, int hi);
+
+/*
+ * Порядковые статистики. Rank — число элементов меньше x, Select — k-й по
+ * возрастанию элемент (с нуля) или -1. С индексом запросы выполняются за
+ * почти постоянное время; изменения множества помечают часть индекса
+ * устаревшей, и она пересчитывается при следующем запросе.
+ */
+int bitsetIndexBuild(BitSet* set);
+void bitsetIndexDestroy(BitSet* set);
+size_t bitsetRank(BitSet* set, size_t x);
+int bitsetSelect(BitSet* set, size_t k);
+int bitsetMin(BitSet* set);
+int bitsetMax(BitSet* set);
+
+/*
+ * Двухуровневая сводка непустых слов для разреженных множеств: объединение,
+ * пересечение, равенство, обход и подсчёт со сводкой читают только непустые
+ * слова. Поддерживается добавлением, удалением и всеми операциями.
+ */
+int bitsetSummaryBuild(BitSet* set);
+void bitsetSummaryDestroy(BitSet* set);
+
+/* Сообщает, что слова [fromBlock, toBlock) изменены напрямую через bits:
+ * индекс помечается устаревшим, сводка пересчитывается */
+void bitsetBlocksChanged(BitSet* set, size_t fromBlock, size_t toBlock);
+
+/* Обход элементов множества по возрастанию (-1 — элементов больше нет) */
+int bitsetNextSet(BitSet* set, int from);
+int bitsetPrevSet(BitSet* set, int from);
+void bitsetForEach(BitSet* set, BitsetVisitor visitor, void* context);
+size_t bitsetToArray(BitSet* set, int from, int* output, size_t maxCount);
+
+#define BITSET_FOREACH(set, element)                        \
+    for (int element = bitsetNextSet((set), 0); element >= 0; \
+         element = bitsetNextSet((set), element + 1))
+
 #endif
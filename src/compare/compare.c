@@ -0,0 +1,296 @@
+#include "compare.h"
+
+#include <stdatomic.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define COMPARE_X86 1
+#endif
+
+typedef unsigned (*CompareFunction)(const uint64_t* blocksA,
+                                    const uint64_t* blocksB, size_t count,
+                                    unsigned stopMask);
+typedef bool (*AnyBitsFunction)(const uint64_t* blocks, size_t count);
+
+// Признаки отношения по накопленным словам
+static unsigned compareFlags(uint64_t extraA, uint64_t extraB,
+                             uint64_t common) {
+    unsigned flags = 0;
+
+    if (extraA != 0) {
+        flags |= COMPARE_EXTRA_A;
+    }
+    if (extraB != 0) {
+        flags |= COMPARE_EXTRA_B;
+    }
+    if (common != 0) {
+        flags |= COMPARE_COMMON;
+    }
+
+    return flags;
+}
+
+static unsigned comparePortable(const uint64_t* blocksA,
+                                const uint64_t* blocksB, size_t count,
+                                unsigned stopMask) {
+    uint64_t extraA = 0;
+    uint64_t extraB = 0;
+    uint64_t common = 0;
+    unsigned flags  = 0;
+    size_t   block  = 0;
+
+    // Условие выхода проверяется раз на четыре слова, как в векторных
+    for (; block + 4 <= count && (flags & stopMask) == 0; block += 4) {
+        for (size_t iter = block; iter < block + 4; iter++) {
+            extraA |= blocksA[iter] & ~blocksB[iter];
+            extraB |= blocksB[iter] & ~blocksA[iter];
+            common |= blocksA[iter] & blocksB[iter];
+        }
+        flags = compareFlags(extraA, extraB, common);
+    }
+    if ((flags & stopMask) == 0) {
+        for (; block < count; block++) {
+            extraA |= blocksA[block] & ~blocksB[block];
+            extraB |= blocksB[block] & ~blocksA[block];
+            common |= blocksA[block] & blocksB[block];
+        }
+        flags = compareFlags(extraA, extraB, common);
+    }
+
+    return flags;
+}
+
+static bool anyBitsPortable(const uint64_t* blocks, size_t count) {
+    uint64_t bits  = 0;
+    size_t   block = 0;
+
+    for (; block + 4 <= count && bits == 0; block += 4) {
+        bits = blocks[block] | blocks[block + 1] | blocks[block + 2] |
+               blocks[block + 3];
+    }
+    for (; block < count && bits == 0; block++) {
+        bits = blocks[block];
+    }
+
+    return bits != 0;
+}
+
+#ifdef COMPARE_X86
+
+__attribute__((target("avx2"))) static unsigned compareFlags256(
+    __m256i extraA, __m256i extraB, __m256i common) {
+    unsigned flags = 0;
+
+    if (!_mm256_testz_si256(extraA, extraA)) {
+        flags |= COMPARE_EXTRA_A;
+    }
+    if (!_mm256_testz_si256(extraB, extraB)) {
+        flags |= COMPARE_EXTRA_B;
+    }
+    if (!_mm256_testz_si256(common, common)) {
+        flags |= COMPARE_COMMON;
+    }
+
+    return flags;
+}
+
+__attribute__((target("avx2"))) static unsigned compareAvx2(
+    const uint64_t* blocksA, const uint64_t* blocksB, size_t count,
+    unsigned stopMask) {
+    __m256i  extraA = _mm256_setzero_si256();
+    __m256i  extraB = _mm256_setzero_si256();
+    __m256i  common = _mm256_setzero_si256();
+    unsigned flags  = 0;
+    size_t   block  = 0;
+
+    // Два вектора за шаг, условие выхода — по накопленным признакам
+    for (; block + 8 <= count && (flags & stopMask) == 0; block += 8) {
+        __m256i a0 = _mm256_loadu_si256((const __m256i*)(blocksA + block));
+        __m256i a1 = _mm256_loadu_si256((const __m256i*)(blocksA + block + 4));
+        __m256i b0 = _mm256_loadu_si256((const __m256i*)(blocksB + block));
+        __m256i b1 = _mm256_loadu_si256((const __m256i*)(blocksB + block + 4));
+
+        extraA = _mm256_or_si256(extraA,
+                                 _mm256_or_si256(_mm256_andnot_si256(b0, a0),
+                                                 _mm256_andnot_si256(b1, a1)));
+        extraB = _mm256_or_si256(extraB,
+                                 _mm256_or_si256(_mm256_andnot_si256(a0, b0),
+                                                 _mm256_andnot_si256(a1, b1)));
+        common = _mm256_or_si256(common,
+                                 _mm256_or_si256(_mm256_and_si256(a0, b0),
+                                                 _mm256_and_si256(a1, b1)));
+        flags = compareFlags256(extraA, extraB, common);
+    }
+    if ((flags & stopMask) == 0 && block < count) {
+        flags |= comparePortable(blocksA + block, blocksB + block,
+                                 count - block, stopMask);
+    }
+
+    return flags;
+}
+
+__attribute__((target("avx2"))) static bool anyBitsAvx2(
+    const uint64_t* blocks, size_t count) {
+    bool   anyBits = false;
+    size_t block   = 0;
+
+    for (; block + 8 <= count && !anyBits; block += 8) {
+        __m256i bits = _mm256_or_si256(
+            _mm256_loadu_si256((const __m256i*)(blocks + block)),
+            _mm256_loadu_si256((const __m256i*)(blocks + block + 4)));
+        anyBits = !_mm256_testz_si256(bits, bits);
+    }
+    if (!anyBits) {
+        anyBits = anyBitsPortable(blocks + block, count - block);
+    }
+
+    return anyBits;
+}
+
+__attribute__((target("avx512f"))) static unsigned compareAvx512(
+    const uint64_t* blocksA, const uint64_t* blocksB, size_t count,
+    unsigned stopMask) {
+    __m512i  extraA = _mm512_setzero_si512();
+    __m512i  extraB = _mm512_setzero_si512();
+    __m512i  common = _mm512_setzero_si512();
+    unsigned flags  = 0;
+
+    // Хвост читается маскированной загрузкой, недостающие слова — нули
+    for (size_t block = 0; block < count && (flags & stopMask) == 0;
+         block += 8) {
+        __mmask8 mask = count - block >= 8
+                            ? (__mmask8)0xFF
+                            : (__mmask8)((1u << (count - block)) - 1);
+        __m512i  a    = _mm512_maskz_loadu_epi64(mask, blocksA + block);
+        __m512i  b    = _mm512_maskz_loadu_epi64(mask, blocksB + block);
+
+        extraA = _mm512_or_si512(extraA, _mm512_andnot_si512(b, a));
+        extraB = _mm512_or_si512(extraB, _mm512_andnot_si512(a, b));
+        common = _mm512_or_si512(common, _mm512_and_si512(a, b));
+        flags  = compareFlags(_mm512_test_epi64_mask(extraA, extraA),
+                              _mm512_test_epi64_mask(extraB, extraB),
+                              _mm512_test_epi64_mask(common, common));
+    }
+
+    return flags;
+}
+
+__attribute__((target("avx512f"))) static bool anyBitsAvx512(
+    const uint64_t* blocks, size_t count) {
+    bool anyBits = false;
+
+    for (size_t block = 0; block < count && !anyBits; block += 8) {
+        __mmask8 mask = count - block >= 8
+                            ? (__mmask8)0xFF
+                            : (__mmask8)((1u << (count - block)) - 1);
+        __m512i  bits = _mm512_maskz_loadu_epi64(mask, blocks + block);
+
+        anyBits = _mm512_test_epi64_mask(bits, bits) != 0;
+    }
+
+    return anyBits;
+}
+
+#endif
+
+static bool compareKernelSupported(CompareKernel kernel) {
+    bool isSupported = false;
+
+    switch (kernel) {
+        case COMPARE_PORTABLE:
+            isSupported = true;
+            break;
+#ifdef COMPARE_X86
+        case COMPARE_AVX2:
+            isSupported = __builtin_cpu_supports("avx2");
+            break;
+        case COMPARE_AVX512:
+            isSupported = __builtin_cpu_supports("avx512f");
+            break;
+#endif
+        default:
+            break;
+    }
+
+    return isSupported;
+}
+
+static CompareKernel compareDetectKernel(void) {
+    CompareKernel kernel = COMPARE_PORTABLE;
+
+    if (compareKernelSupported(COMPARE_AVX512)) {
+        kernel = COMPARE_AVX512;
+    } else if (compareKernelSupported(COMPARE_AVX2)) {
+        kernel = COMPARE_AVX2;
+    }
+
+    return kernel;
+}
+
+// Выбранная реализация; определяется при первом вызове и публикуется
+// атомарно, как в popcount: activeCompare записывается последней
+static _Atomic CompareKernel   activeKernel  = COMPARE_AUTO;
+static _Atomic CompareFunction activeCompare = NULL;
+static _Atomic AnyBitsFunction activeAnyBits = NULL;
+
+unsigned compareBlocks(const uint64_t* blocksA, const uint64_t* blocksB,
+                       size_t count, unsigned stopMask) {
+    CompareFunction function =
+        atomic_load_explicit(&activeCompare, memory_order_acquire);
+
+    if (function == NULL) {
+        compareSelectKernel(COMPARE_AUTO);
+        function = atomic_load_explicit(&activeCompare, memory_order_acquire);
+    }
+
+    return function(blocksA, blocksB, count, stopMask);
+}
+
+bool compareAnyBits(const uint64_t* blocks, size_t count) {
+    AnyBitsFunction function =
+        atomic_load_explicit(&activeAnyBits, memory_order_acquire);
+
+    if (function == NULL) {
+        compareSelectKernel(COMPARE_AUTO);
+        function = atomic_load_explicit(&activeAnyBits, memory_order_acquire);
+    }
+
+    return function(blocks, count);
+}
+
+int compareSelectKernel(CompareKernel kernel) {
+    int status_code = 0;
+
+    if (kernel == COMPARE_AUTO) {
+        kernel = compareDetectKernel();
+    }
+
+    if (compareKernelSupported(kernel)) {
+        CompareFunction compare = comparePortable;
+        AnyBitsFunction anyBits = anyBitsPortable;
+#ifdef COMPARE_X86
+        if (kernel == COMPARE_AVX2) {
+            compare = compareAvx2;
+            anyBits = anyBitsAvx2;
+        } else if (kernel == COMPARE_AVX512) {
+            compare = compareAvx512;
+            anyBits = anyBitsAvx512;
+        }
+#endif
+        atomic_store_explicit(&activeKernel, kernel, memory_order_relaxed);
+        atomic_store_explicit(&activeAnyBits, anyBits, memory_order_release);
+        atomic_store_explicit(&activeCompare, compare, memory_order_release);
+    } else {
+        status_code = -1;
+    }
+
+    return status_code;
+}
+
+CompareKernel compareActiveKernel(void) {
+    if (atomic_load_explicit(&activeCompare, memory_order_acquire) == NULL) {
+        compareSelectKernel(COMPARE_AUTO);
+    }
+
+    return atomic_load_explicit(&activeKernel, memory_order_relaxed);
+}
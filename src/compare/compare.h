@@ -0,0 +1,32 @@
+#ifndef COMPARE_H
+#define COMPARE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Признаки отношения двух массивов слов */
+#define COMPARE_EXTRA_A 1u   // В A есть биты, которых нет в B
+#define COMPARE_EXTRA_B 2u   // В B есть биты, которых нет в A
+#define COMPARE_COMMON  4u   // Есть общие биты
+
+/* Варианты реализации сравнения */
+typedef enum {
+    COMPARE_AUTO,       // Выбор по возможностям процессора
+    COMPARE_PORTABLE,   // Переносимый цикл по словам
+    COMPARE_AVX2,       // Векторы по 4 слова
+    COMPARE_AVX512      // Векторы по 8 слов
+} CompareKernel;
+
+/*
+ * Признаки отношения слов [0, count) двух массивов за один проход.
+ * Проход завершается на первом векторе, после которого среди найденных
+ * признаков есть хотя бы один из stopMask.
+ */
+unsigned compareBlocks(const uint64_t* blocksA, const uint64_t* blocksB,
+                       size_t count, unsigned stopMask);
+bool compareAnyBits(const uint64_t* blocks, size_t count);
+int compareSelectKernel(CompareKernel kernel);
+CompareKernel compareActiveKernel(void);
+
+#endif
@@ -0,0 +1,242 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "concurrent.h"
+
+#include <sched.h>
+#include <string.h>
+
+#include "../handlers/errors.h"
+
+/*
+ * Счётчик размера и число активных писателей на отдельной строке кэша.
+ * Разные счётчики меняются разными потоками, поэтому по отдельности могут
+ * «уходить в минус»; их сумма по модулю 2^64 всегда равна размеру.
+ */
+typedef struct {
+    _Alignas(64) atomic_size_t count;
+    atomic_size_t              writers;
+} ConcurrentShard;
+
+struct ConcurrentState {
+    ConcurrentShard          shards[CONCURRENT_SHARD_COUNT];
+    _Alignas(64) atomic_bool gate;  // Идёт снимок: новые записи ждут
+};
+
+// Номер счётчика потока назначается по кругу при первой записи
+static atomic_size_t       nextShard;
+static _Thread_local size_t threadShard = SIZE_MAX;
+
+static ConcurrentShard* concurrentShard(ConcurrentSet* set) {
+    if (threadShard == SIZE_MAX) {
+        threadShard = atomic_fetch_add_explicit(&nextShard, 1,
+                                                memory_order_relaxed) %
+                      CONCURRENT_SHARD_COUNT;
+    }
+    return &set->state->shards[threadShard];
+}
+
+/*
+ * Вход писателя: поток отмечается в своём счётчике и проверяет шлюз.
+ * Снимок сначала закрывает шлюз, потом ждёт, пока писатели выйдут,
+ * поэтому хотя бы одна из сторон увидит запись другой (seq_cst).
+ */
+static ConcurrentShard* writerEnter(ConcurrentSet* set) {
+    ConcurrentShard* shard   = concurrentShard(set);
+    bool             entered = false;
+
+    while (!entered) {
+        atomic_fetch_add(&shard->writers, 1);
+        entered = !atomic_load(&set->state->gate);
+        if (!entered) {
+            atomic_fetch_sub(&shard->writers, 1);
+            while (atomic_load_explicit(&set->state->gate,
+                                        memory_order_relaxed)) {
+                sched_yield();
+            }
+        }
+    }
+
+    return shard;
+}
+
+static void writerExit(ConcurrentShard* shard) {
+    atomic_fetch_sub_explicit(&shard->writers, 1, memory_order_release);
+}
+
+ConcurrentSet concurrentCreate(size_t capacity) {
+    return concurrentCreateWith(capacity, NULL);
+}
+
+ConcurrentSet concurrentCreateWith(size_t capacity, Allocator* allocator) {
+    // Элементы принимают значения 0..capacity включительно
+    size_t blockCount = capacity / 64 + 1;
+
+    ConcurrentSet set;
+    set.allocator = allocatorResolve(allocator);
+    set.blockCount = blockCount;
+    set.capacity = capacity;
+    set.bits = (_Atomic uint64_t*)allocatorAllocate(
+        set.allocator, blockCount * sizeof(uint64_t));
+    set.state = (ConcurrentState*)allocatorAllocate(set.allocator,
+                                                    sizeof(ConcurrentState));
+
+    if (memoryIsAllocated(set.bits) != 0 ||
+        memoryIsAllocated(set.state) != 0) {
+        concurrentDestroy(&set);
+    }
+
+    return set;
+}
+
+void concurrentDestroy(ConcurrentSet* set) {
+    allocatorRelease(set->allocator, (void*)set->bits,
+                     set->blockCount * sizeof(uint64_t));
+    allocatorRelease(set->allocator, set->state, sizeof(ConcurrentState));
+    set->bits = NULL;
+    set->state = NULL;
+    set->blockCount = 0;
+    set->capacity = 0;
+}
+
+int concurrentAdd(ConcurrentSet* set, int element) {
+    int status_code =
+        set->bits != NULL ? elementCanBeCreated(element, set->capacity) : -1;
+
+    if (status_code == 0) {
+        ConcurrentShard* shard = writerEnter(set);
+        uint64_t         mask  = bitsetElementMask((size_t)element);
+        uint64_t         old   = atomic_fetch_or_explicit(
+            &set->bits[element / 64], mask, memory_order_relaxed);
+
+        if ((old & mask) == 0) {
+            atomic_fetch_add_explicit(&shard->count, 1, memory_order_relaxed);
+        }
+        writerExit(shard);
+    }
+
+    return status_code;
+}
+
+int concurrentRemove(ConcurrentSet* set, int element) {
+    int status_code =
+        set->bits != NULL ? elementCanBeCreated(element, set->capacity) : -1;
+
+    if (status_code == 0) {
+        ConcurrentShard* shard = writerEnter(set);
+        uint64_t         mask  = bitsetElementMask((size_t)element);
+        uint64_t         old   = atomic_fetch_and_explicit(
+            &set->bits[element / 64], ~mask, memory_order_relaxed);
+
+        if ((old & mask) != 0) {
+            atomic_fetch_sub_explicit(&shard->count, 1, memory_order_relaxed);
+        }
+        writerExit(shard);
+    }
+
+    return status_code;
+}
+
+/*
+ * Пачка проходит шлюз один раз. Подряд идущие элементы одного слова
+ * собираются в маску и записываются одним fetch-or; размер увеличивается
+ * на число действительно новых бит, а счётчик потока — один раз на пачку.
+ */
+void concurrentAddMany(ConcurrentSet* set, int* array, int elementsCount) {
+    if (elementsCount > 0 && set->bits != NULL) {
+        ConcurrentShard* shard = writerEnter(set);
+        size_t           added = 0;
+        size_t           count = (size_t)elementsCount;
+        size_t           iter  = 0;
+
+        while (iter < count) {
+            if (elementCanBeCreated(array[iter], set->capacity) != 0) {
+                iter++;
+            } else {
+                size_t   block = (size_t)array[iter] / 64;
+                uint64_t mask  = 0;
+
+                while (iter < count && array[iter] >= 0 &&
+                       (size_t)array[iter] <= set->capacity &&
+                       (size_t)array[iter] / 64 == block) {
+                    mask |= bitsetElementMask((size_t)array[iter]);
+                    iter++;
+                }
+
+                uint64_t old = atomic_fetch_or_explicit(
+                    &set->bits[block], mask, memory_order_relaxed);
+                added += (size_t)__builtin_popcountll(mask & ~old);
+            }
+        }
+
+        atomic_fetch_add_explicit(&shard->count, added, memory_order_relaxed);
+        writerExit(shard);
+    }
+}
+
+bool concurrentContains(ConcurrentSet* set, int element) {
+    bool contains = false;
+    if (set->bits != NULL &&
+        elementCanBeCreated(element, set->capacity) == 0) {
+        contains = (atomic_load_explicit(&set->bits[element / 64],
+                                         memory_order_relaxed) &
+                    bitsetElementMask((size_t)element)) != 0;
+    }
+    return contains;
+}
+
+// Сумма счётчиков; при одновременной записи — приблизительный размер
+size_t concurrentSize(ConcurrentSet* set) {
+    size_t size = 0;
+    for (size_t shard = 0;
+         shard < CONCURRENT_SHARD_COUNT && set->state != NULL; shard++) {
+        size += atomic_load_explicit(&set->state->shards[shard].count,
+                                     memory_order_relaxed);
+    }
+    return size;
+}
+
+int concurrentSnapshotInto(ConcurrentSet* set, BitSet* result) {
+    int status_code = 0;
+
+    if (set->bits == NULL || bitsetBlocks(result) == NULL ||
+        result->capacity < set->capacity) {
+        status_code = -1;
+    } else {
+        ConcurrentState* state  = set->state;
+        bool             closed = false;
+
+        // Снимки выполняются по одному
+        while (!atomic_compare_exchange_weak(&state->gate, &closed, true)) {
+            closed = false;
+            sched_yield();
+        }
+        for (size_t shard = 0; shard < CONCURRENT_SHARD_COUNT; shard++) {
+            while (atomic_load_explicit(&state->shards[shard].writers,
+                                        memory_order_acquire) != 0) {
+                sched_yield();
+            }
+        }
+
+        uint64_t* bits = bitsetBlocks(result);
+
+        for (size_t block = 0; block < set->blockCount; block++) {
+            bits[block] = atomic_load_explicit(&set->bits[block],
+                                               memory_order_relaxed);
+        }
+        result->size = concurrentSize(set);
+        atomic_store(&state->gate, false);
+
+        memset(bits + set->blockCount, 0,
+               (result->blockCount - set->blockCount) * sizeof(uint64_t));
+        bitsetBlocksChanged(result, 0, result->blockCount);
+    }
+
+    return status_code;
+}
+
+BitSet concurrentSnapshot(ConcurrentSet* set) {
+    BitSet result = bitsetCreateWith(set->capacity, set->allocator);
+    concurrentSnapshotInto(set, &result);
+
+    return result;
+}
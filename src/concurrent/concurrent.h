@@ -0,0 +1,50 @@
+#ifndef CONCURRENT_H
+#define CONCURRENT_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../allocator/allocator.h"
+#include "../bitset/bitset.h"
+
+#define CONCURRENT_SHARD_COUNT 32  // Счётчиков размера (по одному на поток)
+
+// Счётчики и шлюз снимков (см. concurrentSnapshot)
+typedef struct ConcurrentState ConcurrentState;
+
+/*
+ * Множество для одновременной записи из многих потоков без блокировок:
+ * слова меняются атомарными fetch-or/fetch-and, размер ведётся в
+ * отдельных для каждого потока счётчиках на своих строках кэша.
+ */
+typedef struct {
+    _Atomic uint64_t* bits;        // Слова множества
+    size_t            blockCount;  // Количество слов
+    size_t            capacity;    // Максимальное число элементов в множестве
+    Allocator*        allocator;   // Распределитель памяти
+    ConcurrentState*  state;       // Счётчики потоков и шлюз снимков
+} ConcurrentSet;
+
+/* Функции работы с множеством; безопасны при вызове из любых потоков,
+ * кроме создания и удаления */
+ConcurrentSet concurrentCreate(size_t capacity);
+ConcurrentSet concurrentCreateWith(size_t capacity, Allocator* allocator);
+void concurrentDestroy(ConcurrentSet* set);
+int concurrentAdd(ConcurrentSet* set, int element);
+int concurrentRemove(ConcurrentSet* set, int element);
+void concurrentAddMany(ConcurrentSet* set, int* array, int elementsCount);
+bool concurrentContains(ConcurrentSet* set, int element);
+size_t concurrentSize(ConcurrentSet* set);
+
+/*
+ * Согласованный снимок: запись приостанавливается только на время
+ * копирования слов, после чего над снимком можно выполнять любые
+ * операции getSets*, пока запись в множество продолжается.
+ * Into возвращает -1, если ёмкости result недостаточно.
+ */
+BitSet concurrentSnapshot(ConcurrentSet* set);
+int concurrentSnapshotInto(ConcurrentSet* set, BitSet* result);
+
+#endif
@@ -0,0 +1,523 @@
+#include "ewah.h"
+
+#include <string.h>
+
+#include "../popcount/popcount.h"
+
+#define EWAH_MAX_RUNNING ((((uint64_t)1) << 32) - 1)
+#define EWAH_MAX_LITERALS ((((uint64_t)1) << 31) - 1)
+
+typedef enum {
+    EWAH_OR,
+    EWAH_AND,
+    EWAH_ANDNOT,
+    EWAH_XOR
+} EwahOperation;
+
+// Преобразование слов одного потока, когда слово другого потока известно
+typedef enum {
+    EWAH_ZEROS,     // Результат — нулевые слова
+    EWAH_ONES,      // Результат — слова из единиц
+    EWAH_COPY,      // Слово переписывается без изменений
+    EWAH_NEGATE     // Слово инвертируется
+} EwahTransform;
+
+typedef struct {
+    const uint64_t* words;
+    size_t          literalIndex;   // Следующее литеральное слово
+    size_t          remaining;      // Осталось несжатых слов
+    uint64_t        runningLength;  // Осталось слов текущей серии
+    uint64_t        literalCount;   // Осталось литеральных слов
+    bool            runningBit;
+} EwahReader;
+
+static bool markerRunningBit(uint64_t marker) {
+    return marker & 1;
+}
+
+static uint64_t markerRunningLength(uint64_t marker) {
+    return (marker >> 1) & EWAH_MAX_RUNNING;
+}
+
+static uint64_t markerLiteralCount(uint64_t marker) {
+    return marker >> 33;
+}
+
+static uint64_t makeMarker(bool runningBit, uint64_t runningLength,
+                           uint64_t literalCount) {
+    return (uint64_t)runningBit | (runningLength << 1) | (literalCount << 33);
+}
+
+/* Запись потока */
+
+static int ewahPush(EwahSet* set, uint64_t word) {
+    int status_code = 0;
+
+    if (set->length == set->allocated) {
+        size_t    allocated = set->allocated == 0 ? 4 : set->allocated * 2;
+        uint64_t* words =
+            (uint64_t*)realloc(set->words, allocated * sizeof(uint64_t));
+        if (words == NULL) {
+            status_code = -1;
+        } else {
+            set->words     = words;
+            set->allocated = allocated;
+        }
+    }
+
+    if (status_code == 0) {
+        set->words[set->length++] = word;
+    }
+
+    return status_code;
+}
+
+// Пустой поток из одного маркера
+static EwahSet ewahStart(size_t capacity) {
+    EwahSet set = {NULL, 0, 0, 0, 0, 0, capacity};
+    ewahPush(&set, 0);
+
+    return set;
+}
+
+static int ewahAddClean(EwahSet* set, bool bit, uint64_t count) {
+    int status_code = 0;
+
+    set->blockCount += count;
+    if (bit) {
+        set->size += count * 64;
+    }
+
+    while (count > 0 && status_code == 0) {
+        uint64_t marker  = set->words[set->lastMarker];
+        uint64_t running = markerRunningLength(marker);
+
+        if (markerLiteralCount(marker) == 0 &&
+            (running == 0 || markerRunningBit(marker) == bit) &&
+            running < EWAH_MAX_RUNNING) {
+            uint64_t added = EWAH_MAX_RUNNING - running;
+            if (added > count) {
+                added = count;
+            }
+            set->words[set->lastMarker] = makeMarker(bit, running + added, 0);
+            count -= added;
+        } else {
+            status_code     = ewahPush(set, 0);
+            set->lastMarker = set->length - 1;
+        }
+    }
+
+    return status_code;
+}
+
+static int ewahAddWord(EwahSet* set, uint64_t word) {
+    int status_code = 0;
+
+    if (word == 0 || word == ~(uint64_t)0) {
+        status_code = ewahAddClean(set, word != 0, 1);
+    } else {
+        uint64_t marker = set->words[set->lastMarker];
+        if (markerLiteralCount(marker) == EWAH_MAX_LITERALS) {
+            status_code     = ewahPush(set, 0);
+            set->lastMarker = set->length - 1;
+            marker          = 0;
+        }
+        if (status_code == 0) {
+            status_code = ewahPush(set, word);
+        }
+        if (status_code == 0) {
+            set->words[set->lastMarker] =
+                makeMarker(markerRunningBit(marker),
+                           markerRunningLength(marker),
+                           markerLiteralCount(marker) + 1);
+            set->blockCount += 1;
+            set->size += (size_t)__builtin_popcountll(word);
+        }
+    }
+
+    return status_code;
+}
+
+/* Чтение потока */
+
+// Переходит к следующему маркеру, если текущий исчерпан
+static void readerNormalize(EwahReader* reader) {
+    while (reader->remaining > 0 && reader->runningLength == 0 &&
+           reader->literalCount == 0) {
+        uint64_t marker       = reader->words[reader->literalIndex];
+        reader->runningBit    = markerRunningBit(marker);
+        reader->runningLength = markerRunningLength(marker);
+        reader->literalCount  = markerLiteralCount(marker);
+        reader->literalIndex += 1;
+    }
+}
+
+static EwahReader readerCreate(EwahSet* set) {
+    EwahReader reader = {set->words, 0, set->blockCount, 0, 0, false};
+    readerNormalize(&reader);
+
+    return reader;
+}
+
+static void readerSkipClean(EwahReader* reader, uint64_t count) {
+    reader->runningLength -= count;
+    reader->remaining -= count;
+    readerNormalize(reader);
+}
+
+static uint64_t readerNextLiteral(EwahReader* reader) {
+    uint64_t word = reader->words[reader->literalIndex++];
+    reader->literalCount -= 1;
+    reader->remaining -= 1;
+    readerNormalize(reader);
+
+    return word;
+}
+
+static uint64_t applyTransform(EwahTransform transform, uint64_t word) {
+    uint64_t result = word;
+
+    if (transform == EWAH_ZEROS) {
+        result = 0;
+    } else if (transform == EWAH_ONES) {
+        result = ~(uint64_t)0;
+    } else if (transform == EWAH_NEGATE) {
+        result = ~word;
+    }
+
+    return result;
+}
+
+// Переписывает count слов из reader в set, преобразуя их
+static int readerCopy(EwahReader* reader, EwahSet* set,
+                      EwahTransform transform, uint64_t count) {
+    int status_code = 0;
+
+    if (transform == EWAH_ZEROS || transform == EWAH_ONES) {
+        status_code = ewahAddClean(set, transform == EWAH_ONES, count);
+    }
+
+    while (count > 0 && status_code == 0) {
+        if (reader->runningLength > 0) {
+            uint64_t clean = reader->runningLength;
+            if (clean > count) {
+                clean = count;
+            }
+            if (transform == EWAH_COPY || transform == EWAH_NEGATE) {
+                bool bit    = reader->runningBit != (transform == EWAH_NEGATE);
+                status_code = ewahAddClean(set, bit, clean);
+            }
+            readerSkipClean(reader, clean);
+            count -= clean;
+        } else {
+            uint64_t word = readerNextLiteral(reader);
+            if (transform == EWAH_COPY || transform == EWAH_NEGATE) {
+                status_code = ewahAddWord(set, applyTransform(transform, word));
+            }
+            count -= 1;
+        }
+    }
+
+    return status_code;
+}
+
+static uint64_t applyOperation(EwahOperation operation, uint64_t a,
+                               uint64_t b) {
+    uint64_t word = 0;
+
+    switch (operation) {
+        case EWAH_OR:
+            word = a | b;
+            break;
+        case EWAH_AND:
+            word = a & b;
+            break;
+        case EWAH_ANDNOT:
+            word = a & ~b;
+            break;
+        case EWAH_XOR:
+            word = a ^ b;
+            break;
+    }
+
+    return word;
+}
+
+/*
+ * Во что превращаются слова одного операнда, если соответствующее слово
+ * другого операнда равно known (0 или ~0). knownIsLeft — известное слово
+ * является левым операндом.
+ */
+static EwahTransform transformFor(EwahOperation operation, uint64_t known,
+                                  bool knownIsLeft) {
+    uint64_t zeroResult = knownIsLeft ? applyOperation(operation, known, 0)
+                                      : applyOperation(operation, 0, known);
+    uint64_t onesResult =
+        knownIsLeft ? applyOperation(operation, known, ~(uint64_t)0)
+                    : applyOperation(operation, ~(uint64_t)0, known);
+
+    EwahTransform transform = EWAH_NEGATE;
+    if (zeroResult == 0 && onesResult == 0) {
+        transform = EWAH_ZEROS;
+    } else if (zeroResult != 0 && onesResult != 0) {
+        transform = EWAH_ONES;
+    } else if (zeroResult == 0) {
+        transform = EWAH_COPY;
+    }
+
+    return transform;
+}
+
+// При нехватке памяти частичный результат освобождается: возвращается
+// пустое множество с capacity 0 и сообщается ERROR_OUT_OF_MEMORY
+static EwahSet ewahFailed(EwahSet* result) {
+    ewahDestroy(result);
+    errorReport(ERROR_OUT_OF_MEMORY, 0, 0);
+    return *result;
+}
+
+/*
+ * Операция над сжатыми потоками: серии обрабатываются целиком, поэтому
+ * время пропорционально числу серий и литеральных слов.
+ */
+static EwahSet ewahOperation(EwahOperation operation, EwahSet* setA,
+                             EwahSet* setB, size_t capacity) {
+    EwahSet    result      = ewahStart(capacity);
+    EwahReader readerA     = readerCreate(setA);
+    EwahReader readerB     = readerCreate(setB);
+    int        status_code = result.words == NULL ? -1 : 0;
+
+    while (readerA.remaining > 0 && readerB.remaining > 0 &&
+           status_code == 0) {
+        if (readerA.runningLength > 0 || readerB.runningLength > 0) {
+            // Более длинная серия определяет преобразование слов другого потока
+            bool        predatorIsA = readerA.runningLength >=
+                                      readerB.runningLength;
+            EwahReader* predator    = predatorIsA ? &readerA : &readerB;
+            EwahReader* prey        = predatorIsA ? &readerB : &readerA;
+            uint64_t    count       = predator->runningLength;
+            uint64_t    known = predator->runningBit ? ~(uint64_t)0 : 0;
+
+            if (count > prey->remaining) {
+                count = prey->remaining;
+            }
+            status_code = readerCopy(
+                prey, &result, transformFor(operation, known, predatorIsA),
+                count);
+            readerSkipClean(predator, count);
+        } else {
+            uint64_t count = readerA.literalCount < readerB.literalCount
+                                 ? readerA.literalCount
+                                 : readerB.literalCount;
+            for (uint64_t iter = 0; iter < count && status_code == 0; iter++) {
+                uint64_t a  = readerNextLiteral(&readerA);
+                uint64_t b  = readerNextLiteral(&readerB);
+                status_code = ewahAddWord(&result, applyOperation(operation, a, b));
+            }
+        }
+    }
+
+    // Недостающие слова более короткого потока считаются нулевыми
+    if (readerA.remaining > 0 && status_code == 0) {
+        status_code = readerCopy(&readerA, &result,
+                                 transformFor(operation, 0, false),
+                                 readerA.remaining);
+    } else if (readerB.remaining > 0 && status_code == 0) {
+        status_code = readerCopy(&readerB, &result,
+                                 transformFor(operation, 0, true),
+                                 readerB.remaining);
+    }
+
+    if (status_code != 0) {
+        result = ewahFailed(&result);
+    }
+
+    return result;
+}
+
+EwahSet ewahCreate(size_t capacity) {
+    EwahSet set         = ewahStart(capacity);
+    int     status_code = set.words == NULL ? -1 : 0;
+
+    if (status_code == 0) {
+        status_code = ewahAddClean(&set, false, capacity / 64 + 1);
+    }
+
+    if (status_code != 0) {
+        set = ewahFailed(&set);
+    }
+
+    return set;
+}
+
+void ewahDestroy(EwahSet* set) {
+    free(set->words);
+    set->words      = NULL;
+    set->length     = 0;
+    set->allocated  = 0;
+    set->lastMarker = 0;
+    set->blockCount = 0;
+    set->size       = 0;
+    set->capacity   = 0;
+}
+
+bool ewahContains(EwahSet* set, int element) {
+    bool isContains = false;
+
+    if (element >= 0 && (size_t)element <= set->capacity) {
+        EwahReader reader  = readerCreate(set);
+        size_t     target  = (size_t)element / 64;
+        size_t     skipped = 0;
+
+        // Пропускаем серии и литералы целиком до слова с элементом
+        while (skipped < target) {
+            uint64_t skip = target - skipped;
+            if (reader.runningLength > 0) {
+                if (skip > reader.runningLength) {
+                    skip = reader.runningLength;
+                }
+                readerSkipClean(&reader, skip);
+            } else {
+                if (skip > reader.literalCount) {
+                    skip = reader.literalCount;
+                }
+                reader.literalIndex += skip;
+                reader.literalCount -= skip;
+                reader.remaining -= skip;
+                readerNormalize(&reader);
+            }
+            skipped += skip;
+        }
+
+        if (reader.runningLength > 0) {
+            isContains = reader.runningBit;
+        } else {
+            isContains = (reader.words[reader.literalIndex] &
+                          bitsetElementMask((size_t)element)) != 0;
+        }
+    }
+
+    return isContains;
+}
+
+size_t ewahSize(EwahSet* set) {
+    return set->size;
+}
+
+size_t ewahCount(EwahSet* set) {
+    size_t counter  = 0;
+    size_t position = 0;
+
+    while (position < set->length) {
+        uint64_t marker   = set->words[position];
+        uint64_t literals = markerLiteralCount(marker);
+
+        if (markerRunningBit(marker)) {
+            counter += (size_t)markerRunningLength(marker) * 64;
+        }
+        counter += popcountBlocks(set->words + position + 1, literals);
+        position += 1 + literals;
+    }
+
+    return counter;
+}
+
+size_t ewahMemoryUsage(EwahSet* set) {
+    return sizeof(EwahSet) + set->allocated * sizeof(uint64_t);
+}
+
+static size_t maxCapacity(EwahSet* setA, EwahSet* setB) {
+    return setA->capacity > setB->capacity ? setA->capacity : setB->capacity;
+}
+
+EwahSet ewahUnion(EwahSet* setA, EwahSet* setB) {
+    return ewahOperation(EWAH_OR, setA, setB, maxCapacity(setA, setB));
+}
+
+EwahSet ewahIntersection(EwahSet* setA, EwahSet* setB) {
+    return ewahOperation(EWAH_AND, setA, setB, maxCapacity(setA, setB));
+}
+
+EwahSet ewahDifference(EwahSet* setA, EwahSet* setB) {
+    return ewahOperation(EWAH_ANDNOT, setA, setB, setA->capacity);
+}
+
+EwahSet ewahSymmetricDifference(EwahSet* setA, EwahSet* setB) {
+    return ewahOperation(EWAH_XOR, setA, setB, maxCapacity(setA, setB));
+}
+
+EwahSet ewahComplement(EwahSet* setA) {
+    EwahSet    result      = ewahStart(setA->capacity);
+    EwahReader reader      = readerCreate(setA);
+    int        status_code = result.words == NULL ? -1 : 0;
+
+    if (status_code == 0 && setA->blockCount > 0) {
+        // Все слова, кроме последнего, инвертируются сериями
+        status_code = readerCopy(&reader, &result, EWAH_NEGATE,
+                                 setA->blockCount - 1);
+    }
+
+    if (status_code == 0 && setA->blockCount > 0) {
+        uint64_t last = 0;
+        if (reader.runningLength > 0) {
+            last = reader.runningBit ? ~(uint64_t)0 : 0;
+        } else {
+            last = reader.words[reader.literalIndex];
+        }
+        status_code = ewahAddWord(&result,
+                                  ~last & bitsetLastBlockMask(setA->capacity));
+    }
+
+    if (status_code != 0) {
+        result = ewahFailed(&result);
+    }
+
+    return result;
+}
+
+EwahSet ewahFromBitSet(BitSet* set) {
+    EwahSet   result      = ewahStart(set->capacity);
+    uint64_t* bits        = bitsetBlocks(set);
+    int       status_code = result.words == NULL ? -1 : 0;
+
+    for (size_t block = 0; block < set->blockCount && status_code == 0;
+         block++) {
+        status_code = ewahAddWord(&result, bits[block]);
+    }
+
+    if (status_code != 0) {
+        result = ewahFailed(&result);
+    }
+
+    return result;
+}
+
+BitSet ewahToBitSet(EwahSet* set) {
+    BitSet     result = bitsetCreate(set->capacity);
+    uint64_t*  bits   = bitsetBlocks(&result);
+    EwahReader reader = readerCreate(set);
+    size_t     block  = 0;
+
+    // При нехватке памяти bitsetCreate уже сообщил об ошибке и вернул
+    // пустое множество
+    if (bits != NULL) {
+        while (reader.remaining > 0 && block < result.blockCount) {
+            if (reader.runningLength > 0) {
+                uint64_t count = reader.runningLength;
+                if (count > result.blockCount - block) {
+                    count = result.blockCount - block;
+                }
+                if (reader.runningBit) {
+                    memset(bits + block, 0xFF, count * sizeof(uint64_t));
+                }
+                block += count;
+                readerSkipClean(&reader, count);
+            } else {
+                bits[block++] = readerNextLiteral(&reader);
+            }
+        }
+        result.size = set->size;
+    }
+
+    return result;
+}
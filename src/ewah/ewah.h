@@ -0,0 +1,45 @@
+#ifndef EWAH_H
+#define EWAH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../bitset/bitset.h"
+
+/*
+ * Сжатие серий слов (EWAH). Поток состоит из маркеров, за каждым из
+ * которых следуют литеральные слова. Маркер: бит 0 — значение серии,
+ * биты 1..32 — число одинаковых слов серии (из одних нулей или единиц),
+ * биты 33..63 — число следующих за маркером литеральных слов.
+ */
+typedef struct {
+    uint64_t* words;       // Сжатый поток
+    size_t    length;      // Занято слов потока
+    size_t    allocated;   // Выделено слов потока
+    size_t    lastMarker;  // Индекс последнего маркера
+    size_t    blockCount;  // Количество несжатых слов
+    size_t    size;        // Количество элементов в множестве
+    size_t    capacity;    // Максимальное число элементов в множестве
+} EwahSet;
+
+/* Функции работы с множеством в сжатом виде. Создание, операции и
+ * ewahFromBitSet при нехватке памяти возвращают пустое множество с
+ * capacity 0 и сообщают ERROR_OUT_OF_MEMORY */
+EwahSet ewahCreate(size_t capacity);
+void ewahDestroy(EwahSet* set);
+bool ewahContains(EwahSet* set, int element);
+size_t ewahSize(EwahSet* set);
+size_t ewahCount(EwahSet* set);
+size_t ewahMemoryUsage(EwahSet* set);
+EwahSet ewahUnion(EwahSet* setA, EwahSet* setB);
+EwahSet ewahIntersection(EwahSet* setA, EwahSet* setB);
+EwahSet ewahDifference(EwahSet* setA, EwahSet* setB);
+EwahSet ewahSymmetricDifference(EwahSet* setA, EwahSet* setB);
+EwahSet ewahComplement(EwahSet* setA);
+
+/* Преобразование между сжатым и плотным видом */
+EwahSet ewahFromBitSet(BitSet* set);
+BitSet ewahToBitSet(EwahSet* set);
+
+#endif
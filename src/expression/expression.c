@@ -0,0 +1,531 @@
+#include "expression.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../popcount/popcount.h"
+
+// Порция слов, которая вычисляется целиком, пока стек операндов лежит в L1
+#define EXPRESSION_CHUNK_BLOCKS 256
+
+typedef struct {
+    ExpressionType type;
+    BitSet*        set;       // Операнд; у бинарной операции — правый лист
+    size_t         capacity;  // Универсум операнда дополнения
+} Instruction;
+
+typedef struct {
+    Instruction* code;
+    size_t       length;
+    size_t       depth;      // Текущая глубина стека при компиляции
+    size_t       maxDepth;   // Необходимое число слотов стека
+} Program;
+
+typedef struct {
+    const char* cursor;
+    const char** names;
+    BitSet**    sets;
+    size_t      setsCount;
+} Parser;
+
+static SetExpression* expressionNode(ExpressionType type, SetExpression* left,
+                                     SetExpression* right) {
+    SetExpression* node = NULL;
+    bool operandsValid = left != NULL &&
+                         (right != NULL || type == EXPRESSION_COMPLEMENT);
+
+    if (operandsValid) {
+        node = (SetExpression*)malloc(sizeof(SetExpression));
+    }
+
+    if (node != NULL) {
+        node->type  = type;
+        node->set   = NULL;
+        node->left  = left;
+        node->right = right;
+    } else {
+        expressionDestroy(left);
+        expressionDestroy(right);
+    }
+
+    return node;
+}
+
+SetExpression* expressionSet(BitSet* set) {
+    SetExpression* node = NULL;
+
+    if (set != NULL) {
+        node = (SetExpression*)malloc(sizeof(SetExpression));
+    }
+    if (node != NULL) {
+        node->type  = EXPRESSION_SET;
+        node->set   = set;
+        node->left  = NULL;
+        node->right = NULL;
+    }
+
+    return node;
+}
+
+SetExpression* expressionComplement(SetExpression* operand) {
+    return expressionNode(EXPRESSION_COMPLEMENT, operand, NULL);
+}
+
+SetExpression* expressionUnion(SetExpression* left, SetExpression* right) {
+    return expressionNode(EXPRESSION_UNION, left, right);
+}
+
+SetExpression* expressionIntersection(SetExpression* left,
+                                      SetExpression* right) {
+    return expressionNode(EXPRESSION_INTERSECTION, left, right);
+}
+
+SetExpression* expressionDifference(SetExpression* left,
+                                    SetExpression* right) {
+    return expressionNode(EXPRESSION_DIFFERENCE, left, right);
+}
+
+SetExpression* expressionSymmetricDifference(SetExpression* left,
+                                             SetExpression* right) {
+    return expressionNode(EXPRESSION_SYMMETRIC_DIFFERENCE, left, right);
+}
+
+void expressionDestroy(SetExpression* expression) {
+    if (expression != NULL) {
+        expressionDestroy(expression->left);
+        expressionDestroy(expression->right);
+        free(expression);
+    }
+}
+
+/* Разбор строки */
+
+static void skipSpaces(Parser* parser) {
+    while (*parser->cursor == ' ' || *parser->cursor == '\t' ||
+           *parser->cursor == '\n') {
+        parser->cursor++;
+    }
+}
+
+// Пропускает один из знаков операции, если строка начинается с него
+static bool acceptToken(Parser* parser, const char* const* tokens,
+                        size_t tokensCount) {
+    bool isAccepted = false;
+
+    skipSpaces(parser);
+    for (size_t iter = 0; iter < tokensCount && !isAccepted; iter++) {
+        size_t length = strlen(tokens[iter]);
+        if (strncmp(parser->cursor, tokens[iter], length) == 0) {
+            parser->cursor += length;
+            isAccepted = true;
+        }
+    }
+
+    return isAccepted;
+}
+
+static bool isIdentifierChar(char symbol, bool isFirst) {
+    bool isLetter = (symbol >= 'a' && symbol <= 'z') ||
+                    (symbol >= 'A' && symbol <= 'Z') || symbol == '_';
+    return isLetter || (!isFirst && symbol >= '0' && symbol <= '9');
+}
+
+static SetExpression* parseUnion(Parser* parser);
+
+static SetExpression* parsePrimary(Parser* parser) {
+    static const char* const openTokens[]  = {"("};
+    static const char* const closeTokens[] = {")"};
+    SetExpression*           node          = NULL;
+
+    if (acceptToken(parser, openTokens, 1)) {
+        node = parseUnion(parser);
+        if (node != NULL && !acceptToken(parser, closeTokens, 1)) {
+            expressionDestroy(node);
+            node = NULL;
+        }
+    } else if (isIdentifierChar(*parser->cursor, true)) {
+        const char* start = parser->cursor;
+        while (isIdentifierChar(*parser->cursor, false)) {
+            parser->cursor++;
+        }
+        size_t length = (size_t)(parser->cursor - start);
+
+        for (size_t iter = 0; iter < parser->setsCount && node == NULL;
+             iter++) {
+            if (strlen(parser->names[iter]) == length &&
+                strncmp(parser->names[iter], start, length) == 0) {
+                node = expressionSet(parser->sets[iter]);
+            }
+        }
+    }
+
+    return node;
+}
+
+static SetExpression* parseUnary(Parser* parser) {
+    static const char* const tokens[] = {"¬", "~", "!"};
+    SetExpression*           node     = NULL;
+
+    if (acceptToken(parser, tokens, 3)) {
+        node = expressionComplement(parseUnary(parser));
+    } else {
+        node = parsePrimary(parser);
+    }
+
+    return node;
+}
+
+static SetExpression* parseIntersection(Parser* parser) {
+    static const char* const tokens[] = {"∩", "&"};
+    SetExpression*           node     = parseUnary(parser);
+
+    while (node != NULL && acceptToken(parser, tokens, 2)) {
+        node = expressionIntersection(node, parseUnary(parser));
+    }
+
+    return node;
+}
+
+static SetExpression* parseDifference(Parser* parser) {
+    static const char* const tokens[] = {"-", "\\"};
+    SetExpression*           node     = parseIntersection(parser);
+
+    while (node != NULL && acceptToken(parser, tokens, 2)) {
+        node = expressionDifference(node, parseIntersection(parser));
+    }
+
+    return node;
+}
+
+static SetExpression* parseSymmetricDifference(Parser* parser) {
+    static const char* const tokens[] = {"Δ", "∆", "^"};
+    SetExpression*           node     = parseDifference(parser);
+
+    while (node != NULL && acceptToken(parser, tokens, 3)) {
+        node = expressionSymmetricDifference(node, parseDifference(parser));
+    }
+
+    return node;
+}
+
+static SetExpression* parseUnion(Parser* parser) {
+    static const char* const tokens[] = {"∪", "|"};
+    SetExpression*           node     = parseSymmetricDifference(parser);
+
+    while (node != NULL && acceptToken(parser, tokens, 2)) {
+        node = expressionUnion(node, parseSymmetricDifference(parser));
+    }
+
+    return node;
+}
+
+SetExpression* expressionParse(const char* text, const char** names,
+                               BitSet** sets, size_t setsCount) {
+    Parser parser = {text, names, sets, setsCount};
+
+    SetExpression* expression = parseUnion(&parser);
+    skipSpaces(&parser);
+    if (expression != NULL && *parser.cursor != '\0') {
+        expressionDestroy(expression);
+        expression = NULL;
+    }
+
+    return expression;
+}
+
+/* Вычисление */
+
+size_t expressionCapacity(SetExpression* expression) {
+    size_t capacity = 0;
+
+    if (expression->type == EXPRESSION_SET) {
+        capacity = expression->set->capacity;
+    } else if (expression->type == EXPRESSION_COMPLEMENT) {
+        capacity = expressionCapacity(expression->left);
+    } else {
+        size_t left  = expressionCapacity(expression->left);
+        size_t right = expressionCapacity(expression->right);
+
+        if (expression->type == EXPRESSION_INTERSECTION) {
+            capacity = left < right ? left : right;
+        } else if (expression->type == EXPRESSION_DIFFERENCE) {
+            capacity = left;
+        } else {
+            capacity = left > right ? left : right;
+        }
+    }
+
+    return capacity;
+}
+
+static size_t expressionNodeCount(SetExpression* expression) {
+    size_t count = 0;
+    if (expression != NULL) {
+        count = 1 + expressionNodeCount(expression->left) +
+                expressionNodeCount(expression->right);
+    }
+    return count;
+}
+
+static bool expressionUsesSet(SetExpression* expression, BitSet* set) {
+    bool isUsed = false;
+    if (expression != NULL) {
+        isUsed = expression->set == set ||
+                 expressionUsesSet(expression->left, set) ||
+                 expressionUsesSet(expression->right, set);
+    }
+    return isUsed;
+}
+
+static void emit(Program* program, ExpressionType type, BitSet* set,
+                 size_t capacity) {
+    Instruction* instruction = &program->code[program->length++];
+    instruction->type        = type;
+    instruction->set         = set;
+    instruction->capacity    = capacity;
+}
+
+// Постфиксная запись; правый операнд-лист читается прямо из множества
+static void compile(SetExpression* expression, Program* program) {
+    if (expression->type == EXPRESSION_SET) {
+        emit(program, EXPRESSION_SET, expression->set, 0);
+        program->depth++;
+        if (program->depth > program->maxDepth) {
+            program->maxDepth = program->depth;
+        }
+    } else if (expression->type == EXPRESSION_COMPLEMENT) {
+        compile(expression->left, program);
+        emit(program, EXPRESSION_COMPLEMENT, NULL,
+             expressionCapacity(expression->left));
+    } else if (expression->right->type == EXPRESSION_SET) {
+        compile(expression->left, program);
+        emit(program, expression->type, expression->right->set, 0);
+    } else {
+        compile(expression->left, program);
+        compile(expression->right, program);
+        emit(program, expression->type, NULL, 0);
+        program->depth--;
+    }
+}
+
+static void loadChunk(uint64_t* destination, BitSet* set, size_t start,
+                      size_t count) {
+    size_t available = 0;
+    if (start < set->blockCount) {
+        available = set->blockCount - start;
+        if (available > count) {
+            available = count;
+        }
+        memcpy(destination, bitsetBlocks(set) + start,
+               available * sizeof(uint64_t));
+    }
+    memset(destination + available, 0,
+           (count - available) * sizeof(uint64_t));
+}
+
+static void complementChunk(uint64_t* words, size_t capacity, size_t start,
+                            size_t count) {
+    size_t   last     = capacity / 64;
+    uint64_t tailMask = bitsetLastBlockMask(capacity);
+
+    for (size_t iter = 0; iter < count; iter++) {
+        size_t block = start + iter;
+        if (block < last) {
+            words[iter] = ~words[iter];
+        } else if (block == last) {
+            words[iter] = ~words[iter] & tailMask;
+        } else {
+            words[iter] = 0;
+        }
+    }
+}
+
+static void operationChunk(ExpressionType type, uint64_t* words,
+                           const uint64_t* operand, size_t count) {
+    switch (type) {
+        case EXPRESSION_UNION:
+            for (size_t iter = 0; iter < count; iter++) {
+                words[iter] |= operand[iter];
+            }
+            break;
+        case EXPRESSION_INTERSECTION:
+            for (size_t iter = 0; iter < count; iter++) {
+                words[iter] &= operand[iter];
+            }
+            break;
+        case EXPRESSION_DIFFERENCE:
+            for (size_t iter = 0; iter < count; iter++) {
+                words[iter] &= ~operand[iter];
+            }
+            break;
+        case EXPRESSION_SYMMETRIC_DIFFERENCE:
+            for (size_t iter = 0; iter < count; iter++) {
+                words[iter] ^= operand[iter];
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// Операция с множеством-листом; слова за его пределами считаются нулевыми
+static void operationWithSet(ExpressionType type, uint64_t* words, BitSet* set,
+                             size_t start, size_t count) {
+    size_t available = 0;
+    if (start < set->blockCount) {
+        available = set->blockCount - start;
+        if (available > count) {
+            available = count;
+        }
+        operationChunk(type, words, bitsetBlocks(set) + start, available);
+    }
+    if (type == EXPRESSION_INTERSECTION) {
+        memset(words + available, 0, (count - available) * sizeof(uint64_t));
+    }
+}
+
+static void runProgram(Program* program, uint64_t** slots, size_t start,
+                       size_t count) {
+    size_t top = 0;
+
+    for (size_t pc = 0; pc < program->length; pc++) {
+        Instruction* instruction = &program->code[pc];
+
+        if (instruction->type == EXPRESSION_SET) {
+            loadChunk(slots[top], instruction->set, start, count);
+            top++;
+        } else if (instruction->type == EXPRESSION_COMPLEMENT) {
+            complementChunk(slots[top - 1], instruction->capacity, start,
+                            count);
+        } else if (instruction->set != NULL) {
+            operationWithSet(instruction->type, slots[top - 1],
+                             instruction->set, start, count);
+        } else {
+            operationChunk(instruction->type, slots[top - 2], slots[top - 1],
+                           count);
+            top--;
+        }
+    }
+}
+
+/*
+ * Вычисляет выражение порциями по EXPRESSION_CHUNK_BLOCKS слов. Если result
+ * равен NULL, результат не сохраняется и возвращается только его размер.
+ */
+static int evaluate(SetExpression* expression, BitSet* result,
+                    size_t blockCount, size_t* size) {
+    // Порции слотов берутся у распределителя результата (например, арены)
+    Allocator* allocator   = allocatorResolve(result != NULL ? result->allocator
+                                                         : NULL);
+    size_t     scratchSize = 0;
+    int     status_code = 0;
+    Program program     = {NULL, 0, 0, 0};
+
+    program.code = (Instruction*)malloc(expressionNodeCount(expression) *
+                                        sizeof(Instruction));
+    if (program.code == NULL) {
+        status_code = -1;
+    } else {
+        compile(expression, &program);
+    }
+
+    // Нулевой слот пишется прямо в результат, если тот не является операндом
+    bool       writesDirectly = result != NULL &&
+                                !expressionUsesSet(expression, result);
+    uint64_t*  scratch        = NULL;
+    uint64_t** slots          = NULL;
+
+    if (status_code == 0) {
+        scratchSize = program.maxDepth * EXPRESSION_CHUNK_BLOCKS *
+                      sizeof(uint64_t);
+        scratch = (uint64_t*)allocatorAllocate(allocator, scratchSize);
+        slots = (uint64_t**)malloc(program.maxDepth * sizeof(uint64_t*));
+        if (scratch == NULL || slots == NULL) {
+            status_code = -1;
+        }
+    }
+
+    if (status_code == 0) {
+        size_t counter = 0;
+
+        for (size_t slot = 0; slot < program.maxDepth; slot++) {
+            slots[slot] = scratch + slot * EXPRESSION_CHUNK_BLOCKS;
+        }
+
+        for (size_t start = 0; start < blockCount;
+             start += EXPRESSION_CHUNK_BLOCKS) {
+            size_t count = blockCount - start;
+            if (count > EXPRESSION_CHUNK_BLOCKS) {
+                count = EXPRESSION_CHUNK_BLOCKS;
+            }
+            if (writesDirectly) {
+                slots[0] = bitsetBlocks(result) + start;
+            }
+
+            runProgram(&program, slots, start, count);
+
+            if (result != NULL && !writesDirectly) {
+                memcpy(bitsetBlocks(result) + start, slots[0],
+                       count * sizeof(uint64_t));
+            }
+            counter += popcountBlocks(slots[0], count);
+        }
+
+        *size = counter;
+    }
+
+    free(slots);
+    allocatorRelease(allocator, scratch, scratchSize);
+    free(program.code);
+
+    return status_code;
+}
+
+int expressionEvaluateInto(SetExpression* expression, BitSet* result) {
+    int status_code = 0;
+
+    if (expression != NULL && result->growable) {
+        bitsetReserve(result, expressionCapacity(expression));
+    }
+
+    if (expression == NULL || bitsetBlocks(result) == NULL ||
+        result->capacity < expressionCapacity(expression)) {
+        status_code = -1;
+    } else {
+        size_t size = 0;
+        status_code = evaluate(expression, result, result->blockCount, &size);
+        if (status_code == 0) {
+            result->size = size;
+        }
+        bitsetBlocksChanged(result, 0, result->blockCount);
+    }
+
+    return status_code;
+}
+
+BitSet expressionEvaluate(SetExpression* expression) {
+    return expressionEvaluateWith(expression, NULL);
+}
+
+BitSet expressionEvaluateWith(SetExpression* expression, Allocator* allocator) {
+    size_t capacity = 0;
+    if (expression != NULL) {
+        capacity = expressionCapacity(expression);
+    }
+
+    BitSet result = bitsetCreateWith(capacity, allocator);
+    expressionEvaluateInto(expression, &result);
+
+    return result;
+}
+
+size_t expressionCount(SetExpression* expression) {
+    size_t size = 0;
+    if (expression != NULL) {
+        evaluate(expression, NULL, expressionCapacity(expression) / 64 + 1,
+                 &size);
+    }
+
+    return size;
+}
@@ -0,0 +1,48 @@
+#ifndef EXPRESSION_H
+#define EXPRESSION_H
+
+#include <stddef.h>
+
+#include "../bitset/bitset.h"
+
+typedef enum {
+    EXPRESSION_SET,                      // Операнд-множество
+    EXPRESSION_COMPLEMENT,               // ¬X
+    EXPRESSION_UNION,                    // X ∪ Y
+    EXPRESSION_INTERSECTION,             // X ∩ Y
+    EXPRESSION_DIFFERENCE,               // X - Y
+    EXPRESSION_SYMMETRIC_DIFFERENCE      // X Δ Y
+} ExpressionType;
+
+typedef struct SetExpression {
+    ExpressionType        type;
+    BitSet*               set;    // Множество для EXPRESSION_SET
+    struct SetExpression* left;   // Единственный операнд дополнения
+    struct SetExpression* right;
+} SetExpression;
+
+/* Построение дерева выражения (узлы-операнды переходят во владение нового
+ * узла; при ошибке выделения памяти возвращается NULL) */
+SetExpression* expressionSet(BitSet* set);
+SetExpression* expressionComplement(SetExpression* operand);
+SetExpression* expressionUnion(SetExpression* left, SetExpression* right);
+SetExpression* expressionIntersection(SetExpression* left,
+                                      SetExpression* right);
+SetExpression* expressionDifference(SetExpression* left, SetExpression* right);
+SetExpression* expressionSymmetricDifference(SetExpression* left,
+                                             SetExpression* right);
+void expressionDestroy(SetExpression* expression);
+
+/* Разбор строки вида "A - (B Δ C) ∪ ((¬D ∩ B) - A)". Операции: ¬ ~ !,
+ * ∩ &, - \, Δ ^, ∪ | (в порядке убывания приоритета) */
+SetExpression* expressionParse(const char* text, const char** names,
+                               BitSet** sets, size_t setsCount);
+
+/* Вычисление за один проход по словам без промежуточных множеств */
+size_t expressionCapacity(SetExpression* expression);
+int expressionEvaluateInto(SetExpression* expression, BitSet* result);
+BitSet expressionEvaluate(SetExpression* expression);
+BitSet expressionEvaluateWith(SetExpression* expression, Allocator* allocator);
+size_t expressionCount(SetExpression* expression);
+
+#endif
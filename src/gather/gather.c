@@ -0,0 +1,187 @@
+#include "gather.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define GATHER_X86 1
+#endif
+
+// Предвыборка слова элемента, который будет проверен через столько шагов:
+// промахи соседних элементов пачки перекрываются вместо ожидания по одному
+#define GATHER_PREFETCH_DISTANCE 32
+
+typedef void (*GatherFunction)(const uint64_t* words, const int* ids,
+                               size_t count, uint64_t* out);
+
+static void gatherPrefetch(const uint64_t* words, const int* ids,
+                           size_t count, size_t iter) {
+    if (iter + GATHER_PREFETCH_DISTANCE < count) {
+        __builtin_prefetch(words + ids[iter + GATHER_PREFETCH_DISTANCE] / 64);
+    }
+}
+
+// Биты элементов [from, count) по одному; out уже обнулён
+static void gatherRange(const uint64_t* words, const int* ids, size_t from,
+                        size_t count, uint64_t* out) {
+    for (size_t iter = from; iter < count; iter++) {
+        size_t id = (size_t)ids[iter];
+        out[iter / 64] |= ((words[id / 64] >> (id % 64)) & 1) << (iter % 64);
+    }
+}
+
+static void gatherPortable(const uint64_t* words, const int* ids,
+                           size_t count, uint64_t* out) {
+    size_t iter = 0;
+
+    for (; iter + GATHER_PREFETCH_DISTANCE < count; iter++) {
+        size_t id = (size_t)ids[iter];
+
+        __builtin_prefetch(words + ids[iter + GATHER_PREFETCH_DISTANCE] / 64);
+        out[iter / 64] |= ((words[id / 64] >> (id % 64)) & 1) << (iter % 64);
+    }
+    gatherRange(words, ids, iter, count, out);
+}
+
+#ifdef GATHER_X86
+
+/*
+ * Четыре слова собираются одной инструкцией, нужный бит каждого
+ * сдвигается в знаковый разряд и забирается movemask.
+ */
+__attribute__((target("avx2"))) static void gatherAvx2(
+    const uint64_t* words, const int* ids, size_t count, uint64_t* out) {
+    const __m128i lowMask = _mm_set1_epi32(63);
+    const __m256i top     = _mm256_set1_epi64x(63);
+    size_t        iter    = 0;
+
+    for (; iter + 4 <= count; iter += 4) {
+        for (size_t lane = 0; lane < 4; lane++) {
+            gatherPrefetch(words, ids, count, iter + lane);
+        }
+
+        __m128i  id     = _mm_loadu_si128((const __m128i*)(ids + iter));
+        __m256i  word   = _mm256_i32gather_epi64(
+            (const long long*)words, _mm_srli_epi32(id, 6), 8);
+        __m256i  shift  = _mm256_sub_epi64(
+            top, _mm256_cvtepi32_epi64(_mm_and_si128(id, lowMask)));
+        unsigned result = (unsigned)_mm256_movemask_pd(
+            _mm256_castsi256_pd(_mm256_sllv_epi64(word, shift)));
+
+        out[iter / 64] |= (uint64_t)result << (iter % 64);
+    }
+    gatherRange(words, ids, iter, count, out);
+}
+
+__attribute__((target("avx512f"))) static void gatherAvx512(
+    const uint64_t* words, const int* ids, size_t count, uint64_t* out) {
+    const __m256i lowMask = _mm256_set1_epi32(63);
+    const __m512i one     = _mm512_set1_epi64(1);
+    size_t        iter    = 0;
+
+    for (; iter + 8 <= count; iter += 8) {
+        for (size_t lane = 0; lane < 8; lane++) {
+            gatherPrefetch(words, ids, count, iter + lane);
+        }
+
+        __m256i  id     = _mm256_loadu_si256((const __m256i*)(ids + iter));
+        __m512i  word   = _mm512_i32gather_epi64(_mm256_srli_epi32(id, 6),
+                                                 (const void*)words, 8);
+        __m512i  shift  = _mm512_cvtepi32_epi64(_mm256_and_si256(id, lowMask));
+        __mmask8 result = _mm512_test_epi64_mask(
+            _mm512_srlv_epi64(word, shift), one);
+
+        out[iter / 64] |= (uint64_t)result << (iter % 64);
+    }
+    gatherRange(words, ids, iter, count, out);
+}
+
+#endif
+
+static bool gatherKernelSupported(GatherKernel kernel) {
+    bool isSupported = false;
+
+    switch (kernel) {
+        case GATHER_PORTABLE:
+            isSupported = true;
+            break;
+#ifdef GATHER_X86
+        case GATHER_AVX2:
+            isSupported = __builtin_cpu_supports("avx2");
+            break;
+        case GATHER_AVX512:
+            isSupported = __builtin_cpu_supports("avx512f");
+            break;
+#endif
+        default:
+            break;
+    }
+
+    return isSupported;
+}
+
+static GatherKernel gatherDetectKernel(void) {
+    GatherKernel kernel = GATHER_PORTABLE;
+
+    if (gatherKernelSupported(GATHER_AVX512)) {
+        kernel = GATHER_AVX512;
+    } else if (gatherKernelSupported(GATHER_AVX2)) {
+        kernel = GATHER_AVX2;
+    }
+
+    return kernel;
+}
+
+// Выбранная реализация; определяется при первом вызове и публикуется
+// атомарно, как в popcount: activeFunction записывается последней
+static _Atomic GatherKernel   activeKernel   = GATHER_AUTO;
+static _Atomic GatherFunction activeFunction = NULL;
+
+void gatherBits(const uint64_t* words, const int* ids, size_t count,
+                uint64_t* out) {
+    GatherFunction function =
+        atomic_load_explicit(&activeFunction, memory_order_acquire);
+
+    if (function == NULL) {
+        gatherSelectKernel(GATHER_AUTO);
+        function = atomic_load_explicit(&activeFunction, memory_order_acquire);
+    }
+
+    memset(out, 0, (count + 63) / 64 * sizeof(uint64_t));
+    function(words, ids, count, out);
+}
+
+int gatherSelectKernel(GatherKernel kernel) {
+    int status_code = 0;
+
+    if (kernel == GATHER_AUTO) {
+        kernel = gatherDetectKernel();
+    }
+
+    if (gatherKernelSupported(kernel)) {
+        GatherFunction function = gatherPortable;
+#ifdef GATHER_X86
+        if (kernel == GATHER_AVX2) {
+            function = gatherAvx2;
+        } else if (kernel == GATHER_AVX512) {
+            function = gatherAvx512;
+        }
+#endif
+        atomic_store_explicit(&activeKernel, kernel, memory_order_relaxed);
+        atomic_store_explicit(&activeFunction, function, memory_order_release);
+    } else {
+        status_code = -1;
+    }
+
+    return status_code;
+}
+
+GatherKernel gatherActiveKernel(void) {
+    if (atomic_load_explicit(&activeFunction, memory_order_acquire) == NULL) {
+        gatherSelectKernel(GATHER_AUTO);
+    }
+
+    return atomic_load_explicit(&activeKernel, memory_order_relaxed);
+}
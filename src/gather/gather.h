@@ -0,0 +1,25 @@
+#ifndef GATHER_H
+#define GATHER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Варианты реализации выборки битов */
+typedef enum {
+    GATHER_AUTO,       // Выбор по возможностям процессора
+    GATHER_PORTABLE,   // Поэлементная выборка с программной предвыборкой
+    GATHER_AVX2,       // vpgatherdq по 4 слова
+    GATHER_AVX512      // vpgatherdq по 8 слов
+} GatherKernel;
+
+/*
+ * Биты с номерами ids[0..count) массива слов: бит iter % 64 слова
+ * out[iter / 64] равен биту ids[iter]. out содержит (count + 63) / 64
+ * слов. Номера не проверяются и обязаны быть неотрицательными.
+ */
+void gatherBits(const uint64_t* words, const int* ids, size_t count,
+                uint64_t* out);
+int gatherSelectKernel(GatherKernel kernel);
+GatherKernel gatherActiveKernel(void);
+
+#endif
@@ -1,22 +1,135 @@
 #include "errors.h"
 
-int memoryIsAllocated(uint64_t* arr) {
+#include <stdatomic.h>
+#include <time.h>
+
+static _Thread_local ErrorCode lastError = ERROR_NONE;
+
+static ErrorCallback    errorCallback = NULL;
+static void*            errorContext = NULL;
+static unsigned int     errorLimit = 0;
+
+// Счётчики общие для всех потоков
+static atomic_size_t    errorTotal[ERROR_CODE_COUNT];
+static atomic_size_t    errorSuppressed[ERROR_CODE_COUNT];
+static atomic_uint      errorWindowCount[ERROR_CODE_COUNT];
+static atomic_llong     errorWindowStart[ERROR_CODE_COUNT];
+
+/*
+ * Окно ограничения — одна секунда. Сброс окна между потоками не
+ * согласован строго, поэтому на границе секунды обработчик может быть
+ * вызван на несколько раз больше лимита.
+ */
+static int errorPassesLimit(ErrorCode code) {
+    int       passes = 1;
+    long long now    = (long long)time(NULL);
+
+    if (errorLimit != 0) {
+        if (atomic_load_explicit(&errorWindowStart[code],
+                                 memory_order_relaxed) != now) {
+            atomic_store_explicit(&errorWindowStart[code], now,
+                                  memory_order_relaxed);
+            atomic_store_explicit(&errorWindowCount[code], 0,
+                                  memory_order_relaxed);
+        }
+        passes = atomic_fetch_add_explicit(&errorWindowCount[code], 1,
+                                           memory_order_relaxed) < errorLimit;
+    }
+
+    return passes;
+}
+
+int errorReport(ErrorCode code, long long value, size_t limit) {
+    lastError = code;
+    atomic_fetch_add_explicit(&errorTotal[code], 1, memory_order_relaxed);
+
+    if (errorCallback != NULL) {
+        if (errorPassesLimit(code)) {
+            errorCallback(code, value, limit, errorContext);
+        } else {
+            atomic_fetch_add_explicit(&errorSuppressed[code], 1,
+                                      memory_order_relaxed);
+        }
+    }
+
+    return -1;
+}
+
+int memoryIsAllocated(const void* arr) {
     int status_code = 0;
     if (arr == NULL) {
-        printf("Не удалось выделить память\n");
-        status_code = -1;
+        status_code = errorReport(ERROR_OUT_OF_MEMORY, 0, 0);
     }
     return status_code;
 }
 
-int elementCanBeCreated(int element, int capacity) {
+int elementCanBeCreated(int element, size_t capacity) {
     int status_code = 0;
-    if (element < 0 || capacity < element) {
-        printf(
-            "Число %d выходит за границы допустимых значений множества (0 <= x "
-            "<= %d)\n",
-            element, capacity);
-        status_code = -1;
+    if (element < 0 || capacity < (size_t)element) {
+        status_code = errorReport(ERROR_OUT_OF_RANGE, element, capacity);
     }
     return status_code;
 }
+
+ErrorCode errorLast(void) {
+    return lastError;
+}
+
+void errorClear(void) {
+    lastError = ERROR_NONE;
+}
+
+const char* errorMessage(ErrorCode code) {
+    const char* message = "Неизвестная ошибка";
+
+    if (code == ERROR_NONE) {
+        message = "Нет ошибки";
+    } else if (code == ERROR_OUT_OF_RANGE) {
+        message = "Число выходит за границы допустимых значений множества";
+    } else if (code == ERROR_OUT_OF_MEMORY) {
+        message = "Не удалось выделить память";
+    } else if (code == ERROR_IO) {
+        message = "Ошибка чтения или записи файла";
+    } else if (code == ERROR_FORMAT) {
+        message = "Неверный формат данных множества";
+    }
+
+    return message;
+}
+
+void errorSetCallback(ErrorCallback callback, void* context,
+                      unsigned int limitPerSecond) {
+    errorCallback = callback;
+    errorContext = context;
+    errorLimit = limitPerSecond;
+}
+
+void errorPrintCallback(ErrorCode code, long long value, size_t limit,
+                        void* context) {
+    (void)context;
+    if (code == ERROR_OUT_OF_RANGE) {
+        fprintf(stderr,
+                "Число %lld выходит за границы допустимых значений множества "
+                "(0 <= x <= %zu)\n",
+                value, limit);
+    } else {
+        fprintf(stderr, "%s\n", errorMessage(code));
+    }
+}
+
+size_t errorCount(ErrorCode code) {
+    return atomic_load_explicit(&errorTotal[code], memory_order_relaxed);
+}
+
+size_t errorSuppressedCount(ErrorCode code) {
+    return atomic_load_explicit(&errorSuppressed[code], memory_order_relaxed);
+}
+
+void errorResetCounters(void) {
+    for (int code = 0; code < ERROR_CODE_COUNT; code++) {
+        atomic_store_explicit(&errorTotal[code], 0, memory_order_relaxed);
+        atomic_store_explicit(&errorSuppressed[code], 0, memory_order_relaxed);
+        atomic_store_explicit(&errorWindowCount[code], 0, memory_order_relaxed);
+        atomic_store_explicit(&errorWindowStart[code], 0, memory_order_relaxed);
+    }
+}
@@ -5,7 +5,43 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-int memoryIsAllocated(uint64_t* arr);
-int elementCanBeCreated(int element, int capacity);
+typedef enum {
+    ERROR_NONE = 0,
+    ERROR_OUT_OF_RANGE,    // Элемент вне 0..capacity
+    ERROR_OUT_OF_MEMORY,   // Не удалось выделить память
+    ERROR_IO,              // Ошибка чтения или записи файла
+    ERROR_FORMAT,          // Неверный формат или контрольная сумма данных
+    ERROR_CODE_COUNT
+} ErrorCode;
 
-#endif
\ No newline at end of file
+/*
+ * Обработчик ошибок: value — ошибочное значение, limit — допустимая
+ * граница (для ERROR_OUT_OF_RANGE).
+ */
+typedef void (*ErrorCallback)(ErrorCode code, long long value, size_t limit,
+                              void* context);
+
+/* Проверки, которые возвращают 0 или -1 и фиксируют ошибку */
+int memoryIsAllocated(const void* arr);
+int elementCanBeCreated(int element, size_t capacity);
+int errorReport(ErrorCode code, long long value, size_t limit);
+
+/* Последняя ошибка текущего потока */
+ErrorCode errorLast(void);
+void errorClear(void);
+const char* errorMessage(ErrorCode code);
+
+/*
+ * Обработчик вызывается не чаще limitPerSecond раз в секунду для каждого
+ * кода ошибки (0 — без ограничения), остальные ошибки только считаются.
+ * По умолчанию обработчика нет и ошибки не печатаются.
+ */
+void errorSetCallback(ErrorCallback callback, void* context,
+                      unsigned int limitPerSecond);
+void errorPrintCallback(ErrorCode code, long long value, size_t limit,
+                        void* context);
+size_t errorCount(ErrorCode code);
+size_t errorSuppressedCount(ErrorCode code);
+void errorResetCounters(void);
+
+#endif
@@ -1,6 +1,7 @@
 #include <stdio.h>
 
 #include "bitset/bitset.h"
+#include "expression/expression.h"
 #include "handlers/errors.h"
 #include "output/output.h"
 
@@ -23,17 +24,22 @@ void example_op() {
     int elementsD[5] = {3, 4, 6, 7, 8};
     bitsetAddMany(&D, elementsD, 5);
 
-    // Операции по заданному выражению
-    BitSet _1 = getSetsSymmetricDifference(&B, &C);   // B Δ C
-    BitSet _2 = getSetsDifference(&A, &_1);           // A - (B Δ C)
-    BitSet _3 = getComplementSet(&D);                 // ¬D
-    BitSet _4 = getSetsIntersection(&_3, &B);         // (¬D ∩ B)
-    BitSet _5 = getSetsDifference(&_4, &A);           // ((¬D ∩ B) - A)
-    BitSet _6 = getSetsUnion(&_2, &_5);               // A - (B Δ C) ∪ ((¬D ∩ B) - A)
-    BitSet _7 = getSetsIntersection(&C, &D);          // (C ∩ D)
-    BitSet Result = getSetsUnion(&_6, &_7);           // A - (B Δ C) ∪ ((¬D ∩ B) - A) ∪ (C ∩ D)
-
-    printSet("Result", Result.bits, Result.capacity);
+    // Вычисление заданного выражения за один проход
+    const char* names[4] = {"A", "B", "C", "D"};
+    BitSet*     sets[4]  = {&A, &B, &C, &D};
+
+    SetExpression* expression = expressionParse(
+        "A - (B Δ C) ∪ ((¬D ∩ B) - A) ∪ (C ∩ D)", names, sets, 4);
+    BitSet Result = expressionEvaluate(expression);
+
+    printSet("Result", &Result);
+
+    expressionDestroy(expression);
+    bitsetDestroy(&A);
+    bitsetDestroy(&B);
+    bitsetDestroy(&C);
+    bitsetDestroy(&D);
+    bitsetDestroy(&Result);
 }
 
 int main() {
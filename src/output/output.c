@@ -1,32 +1,89 @@
 #include <stdio.h>
+#include <string.h>
 
 #include "output.h"
 
-void printSet(const char* setName, uint64_t* bits, int capacity) {
+#define OUTPUT_BUFFER_SIZE 65536  // Размер буфера вывода в байтах
+#define OUTPUT_DECODE_COUNT 1024  // Элементов, извлекаемых за один вызов
+
+typedef struct {
+    char   data[OUTPUT_BUFFER_SIZE];
+    size_t length;
+} OutputBuffer;
+
+static void bufferFlush(OutputBuffer* buffer) {
+    fwrite(buffer->data, 1, buffer->length, stdout);
+    buffer->length = 0;
+}
+
+static void bufferReserve(OutputBuffer* buffer, size_t count) {
+    if (buffer->length + count > OUTPUT_BUFFER_SIZE) {
+        bufferFlush(buffer);
+    }
+}
+
+static void bufferAppendElement(OutputBuffer* buffer, int element) {
+    char     digits[12];
+    size_t   count = 0;
+    unsigned value = (unsigned)element;
+
+    do {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+
+    bufferReserve(buffer, count + 1);
+    while (count > 0) {
+        buffer->data[buffer->length++] = digits[--count];
+    }
+    buffer->data[buffer->length++] = ' ';
+}
+
+void printSet(const char* setName, BitSet* set) {
+    OutputBuffer buffer;
+    int          elements[OUTPUT_DECODE_COUNT];
+    size_t       count = OUTPUT_DECODE_COUNT;
+    int          from  = 0;
+
+    buffer.length = 0;
     printf("%s:\n", setName);
 
-    for (int iter = 0; iter <= capacity; iter++) {
-        if (((bits[iter / 64]) >> (63 - iter)) & 1) {
-            printf("%d ", iter);
+    while (count == OUTPUT_DECODE_COUNT) {
+        count = bitsetToArray(set, from, elements, OUTPUT_DECODE_COUNT);
+        for (size_t iter = 0; iter < count; iter++) {
+            bufferAppendElement(&buffer, elements[iter]);
+        }
+        if (count > 0) {
+            from = elements[count - 1] + 1;
         }
     }
 
-    printf("\n");
+    bufferReserve(&buffer, 1);
+    buffer.data[buffer.length++] = '\n';
+    bufferFlush(&buffer);
 }
 
-void printBitViewOfSet(const char* setName, uint64_t* bits, int blockCount) {
+void printBitViewOfSet(const char* setName, BitSet* set) {
+    OutputBuffer buffer;
+    uint64_t*    bits = bitsetBlocks(set);
+
+    buffer.length = 0;
     printf("%s:\n", setName);
 
-    for (int iter = 0; iter < blockCount * 64; iter++) {
-        if (iter == 64) {
-            printf("\n");
-        }
-        if (((bits[iter / 64]) >> (63 - iter)) & 1) {
-            printf("1");
-        } else {
-            printf("0");
+    // Каждый блок — строка из 64 символов, элементы по возрастанию
+    for (size_t block = 0; block < set->blockCount; block++) {
+        uint64_t word = bits[block];
+
+        bufferReserve(&buffer, 65);
+        char* line = buffer.data + buffer.length;
+        memset(line, '0', 64);
+        while (word != 0) {
+            line[__builtin_ctzll(word)] = '1';
+            word &= word - 1;
         }
+        line[64] = '\n';
+        buffer.length += 65;
     }
 
-    printf("\n");
+    bufferFlush(&buffer);
 }
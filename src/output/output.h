@@ -3,7 +3,9 @@
 
 #include <stdint.h>
 
-void printSet(const char* setName, uint64_t* bits, int capacity);
-void printBitViewOfSet(const char* setName, uint64_t* bits, int blockCount);
+#include "../bitset/bitset.h"
+
+void printSet(const char* setName, BitSet* set);
+void printBitViewOfSet(const char* setName, BitSet* set);
 
 #endif
@@ -0,0 +1,190 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "parallel.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <unistd.h>
+
+typedef struct {
+    ParallelTask task;
+    void*        context;
+    size_t       blockCount;
+    size_t       partSize;
+} ParallelJob;
+
+static pthread_t       workers[PARALLEL_MAX_THREADS];
+static _Atomic size_t  threadCount = 1;  // Меняется только под dispatchLock
+static size_t          threshold = PARALLEL_DEFAULT_THRESHOLD;
+
+// dispatchLock допускает в пул одно задание и не даёт запуску и остановке
+// пула пересечься с ним; остальное защищено stateLock
+static pthread_mutex_t dispatchLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t stateLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  jobReady = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t  jobDone = PTHREAD_COND_INITIALIZER;
+static ParallelJob     job;
+static unsigned long   generation = 0;
+static unsigned long   startGeneration = 0;  // Поколение при запуске пула
+static size_t          pending = 0;
+static bool            stopping = false;
+
+// Часть вызывается и с пустым диапазоном, чтобы записать свой результат
+static void runPart(ParallelJob* current, size_t part) {
+    size_t fromBlock = part * current->partSize;
+    size_t toBlock   = fromBlock + current->partSize;
+
+    if (fromBlock > current->blockCount) {
+        fromBlock = current->blockCount;
+    }
+    if (toBlock > current->blockCount) {
+        toBlock = current->blockCount;
+    }
+    current->task(fromBlock, toBlock, part, current->context);
+}
+
+static void* workerLoop(void* argument) {
+    size_t        part = (size_t)(uintptr_t)argument;
+    unsigned long seen = 0;
+
+    // Поток мог запуститься уже после выдачи первого задания
+    pthread_mutex_lock(&stateLock);
+    seen = startGeneration;
+
+    while (true) {
+        while (generation == seen && !stopping) {
+            pthread_cond_wait(&jobReady, &stateLock);
+        }
+        if (stopping) {
+            break;
+        }
+
+        seen = generation;
+        ParallelJob current = job;
+        pthread_mutex_unlock(&stateLock);
+
+        runPart(&current, part);
+
+        pthread_mutex_lock(&stateLock);
+        pending--;
+        if (pending == 0) {
+            pthread_cond_signal(&jobDone);
+        }
+    }
+
+    pthread_mutex_unlock(&stateLock);
+
+    return NULL;
+}
+
+// Останавливает рабочие потоки 1..count-1; вызывается под dispatchLock
+static void workersStop(size_t count) {
+    pthread_mutex_lock(&stateLock);
+    stopping = true;
+    pthread_cond_broadcast(&jobReady);
+    pthread_mutex_unlock(&stateLock);
+
+    for (size_t part = 1; part < count; part++) {
+        pthread_join(workers[part], NULL);
+    }
+
+    pthread_mutex_lock(&stateLock);
+    stopping = false;
+    pthread_mutex_unlock(&stateLock);
+}
+
+int parallelInit(size_t count) {
+    int    status_code = 0;
+    size_t created     = 1;
+
+    if (count == 0) {
+        long processors = sysconf(_SC_NPROCESSORS_ONLN);
+        count = processors > 0 ? (size_t)processors : 1;
+    }
+    if (count > PARALLEL_MAX_THREADS) {
+        count = PARALLEL_MAX_THREADS;
+    }
+
+    // Задания не выдаются, пока пул не собран целиком: число потоков
+    // публикуется один раз, после запуска всех рабочих
+    pthread_mutex_lock(&dispatchLock);
+    workersStop(atomic_load(&threadCount));
+    atomic_store(&threadCount, 1);
+
+    pthread_mutex_lock(&stateLock);
+    startGeneration = generation;
+    pthread_mutex_unlock(&stateLock);
+
+    // Поток 0 — вызывающий, рабочие потоки выполняют части 1..count-1
+    for (size_t part = 1; part < count && status_code == 0; part++) {
+        if (pthread_create(&workers[part], NULL, workerLoop,
+                           (void*)(uintptr_t)part) != 0) {
+            status_code = -1;
+        } else {
+            created = part + 1;
+        }
+    }
+
+    if (status_code == 0) {
+        atomic_store(&threadCount, created);
+    } else {
+        workersStop(created);
+    }
+    pthread_mutex_unlock(&dispatchLock);
+
+    return status_code;
+}
+
+void parallelShutdown(void) {
+    pthread_mutex_lock(&dispatchLock);
+    workersStop(atomic_load(&threadCount));
+    atomic_store(&threadCount, 1);
+    pthread_mutex_unlock(&dispatchLock);
+}
+
+size_t parallelThreadCount(void) {
+    return atomic_load(&threadCount);
+}
+
+void parallelSetThreshold(size_t blockCount) {
+    threshold = blockCount;
+}
+
+size_t parallelFor(size_t blockCount, ParallelTask task, void* context) {
+    size_t parts = 1;
+
+    if (atomic_load(&threadCount) <= 1 || blockCount < threshold ||
+        pthread_mutex_trylock(&dispatchLock) != 0) {
+        task(0, blockCount, 0, context);
+    } else {
+        // Под dispatchLock число потоков не меняется
+        parts = atomic_load(&threadCount);
+
+        size_t partSize = (blockCount + parts - 1) / parts;
+
+        partSize = (partSize + PARALLEL_LINE_BLOCKS - 1) /
+                   PARALLEL_LINE_BLOCKS * PARALLEL_LINE_BLOCKS;
+
+        ParallelJob current = {task, context, blockCount, partSize};
+
+        pthread_mutex_lock(&stateLock);
+        job = current;
+        pending = parts - 1;
+        generation++;
+        pthread_cond_broadcast(&jobReady);
+        pthread_mutex_unlock(&stateLock);
+
+        runPart(&current, 0);
+
+        pthread_mutex_lock(&stateLock);
+        while (pending > 0) {
+            pthread_cond_wait(&jobDone, &stateLock);
+        }
+        pthread_mutex_unlock(&stateLock);
+
+        pthread_mutex_unlock(&dispatchLock);
+    }
+
+    return parts;
+}
@@ -0,0 +1,38 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define PARALLEL_MAX_THREADS 64
+#define PARALLEL_LINE_BLOCKS 8                  // Слов в строке кэша
+#define PARALLEL_DEFAULT_THRESHOLD (1 << 16)    // Слов; меньше — без потоков
+
+/*
+ * Обрабатывает слова [fromBlock, toBlock). part — номер части от 0 до
+ * PARALLEL_MAX_THREADS - 1, по нему задача складывает частичный результат.
+ */
+typedef void (*ParallelTask)(size_t fromBlock, size_t toBlock, size_t part,
+                             void* context);
+
+/*
+ * Постоянный пул потоков. threadCount учитывает вызывающий поток,
+ * 0 — по числу процессоров. Пока пул не запущен, всё выполняется
+ * последовательно. Запуск и остановка дожидаются текущего задания и могут
+ * идти одновременно с parallelFor в других потоках, но не из самой задачи.
+ */
+int parallelInit(size_t threadCount);
+void parallelShutdown(void);
+size_t parallelThreadCount(void);
+void parallelSetThreshold(size_t blockCount);
+
+/*
+ * Делит [0, blockCount) на части, кратные строке кэша, и выполняет их на
+ * всех потоках пула. Малые диапазоны, а также вызовы при занятом пуле
+ * (в том числе из самой задачи) выполняются одной частью в текущем потоке.
+ * Возвращает число частей: задача вызывается для каждой из них, в том
+ * числе с пустым диапазоном.
+ */
+size_t parallelFor(size_t blockCount, ParallelTask task, void* context);
+
+#endif
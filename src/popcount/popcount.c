@@ -0,0 +1,422 @@
+#include "popcount.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define POPCOUNT_X86 1
+#endif
+
+typedef size_t (*PopcountFunction)(const uint64_t* blocks, size_t count);
+
+typedef size_t (*PopcountAndFunction)(const uint64_t* blocksA,
+                                      const uint64_t* blocksB, size_t count);
+
+// SWAR-подсчёт битов одного слова
+static size_t popcountWord(uint64_t word) {
+    word = word - ((word >> 1) & 0x5555555555555555ULL);
+    word = (word & 0x3333333333333333ULL) +
+           ((word >> 2) & 0x3333333333333333ULL);
+    word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (size_t)((word * 0x0101010101010101ULL) >> 56);
+}
+
+static size_t popcountPortable(const uint64_t* blocks, size_t count) {
+    size_t counter = 0;
+
+    for (size_t block = 0; block < count; block++) {
+        counter += popcountWord(blocks[block]);
+    }
+
+    return counter;
+}
+
+static size_t popcountAndPortable(const uint64_t* blocksA,
+                                  const uint64_t* blocksB, size_t count) {
+    size_t counter = 0;
+
+    for (size_t block = 0; block < count; block++) {
+        counter += popcountWord(blocksA[block] & blocksB[block]);
+    }
+
+    return counter;
+}
+
+#ifdef POPCOUNT_X86
+
+__attribute__((target("popcnt"))) static size_t popcountHardware(
+    const uint64_t* blocks, size_t count) {
+    // Четыре независимых счётчика, чтобы не упираться в задержку popcnt
+    uint64_t counters[4] = {0, 0, 0, 0};
+    size_t   block       = 0;
+
+    for (; block + 4 <= count; block += 4) {
+        counters[0] += (uint64_t)__builtin_popcountll(blocks[block]);
+        counters[1] += (uint64_t)__builtin_popcountll(blocks[block + 1]);
+        counters[2] += (uint64_t)__builtin_popcountll(blocks[block + 2]);
+        counters[3] += (uint64_t)__builtin_popcountll(blocks[block + 3]);
+    }
+    for (; block < count; block++) {
+        counters[0] += (uint64_t)__builtin_popcountll(blocks[block]);
+    }
+
+    return (size_t)(counters[0] + counters[1] + counters[2] + counters[3]);
+}
+
+__attribute__((target("popcnt"))) static size_t popcountAndHardware(
+    const uint64_t* blocksA, const uint64_t* blocksB, size_t count) {
+    uint64_t counters[4] = {0, 0, 0, 0};
+    size_t   block       = 0;
+
+    for (; block + 4 <= count; block += 4) {
+        for (size_t iter = 0; iter < 4; iter++) {
+            counters[iter] += (uint64_t)__builtin_popcountll(
+                blocksA[block + iter] & blocksB[block + iter]);
+        }
+    }
+    for (; block < count; block++) {
+        counters[0] += (uint64_t)__builtin_popcountll(blocksA[block] &
+                                                      blocksB[block]);
+    }
+
+    return (size_t)(counters[0] + counters[1] + counters[2] + counters[3]);
+}
+
+// Подсчёт битов в каждом 64-битном слове вектора через таблицу полубайтов
+__attribute__((target("avx2"))) static __m256i popcountVector256(__m256i v) {
+    const __m256i lookup = _mm256_setr_epi8(
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3,
+        1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i lowMask = _mm256_set1_epi8(0x0F);
+
+    __m256i low  = _mm256_and_si256(v, lowMask);
+    __m256i high = _mm256_and_si256(_mm256_srli_epi32(v, 4), lowMask);
+    __m256i sum  = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, low),
+                                   _mm256_shuffle_epi8(lookup, high));
+
+    return _mm256_sad_epu8(sum, _mm256_setzero_si256());
+}
+
+// Сумматор с сохранением переноса: (high, low) = a + b + c
+__attribute__((target("avx2"))) static void carrySaveAdd256(
+    __m256i* high, __m256i* low, __m256i a, __m256i b, __m256i c) {
+    __m256i partial = _mm256_xor_si256(a, b);
+    *high = _mm256_or_si256(_mm256_and_si256(a, b),
+                            _mm256_and_si256(partial, c));
+    *low  = _mm256_xor_si256(partial, c);
+}
+
+__attribute__((target("avx2"))) static __m256i loadVector256(
+    const uint64_t* blocks, size_t vector) {
+    return _mm256_loadu_si256((const __m256i*)(blocks + vector * 4));
+}
+
+__attribute__((target("avx2,popcnt"))) static size_t popcountAvx2(
+    const uint64_t* blocks, size_t count) {
+    __m256i total    = _mm256_setzero_si256();
+    __m256i ones     = _mm256_setzero_si256();
+    __m256i twos     = _mm256_setzero_si256();
+    __m256i fours    = _mm256_setzero_si256();
+    __m256i eights   = _mm256_setzero_si256();
+    __m256i sixteens = _mm256_setzero_si256();
+    __m256i twosA, twosB, foursA, foursB, eightsA, eightsB;
+
+    size_t vectors = count / 4;
+    size_t vector  = 0;
+
+    // Дерево сумматоров Harley-Seal: один popcount на 16 векторов
+    for (; vector + 16 <= vectors; vector += 16) {
+        carrySaveAdd256(&twosA, &ones, ones, loadVector256(blocks, vector),
+                        loadVector256(blocks, vector + 1));
+        carrySaveAdd256(&twosB, &ones, ones, loadVector256(blocks, vector + 2),
+                        loadVector256(blocks, vector + 3));
+        carrySaveAdd256(&foursA, &twos, twos, twosA, twosB);
+        carrySaveAdd256(&twosA, &ones, ones, loadVector256(blocks, vector + 4),
+                        loadVector256(blocks, vector + 5));
+        carrySaveAdd256(&twosB, &ones, ones, loadVector256(blocks, vector + 6),
+                        loadVector256(blocks, vector + 7));
+        carrySaveAdd256(&foursB, &twos, twos, twosA, twosB);
+        carrySaveAdd256(&eightsA, &fours, fours, foursA, foursB);
+        carrySaveAdd256(&twosA, &ones, ones, loadVector256(blocks, vector + 8),
+                        loadVector256(blocks, vector + 9));
+        carrySaveAdd256(&twosB, &ones, ones, loadVector256(blocks, vector + 10),
+                        loadVector256(blocks, vector + 11));
+        carrySaveAdd256(&foursA, &twos, twos, twosA, twosB);
+        carrySaveAdd256(&twosA, &ones, ones, loadVector256(blocks, vector + 12),
+                        loadVector256(blocks, vector + 13));
+        carrySaveAdd256(&twosB, &ones, ones, loadVector256(blocks, vector + 14),
+                        loadVector256(blocks, vector + 15));
+        carrySaveAdd256(&foursB, &twos, twos, twosA, twosB);
+        carrySaveAdd256(&eightsB, &fours, fours, foursA, foursB);
+        carrySaveAdd256(&sixteens, &eights, eights, eightsA, eightsB);
+
+        total = _mm256_add_epi64(total, popcountVector256(sixteens));
+    }
+
+    total = _mm256_slli_epi64(total, 4);
+    total = _mm256_add_epi64(
+        total, _mm256_slli_epi64(popcountVector256(eights), 3));
+    total = _mm256_add_epi64(
+        total, _mm256_slli_epi64(popcountVector256(fours), 2));
+    total = _mm256_add_epi64(
+        total, _mm256_slli_epi64(popcountVector256(twos), 1));
+    total = _mm256_add_epi64(total, popcountVector256(ones));
+
+    for (; vector < vectors; vector++) {
+        total = _mm256_add_epi64(
+            total, popcountVector256(loadVector256(blocks, vector)));
+    }
+
+    size_t counter = (size_t)_mm256_extract_epi64(total, 0) +
+                     (size_t)_mm256_extract_epi64(total, 1) +
+                     (size_t)_mm256_extract_epi64(total, 2) +
+                     (size_t)_mm256_extract_epi64(total, 3);
+
+    for (size_t block = vectors * 4; block < count; block++) {
+        counter += (size_t)__builtin_popcountll(blocks[block]);
+    }
+
+    return counter;
+}
+
+// Пересечение не материализуется: слова складываются сразу после and
+__attribute__((target("avx2,popcnt"))) static size_t popcountAndAvx2(
+    const uint64_t* blocksA, const uint64_t* blocksB, size_t count) {
+    __m256i totalA = _mm256_setzero_si256();
+    __m256i totalB = _mm256_setzero_si256();
+    size_t  block  = 0;
+
+    for (; block + 8 <= count; block += 8) {
+        totalA = _mm256_add_epi64(
+            totalA, popcountVector256(_mm256_and_si256(
+                        loadVector256(blocksA + block, 0),
+                        loadVector256(blocksB + block, 0))));
+        totalB = _mm256_add_epi64(
+            totalB, popcountVector256(_mm256_and_si256(
+                        loadVector256(blocksA + block, 1),
+                        loadVector256(blocksB + block, 1))));
+    }
+
+    __m256i total   = _mm256_add_epi64(totalA, totalB);
+    size_t  counter = (size_t)_mm256_extract_epi64(total, 0) +
+                      (size_t)_mm256_extract_epi64(total, 1) +
+                      (size_t)_mm256_extract_epi64(total, 2) +
+                      (size_t)_mm256_extract_epi64(total, 3);
+
+    for (; block < count; block++) {
+        counter += (size_t)__builtin_popcountll(blocksA[block] &
+                                                blocksB[block]);
+    }
+
+    return counter;
+}
+
+__attribute__((target("avx512f,avx512vpopcntdq"))) static size_t
+popcountAvx512(const uint64_t* blocks, size_t count) {
+    __m512i totalA = _mm512_setzero_si512();
+    __m512i totalB = _mm512_setzero_si512();
+    size_t  block  = 0;
+
+    for (; block + 16 <= count; block += 16) {
+        totalA = _mm512_add_epi64(
+            totalA, _mm512_popcnt_epi64(_mm512_loadu_si512(blocks + block)));
+        totalB = _mm512_add_epi64(
+            totalB,
+            _mm512_popcnt_epi64(_mm512_loadu_si512(blocks + block + 8)));
+    }
+    for (; block + 8 <= count; block += 8) {
+        totalA = _mm512_add_epi64(
+            totalA, _mm512_popcnt_epi64(_mm512_loadu_si512(blocks + block)));
+    }
+    if (block < count) {
+        __mmask8 tailMask = (__mmask8)((1u << (count - block)) - 1);
+        totalB = _mm512_add_epi64(
+            totalB, _mm512_popcnt_epi64(
+                        _mm512_maskz_loadu_epi64(tailMask, blocks + block)));
+    }
+
+    return (size_t)_mm512_reduce_add_epi64(_mm512_add_epi64(totalA, totalB));
+}
+
+__attribute__((target("avx512f,avx512vpopcntdq"))) static size_t
+popcountAndAvx512(const uint64_t* blocksA, const uint64_t* blocksB,
+                  size_t count) {
+    __m512i total = _mm512_setzero_si512();
+
+    for (size_t block = 0; block < count; block += 8) {
+        __mmask8 mask = count - block >= 8
+                            ? (__mmask8)0xFF
+                            : (__mmask8)((1u << (count - block)) - 1);
+        __m512i  word = _mm512_and_si512(
+            _mm512_maskz_loadu_epi64(mask, blocksA + block),
+            _mm512_maskz_loadu_epi64(mask, blocksB + block));
+
+        total = _mm512_add_epi64(total, _mm512_popcnt_epi64(word));
+    }
+
+    return (size_t)_mm512_reduce_add_epi64(total);
+}
+
+#endif
+
+static bool popcountKernelSupported(PopcountKernel kernel) {
+    bool isSupported = false;
+
+    switch (kernel) {
+        case POPCOUNT_PORTABLE:
+            isSupported = true;
+            break;
+#ifdef POPCOUNT_X86
+        case POPCOUNT_HARDWARE:
+            isSupported = __builtin_cpu_supports("popcnt");
+            break;
+        case POPCOUNT_AVX2:
+            isSupported = __builtin_cpu_supports("avx2") &&
+                          __builtin_cpu_supports("popcnt");
+            break;
+        case POPCOUNT_AVX512:
+            isSupported = __builtin_cpu_supports("avx512f") &&
+                          __builtin_cpu_supports("avx512vpopcntdq");
+            break;
+#endif
+        default:
+            break;
+    }
+
+    return isSupported;
+}
+
+static PopcountFunction popcountFunctionFor(PopcountKernel kernel) {
+    PopcountFunction function = popcountPortable;
+
+#ifdef POPCOUNT_X86
+    if (kernel == POPCOUNT_HARDWARE) {
+        function = popcountHardware;
+    } else if (kernel == POPCOUNT_AVX2) {
+        function = popcountAvx2;
+    } else if (kernel == POPCOUNT_AVX512) {
+        function = popcountAvx512;
+    }
+#endif
+
+    return function;
+}
+
+static PopcountAndFunction popcountAndFunctionFor(PopcountKernel kernel) {
+    PopcountAndFunction function = popcountAndPortable;
+
+#ifdef POPCOUNT_X86
+    if (kernel == POPCOUNT_HARDWARE) {
+        function = popcountAndHardware;
+    } else if (kernel == POPCOUNT_AVX2) {
+        function = popcountAndAvx2;
+    } else if (kernel == POPCOUNT_AVX512) {
+        function = popcountAndAvx512;
+    }
+#endif
+
+    return function;
+}
+
+static PopcountKernel popcountDetectKernel(void) {
+    PopcountKernel kernel = POPCOUNT_PORTABLE;
+
+    if (popcountKernelSupported(POPCOUNT_AVX512)) {
+        kernel = POPCOUNT_AVX512;
+    } else if (popcountKernelSupported(POPCOUNT_AVX2)) {
+        kernel = POPCOUNT_AVX2;
+    } else if (popcountKernelSupported(POPCOUNT_HARDWARE)) {
+        kernel = POPCOUNT_HARDWARE;
+    }
+
+    return kernel;
+}
+
+/*
+ * Выбранная реализация; определяется при первом вызове. Потоки пула
+ * считают одновременно, поэтому выбор публикуется атомарно: activeFunction
+ * записывается последней (release), и прочитавший её с acquire видит
+ * остальные поля.
+ */
+static _Atomic PopcountKernel      activeKernel      = POPCOUNT_AUTO;
+static _Atomic PopcountFunction    activeFunction    = NULL;
+static _Atomic PopcountAndFunction activeAndFunction = NULL;
+
+size_t popcountBlocks(const uint64_t* blocks, size_t count) {
+    PopcountFunction function =
+        atomic_load_explicit(&activeFunction, memory_order_acquire);
+
+    if (function == NULL) {
+        popcountSelectKernel(POPCOUNT_AUTO);
+        function = atomic_load_explicit(&activeFunction, memory_order_acquire);
+    }
+
+    return function(blocks, count);
+}
+
+size_t popcountAndBlocks(const uint64_t* blocksA, const uint64_t* blocksB,
+                         size_t count) {
+    PopcountAndFunction function =
+        atomic_load_explicit(&activeAndFunction, memory_order_acquire);
+
+    if (function == NULL) {
+        popcountSelectKernel(POPCOUNT_AUTO);
+        function =
+            atomic_load_explicit(&activeAndFunction, memory_order_acquire);
+    }
+
+    return function(blocksA, blocksB, count);
+}
+
+int popcountSelectKernel(PopcountKernel kernel) {
+    int status_code = 0;
+
+    if (kernel == POPCOUNT_AUTO) {
+        kernel = popcountDetectKernel();
+    }
+
+    if (popcountKernelSupported(kernel)) {
+        atomic_store_explicit(&activeKernel, kernel, memory_order_relaxed);
+        atomic_store_explicit(&activeAndFunction,
+                              popcountAndFunctionFor(kernel),
+                              memory_order_release);
+        atomic_store_explicit(&activeFunction, popcountFunctionFor(kernel),
+                              memory_order_release);
+    } else {
+        status_code = -1;
+    }
+
+    return status_code;
+}
+
+PopcountKernel popcountActiveKernel(void) {
+    if (atomic_load_explicit(&activeFunction, memory_order_acquire) == NULL) {
+        popcountSelectKernel(POPCOUNT_AUTO);
+    }
+
+    return atomic_load_explicit(&activeKernel, memory_order_relaxed);
+}
+
+const char* popcountKernelName(PopcountKernel kernel) {
+    const char* name = "auto";
+
+    switch (kernel) {
+        case POPCOUNT_PORTABLE:
+            name = "portable";
+            break;
+        case POPCOUNT_HARDWARE:
+            name = "popcnt";
+            break;
+        case POPCOUNT_AVX2:
+            name = "avx2";
+            break;
+        case POPCOUNT_AVX512:
+            name = "avx512";
+            break;
+        default:
+            break;
+    }
+
+    return name;
+}
@@ -0,0 +1,24 @@
+#ifndef POPCOUNT_H
+#define POPCOUNT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Варианты реализации подсчёта единичных битов */
+typedef enum {
+    POPCOUNT_AUTO,      // Выбор по возможностям процессора
+    POPCOUNT_PORTABLE,  // Переносимый SWAR-подсчёт
+    POPCOUNT_HARDWARE,  // Инструкция popcnt
+    POPCOUNT_AVX2,      // Harley-Seal на AVX2
+    POPCOUNT_AVX512     // AVX-512 VPOPCNTDQ
+} PopcountKernel;
+
+/* Функции подсчёта количества единичных битов */
+size_t popcountBlocks(const uint64_t* blocks, size_t count);
+size_t popcountAndBlocks(const uint64_t* blocksA, const uint64_t* blocksB,
+                         size_t count);
+int popcountSelectKernel(PopcountKernel kernel);
+PopcountKernel popcountActiveKernel(void);
+const char* popcountKernelName(PopcountKernel kernel);
+
+#endif
@@ -0,0 +1,952 @@
+#include "roaring.h"
+
+#include <string.h>
+
+#include "../popcount/popcount.h"
+
+#define BITMAP_WORDS (ROARING_CHUNK_BITS / 64)
+
+typedef enum {
+    ROARING_OR,
+    ROARING_AND,
+    ROARING_ANDNOT,
+    ROARING_XOR
+} RoaringOperation;
+
+/* Битовые карты контейнеров. Порядок битов в словах совпадает с BitSet,
+ * поэтому при обмене с плотным множеством слова копируются как есть */
+
+static void bitmapSetRange(uint64_t* words, uint32_t first, uint32_t last) {
+    uint32_t firstWord = first / 64;
+    uint32_t lastWord  = last / 64;
+    uint64_t firstMask = ~(uint64_t)0 << (first % 64);
+    uint64_t lastMask  = ~(uint64_t)0 >> (63 - last % 64);
+
+    if (firstWord == lastWord) {
+        words[firstWord] |= firstMask & lastMask;
+    } else {
+        words[firstWord] |= firstMask;
+        for (uint32_t word = firstWord + 1; word < lastWord; word++) {
+            words[word] = ~(uint64_t)0;
+        }
+        words[lastWord] |= lastMask;
+    }
+}
+
+static uint32_t bitmapCountRuns(const uint64_t* words) {
+    uint32_t runs     = 0;
+    uint64_t previous = 0;
+
+    for (size_t word = 0; word < BITMAP_WORDS; word++) {
+        uint64_t starts = words[word] & ~((words[word] << 1) | (previous >> 63));
+        runs += (uint32_t)__builtin_popcountll(starts);
+        previous = words[word];
+    }
+
+    return runs;
+}
+
+// Позиция первого бита со значением value, начиная с from (или 65536)
+static uint32_t bitmapNext(const uint64_t* words, uint32_t from, bool value) {
+    uint32_t position = ROARING_CHUNK_BITS;
+
+    if (from < ROARING_CHUNK_BITS) {
+        size_t   word    = from / 64;
+        uint64_t current = (value ? words[word] : ~words[word]) &
+                           (~(uint64_t)0 << (from % 64));
+
+        while (current == 0 && ++word < BITMAP_WORDS) {
+            current = value ? words[word] : ~words[word];
+        }
+        if (current != 0) {
+            position = (uint32_t)(word * 64) + (uint32_t)__builtin_ctzll(current);
+        }
+    }
+
+    return position;
+}
+
+/* Контейнеры */
+
+static size_t containerElementSize(uint8_t type) {
+    size_t elementSize = sizeof(uint16_t);
+    if (type == ROARING_BITMAP) {
+        elementSize = sizeof(uint64_t);
+    } else if (type == ROARING_RUN) {
+        elementSize = sizeof(RoaringRun);
+    }
+    return elementSize;
+}
+
+static void containerClear(RoaringContainer* container) {
+    free(container->data);
+    container->data        = NULL;
+    container->length      = 0;
+    container->allocated   = 0;
+    container->cardinality = 0;
+}
+
+static RoaringContainer containerEmpty(uint16_t key) {
+    RoaringContainer container = {NULL, 0, 0, 0, key, ROARING_ARRAY};
+    return container;
+}
+
+static int containerReserve(RoaringContainer* container, uint32_t count) {
+    int status_code = 0;
+
+    if (count > container->allocated) {
+        uint32_t allocated = container->allocated * 2;
+        if (allocated < count) {
+            allocated = count;
+        }
+        if (allocated < 4) {
+            allocated = 4;
+        }
+
+        void* data = realloc(container->data,
+                             allocated * containerElementSize(container->type));
+        if (data == NULL) {
+            status_code = -1;
+        } else {
+            container->data      = data;
+            container->allocated = allocated;
+        }
+    }
+
+    return status_code;
+}
+
+static uint32_t arrayLowerBound(const uint16_t* values, uint32_t length,
+                                uint16_t low) {
+    uint32_t left  = 0;
+    uint32_t right = length;
+
+    while (left < right) {
+        uint32_t middle = left + (right - left) / 2;
+        if (values[middle] < low) {
+            left = middle + 1;
+        } else {
+            right = middle;
+        }
+    }
+
+    return left;
+}
+
+static bool containerContains(const RoaringContainer* container,
+                              uint16_t low) {
+    bool isContains = false;
+
+    if (container->type == ROARING_ARRAY) {
+        const uint16_t* values = (const uint16_t*)container->data;
+        uint32_t index = arrayLowerBound(values, container->length, low);
+        isContains     = index < container->length && values[index] == low;
+    } else if (container->type == ROARING_BITMAP) {
+        const uint64_t* words = (const uint64_t*)container->data;
+        isContains            = (words[low / 64] >> (low % 64)) & 1;
+    } else {
+        const RoaringRun* runs  = (const RoaringRun*)container->data;
+        uint32_t          left  = 0;
+        uint32_t          right = container->length;
+
+        // Последний отрезок, начинающийся не позже low
+        while (left < right) {
+            uint32_t middle = left + (right - left) / 2;
+            if (runs[middle].start <= low) {
+                left = middle + 1;
+            } else {
+                right = middle;
+            }
+        }
+        isContains = left > 0 && (uint32_t)low <= (uint32_t)runs[left - 1].start +
+                                                      runs[left - 1].length;
+    }
+
+    return isContains;
+}
+
+static void containerToBitmap(const RoaringContainer* container,
+                              uint64_t* words) {
+    if (container->type == ROARING_BITMAP) {
+        memcpy(words, container->data, BITMAP_WORDS * sizeof(uint64_t));
+    } else {
+        memset(words, 0, BITMAP_WORDS * sizeof(uint64_t));
+
+        if (container->type == ROARING_ARRAY) {
+            const uint16_t* values = (const uint16_t*)container->data;
+            for (uint32_t iter = 0; iter < container->length; iter++) {
+                words[values[iter] / 64] |= (uint64_t)1 << (values[iter] % 64);
+            }
+        } else {
+            const RoaringRun* runs = (const RoaringRun*)container->data;
+            for (uint32_t iter = 0; iter < container->length; iter++) {
+                bitmapSetRange(words, runs[iter].start,
+                               (uint32_t)runs[iter].start + runs[iter].length);
+            }
+        }
+    }
+}
+
+/*
+ * Строит пустой контейнер container из битовой карты, выбирая самое
+ * компактное представление. Отрезки допускаются только при allowRun.
+ */
+static int containerFromBitmap(RoaringContainer* container,
+                               const uint64_t* words, bool allowRun) {
+    int      status_code = 0;
+    uint32_t cardinality = (uint32_t)popcountBlocks(words, BITMAP_WORDS);
+    uint32_t runs        = allowRun ? bitmapCountRuns(words) : UINT32_MAX;
+
+    size_t runBytes   = (size_t)runs * sizeof(RoaringRun);
+    size_t arrayBytes = (size_t)cardinality * sizeof(uint16_t);
+
+    if (cardinality == 0) {
+        container->type = ROARING_ARRAY;
+    } else if (allowRun && runBytes < arrayBytes &&
+               runBytes < BITMAP_WORDS * sizeof(uint64_t)) {
+        container->type = ROARING_RUN;
+        status_code     = containerReserve(container, runs);
+        if (status_code == 0) {
+            RoaringRun* output = (RoaringRun*)container->data;
+            uint32_t    start  = bitmapNext(words, 0, true);
+            while (start < ROARING_CHUNK_BITS) {
+                uint32_t end = bitmapNext(words, start, false);
+                output[container->length].start  = (uint16_t)start;
+                output[container->length].length = (uint16_t)(end - start - 1);
+                container->length++;
+                start = bitmapNext(words, end, true);
+            }
+        }
+    } else if (cardinality <= ROARING_ARRAY_LIMIT) {
+        container->type = ROARING_ARRAY;
+        status_code     = containerReserve(container, cardinality);
+        if (status_code == 0) {
+            uint16_t* output = (uint16_t*)container->data;
+            for (size_t word = 0; word < BITMAP_WORDS; word++) {
+                uint64_t current = words[word];
+                while (current != 0) {
+                    output[container->length++] =
+                        (uint16_t)(word * 64 + (size_t)__builtin_ctzll(current));
+                    current &= current - 1;
+                }
+            }
+        }
+    } else {
+        container->type = ROARING_BITMAP;
+        status_code     = containerReserve(container, BITMAP_WORDS);
+        if (status_code == 0) {
+            memcpy(container->data, words, BITMAP_WORDS * sizeof(uint64_t));
+            container->length = BITMAP_WORDS;
+        }
+    }
+
+    if (status_code == 0) {
+        container->cardinality = cardinality;
+    }
+
+    return status_code;
+}
+
+static int containerFromValues(RoaringContainer* container,
+                               const uint16_t* values, uint32_t count) {
+    int status_code = 0;
+
+    if (count <= ROARING_ARRAY_LIMIT) {
+        container->type = ROARING_ARRAY;
+        if (count > 0) {
+            status_code = containerReserve(container, count);
+        }
+        if (status_code == 0 && count > 0) {
+            memcpy(container->data, values, count * sizeof(uint16_t));
+            container->length      = count;
+            container->cardinality = count;
+        }
+    } else {
+        uint64_t words[BITMAP_WORDS] = {0};
+        for (uint32_t iter = 0; iter < count; iter++) {
+            words[values[iter] / 64] |= (uint64_t)1 << (values[iter] % 64);
+        }
+        status_code = containerFromBitmap(container, words, false);
+    }
+
+    return status_code;
+}
+
+// Перестраивает контейнер в наиболее компактный вид
+static int containerRebuild(RoaringContainer* container, bool allowRun) {
+    uint64_t words[BITMAP_WORDS];
+    containerToBitmap(container, words);
+    containerClear(container);
+
+    return containerFromBitmap(container, words, allowRun);
+}
+
+static int containerCopy(const RoaringContainer* source,
+                         RoaringContainer* copy) {
+    int status_code = 0;
+
+    *copy           = containerEmpty(source->key);
+    copy->type      = source->type;
+    status_code     = containerReserve(copy, source->length);
+    if (status_code == 0) {
+        memcpy(copy->data, source->data,
+               source->length * containerElementSize(source->type));
+        copy->length      = source->length;
+        copy->cardinality = source->cardinality;
+    }
+
+    return status_code;
+}
+
+static bool containerAdd(RoaringContainer* container, uint16_t low) {
+    bool isAdded = !containerContains(container, low);
+
+    if (isAdded && container->type == ROARING_RUN) {
+        isAdded = containerRebuild(container, false) == 0;
+    }
+    if (isAdded && container->type == ROARING_ARRAY &&
+        container->length == ROARING_ARRAY_LIMIT) {
+        uint64_t words[BITMAP_WORDS];
+        containerToBitmap(container, words);
+        words[low / 64] |= (uint64_t)1 << (low % 64);
+        containerClear(container);
+        isAdded = containerFromBitmap(container, words, false) == 0;
+    } else if (isAdded && container->type == ROARING_ARRAY) {
+        isAdded = containerReserve(container, container->length + 1) == 0;
+        if (isAdded) {
+            uint16_t* values = (uint16_t*)container->data;
+            uint32_t  index  = arrayLowerBound(values, container->length, low);
+            memmove(values + index + 1, values + index,
+                    (container->length - index) * sizeof(uint16_t));
+            values[index] = low;
+            container->length++;
+            container->cardinality++;
+        }
+    } else if (isAdded) {
+        uint64_t* words = (uint64_t*)container->data;
+        words[low / 64] |= (uint64_t)1 << (low % 64);
+        container->cardinality++;
+    }
+
+    return isAdded;
+}
+
+static bool containerRemove(RoaringContainer* container, uint16_t low) {
+    bool isRemoved = containerContains(container, low);
+
+    if (isRemoved && container->type == ROARING_RUN) {
+        isRemoved = containerRebuild(container, false) == 0;
+    }
+    if (isRemoved && container->type == ROARING_ARRAY) {
+        uint16_t* values = (uint16_t*)container->data;
+        uint32_t  index  = arrayLowerBound(values, container->length, low);
+        memmove(values + index, values + index + 1,
+                (container->length - index - 1) * sizeof(uint16_t));
+        container->length--;
+        container->cardinality--;
+    } else if (isRemoved) {
+        uint64_t* words = (uint64_t*)container->data;
+        words[low / 64] &= ~((uint64_t)1 << (low % 64));
+        container->cardinality--;
+        if (container->cardinality <= ROARING_ARRAY_LIMIT) {
+            containerRebuild(container, false);
+        }
+    }
+
+    return isRemoved;
+}
+
+static void arrayMerge(RoaringOperation operation, const uint16_t* a,
+                       uint32_t lengthA, const uint16_t* b, uint32_t lengthB,
+                       uint16_t* output, uint32_t* count) {
+    bool     keepOnlyA = operation != ROARING_AND;
+    bool     keepOnlyB = operation == ROARING_OR || operation == ROARING_XOR;
+    bool     keepBoth  = operation == ROARING_OR || operation == ROARING_AND;
+    uint32_t indexA    = 0;
+    uint32_t indexB    = 0;
+    uint32_t length    = 0;
+
+    while (indexA < lengthA && indexB < lengthB) {
+        if (a[indexA] < b[indexB]) {
+            if (keepOnlyA) {
+                output[length++] = a[indexA];
+            }
+            indexA++;
+        } else if (b[indexB] < a[indexA]) {
+            if (keepOnlyB) {
+                output[length++] = b[indexB];
+            }
+            indexB++;
+        } else {
+            if (keepBoth) {
+                output[length++] = a[indexA];
+            }
+            indexA++;
+            indexB++;
+        }
+    }
+    for (; keepOnlyA && indexA < lengthA; indexA++) {
+        output[length++] = a[indexA];
+    }
+    for (; keepOnlyB && indexB < lengthB; indexB++) {
+        output[length++] = b[indexB];
+    }
+
+    *count = length;
+}
+
+// Элементы массива a, наличие которых в b равно keepContained
+static int arrayFilter(const RoaringContainer* a, const RoaringContainer* b,
+                       bool keepContained, RoaringContainer* output) {
+    uint16_t        values[ROARING_ARRAY_LIMIT];
+    const uint16_t* input = (const uint16_t*)a->data;
+    uint32_t        count = 0;
+
+    for (uint32_t iter = 0; iter < a->length; iter++) {
+        if (containerContains(b, input[iter]) == keepContained) {
+            values[count++] = input[iter];
+        }
+    }
+
+    return containerFromValues(output, values, count);
+}
+
+static int containerOperation(RoaringOperation operation,
+                              const RoaringContainer* a,
+                              const RoaringContainer* b,
+                              RoaringContainer* output) {
+    int status_code = 0;
+    *output         = containerEmpty(a->key);
+
+    if (a->type == ROARING_ARRAY && b->type == ROARING_ARRAY) {
+        uint16_t values[2 * ROARING_ARRAY_LIMIT];
+        uint32_t count = 0;
+        arrayMerge(operation, (const uint16_t*)a->data, a->length,
+                   (const uint16_t*)b->data, b->length, values, &count);
+        status_code = containerFromValues(output, values, count);
+    } else if (operation == ROARING_AND && a->type == ROARING_ARRAY) {
+        status_code = arrayFilter(a, b, true, output);
+    } else if (operation == ROARING_AND && b->type == ROARING_ARRAY) {
+        status_code = arrayFilter(b, a, true, output);
+    } else if (operation == ROARING_ANDNOT && a->type == ROARING_ARRAY) {
+        status_code = arrayFilter(a, b, false, output);
+    } else {
+        uint64_t wordsA[BITMAP_WORDS];
+        uint64_t wordsB[BITMAP_WORDS];
+        containerToBitmap(a, wordsA);
+        containerToBitmap(b, wordsB);
+
+        for (size_t word = 0; word < BITMAP_WORDS; word++) {
+            if (operation == ROARING_OR) {
+                wordsA[word] |= wordsB[word];
+            } else if (operation == ROARING_AND) {
+                wordsA[word] &= wordsB[word];
+            } else if (operation == ROARING_ANDNOT) {
+                wordsA[word] &= ~wordsB[word];
+            } else {
+                wordsA[word] ^= wordsB[word];
+            }
+        }
+        status_code = containerFromBitmap(output, wordsA, true);
+    }
+
+    return status_code;
+}
+
+static bool containerIsSubset(const RoaringContainer* a,
+                              const RoaringContainer* b) {
+    bool isSubset = a->cardinality <= b->cardinality;
+
+    if (isSubset && a->type == ROARING_ARRAY) {
+        const uint16_t* values = (const uint16_t*)a->data;
+        for (uint32_t iter = 0; iter < a->length && isSubset; iter++) {
+            isSubset = containerContains(b, values[iter]);
+        }
+    } else if (isSubset) {
+        uint64_t wordsA[BITMAP_WORDS];
+        uint64_t wordsB[BITMAP_WORDS];
+        containerToBitmap(a, wordsA);
+        containerToBitmap(b, wordsB);
+        for (size_t word = 0; word < BITMAP_WORDS && isSubset; word++) {
+            isSubset = (wordsA[word] & ~wordsB[word]) == 0;
+        }
+    }
+
+    return isSubset;
+}
+
+/* Множество */
+
+static size_t findContainer(RoaringSet* set, uint16_t key) {
+    size_t left  = 0;
+    size_t right = set->count;
+
+    while (left < right) {
+        size_t middle = left + (right - left) / 2;
+        if (set->containers[middle].key < key) {
+            left = middle + 1;
+        } else {
+            right = middle;
+        }
+    }
+
+    return left;
+}
+
+static int insertContainer(RoaringSet* set, size_t index,
+                           RoaringContainer* container) {
+    int status_code = 0;
+
+    if (set->count == set->allocated) {
+        size_t allocated = set->allocated == 0 ? 4 : set->allocated * 2;
+        RoaringContainer* containers = (RoaringContainer*)realloc(
+            set->containers, allocated * sizeof(RoaringContainer));
+        if (containers == NULL) {
+            status_code = -1;
+        } else {
+            set->containers = containers;
+            set->allocated  = allocated;
+        }
+    }
+
+    if (status_code == 0) {
+        memmove(set->containers + index + 1, set->containers + index,
+                (set->count - index) * sizeof(RoaringContainer));
+        set->containers[index] = *container;
+        set->count++;
+        set->size += container->cardinality;
+    } else {
+        containerClear(container);
+    }
+
+    return status_code;
+}
+
+// Добавляет контейнер в конец множества; пустые контейнеры отбрасываются
+static int appendContainer(RoaringSet* set, RoaringContainer* container) {
+    int status_code = 0;
+
+    if (container->cardinality == 0) {
+        containerClear(container);
+    } else {
+        status_code = insertContainer(set, set->count, container);
+    }
+
+    return status_code;
+}
+
+static void removeContainer(RoaringSet* set, size_t index) {
+    containerClear(&set->containers[index]);
+    memmove(set->containers + index, set->containers + index + 1,
+            (set->count - index - 1) * sizeof(RoaringContainer));
+    set->count--;
+}
+
+RoaringSet roaringCreate(size_t capacity) {
+    RoaringSet set = {NULL, 0, 0, 0, capacity};
+    return set;
+}
+
+void roaringAdd(RoaringSet* set, int element) {
+    if (elementCanBeCreated(element, set->capacity) == 0) {
+        uint16_t key   = (uint16_t)((uint32_t)element >> 16);
+        uint16_t low   = (uint16_t)((uint32_t)element & 0xFFFF);
+        size_t   index = findContainer(set, key);
+        int      status_code = 0;
+
+        if (index == set->count || set->containers[index].key != key) {
+            RoaringContainer container = containerEmpty(key);
+            status_code = insertContainer(set, index, &container);
+        }
+        if (status_code == 0 && containerAdd(&set->containers[index], low)) {
+            set->size += 1;
+        } else if (status_code == 0 &&
+                   set->containers[index].cardinality == 0) {
+            removeContainer(set, index);
+        }
+    }
+}
+
+void roaringAddMany(RoaringSet* set, int* array, int elementsCount) {
+    for (int iter = 0; iter < elementsCount; iter++) {
+        roaringAdd(set, array[iter]);
+    }
+}
+
+void roaringRemove(RoaringSet* set, int element) {
+    if (elementCanBeCreated(element, set->capacity) == 0) {
+        uint16_t key   = (uint16_t)((uint32_t)element >> 16);
+        uint16_t low   = (uint16_t)((uint32_t)element & 0xFFFF);
+        size_t   index = findContainer(set, key);
+
+        if (index < set->count && set->containers[index].key == key &&
+            containerRemove(&set->containers[index], low)) {
+            set->size -= 1;
+            if (set->containers[index].cardinality == 0) {
+                removeContainer(set, index);
+            }
+        }
+    }
+}
+
+void roaringRemoveMany(RoaringSet* set, int* array, int elementsCount) {
+    for (int iter = 0; iter < elementsCount; iter++) {
+        roaringRemove(set, array[iter]);
+    }
+}
+
+bool roaringContains(RoaringSet* set, int element) {
+    bool isContains = false;
+
+    if (element >= 0 && (size_t)element <= set->capacity) {
+        uint16_t key   = (uint16_t)((uint32_t)element >> 16);
+        size_t   index = findContainer(set, key);
+
+        isContains = index < set->count && set->containers[index].key == key &&
+                     containerContains(&set->containers[index],
+                                       (uint16_t)((uint32_t)element & 0xFFFF));
+    }
+
+    return isContains;
+}
+
+void roaringDestroy(RoaringSet* set) {
+    for (size_t index = 0; index < set->count; index++) {
+        containerClear(&set->containers[index]);
+    }
+    free(set->containers);
+    set->containers = NULL;
+    set->count      = 0;
+    set->allocated  = 0;
+    set->size       = 0;
+    set->capacity   = 0;
+}
+
+size_t roaringSize(RoaringSet* set) {
+    return set->size;
+}
+
+size_t roaringMemoryUsage(RoaringSet* set) {
+    size_t bytes = sizeof(RoaringSet) + set->allocated * sizeof(RoaringContainer);
+
+    for (size_t index = 0; index < set->count; index++) {
+        bytes += set->containers[index].allocated *
+                 containerElementSize(set->containers[index].type);
+    }
+
+    return bytes;
+}
+
+void roaringRunOptimize(RoaringSet* set) {
+    for (size_t index = 0; index < set->count; index++) {
+        containerRebuild(&set->containers[index], true);
+    }
+}
+
+bool roaringIsEqual(RoaringSet* setA, RoaringSet* setB) {
+    bool isEqual = setA->size == setB->size && setA->count == setB->count;
+
+    for (size_t index = 0; index < setA->count && isEqual; index++) {
+        RoaringContainer* a = &setA->containers[index];
+        RoaringContainer* b = &setB->containers[index];
+        isEqual = a->key == b->key && a->cardinality == b->cardinality &&
+                  containerIsSubset(a, b);
+    }
+
+    return isEqual;
+}
+
+bool roaringIsSubset(RoaringSet* setA, RoaringSet* setB) {
+    bool   isSubset = setA->size <= setB->size;
+    size_t indexB   = 0;
+
+    for (size_t index = 0; index < setA->count && isSubset; index++) {
+        RoaringContainer* a = &setA->containers[index];
+        while (indexB < setB->count && setB->containers[indexB].key < a->key) {
+            indexB++;
+        }
+        isSubset = indexB < setB->count &&
+                   setB->containers[indexB].key == a->key &&
+                   containerIsSubset(a, &setB->containers[indexB]);
+    }
+
+    return isSubset;
+}
+
+bool roaringIsStrictSubset(RoaringSet* setA, RoaringSet* setB) {
+    return setA->size < setB->size && roaringIsSubset(setA, setB);
+}
+
+// При нехватке памяти частичный результат освобождается: возвращается
+// пустое множество с capacity 0 и сообщается ERROR_OUT_OF_MEMORY
+static RoaringSet roaringFailed(RoaringSet* result) {
+    roaringDestroy(result);
+    errorReport(ERROR_OUT_OF_MEMORY, 0, 0);
+    return *result;
+}
+
+static RoaringSet roaringOperation(RoaringOperation operation,
+                                   RoaringSet* setA, RoaringSet* setB,
+                                   size_t capacity) {
+    RoaringSet result      = roaringCreate(capacity);
+    bool       keepA       = operation != ROARING_AND;
+    bool       keepB       = operation == ROARING_OR ||
+                             operation == ROARING_XOR;
+    size_t     indexA      = 0;
+    size_t     indexB      = 0;
+    int        status_code = 0;
+
+    while ((indexA < setA->count || indexB < setB->count) &&
+           status_code == 0) {
+        RoaringContainer* a = indexA < setA->count ? &setA->containers[indexA]
+                                                   : NULL;
+        RoaringContainer* b = indexB < setB->count ? &setB->containers[indexB]
+                                                   : NULL;
+        RoaringContainer container = containerEmpty(0);
+
+        if (b == NULL || (a != NULL && a->key < b->key)) {
+            if (keepA) {
+                status_code = containerCopy(a, &container);
+            }
+            indexA++;
+        } else if (a == NULL || b->key < a->key) {
+            if (keepB) {
+                status_code = containerCopy(b, &container);
+            }
+            indexB++;
+        } else {
+            status_code = containerOperation(operation, a, b, &container);
+            indexA++;
+            indexB++;
+        }
+
+        if (status_code == 0) {
+            status_code = appendContainer(&result, &container);
+        } else {
+            containerClear(&container);
+        }
+    }
+
+    if (status_code != 0) {
+        result = roaringFailed(&result);
+    }
+
+    return result;
+}
+
+static size_t maxCapacity(RoaringSet* setA, RoaringSet* setB) {
+    return setA->capacity > setB->capacity ? setA->capacity : setB->capacity;
+}
+
+RoaringSet roaringUnion(RoaringSet* setA, RoaringSet* setB) {
+    return roaringOperation(ROARING_OR, setA, setB, maxCapacity(setA, setB));
+}
+
+RoaringSet roaringIntersection(RoaringSet* setA, RoaringSet* setB) {
+    return roaringOperation(ROARING_AND, setA, setB, maxCapacity(setA, setB));
+}
+
+RoaringSet roaringDifference(RoaringSet* setA, RoaringSet* setB) {
+    return roaringOperation(ROARING_ANDNOT, setA, setB, setA->capacity);
+}
+
+RoaringSet roaringSymmetricDifference(RoaringSet* setA, RoaringSet* setB) {
+    return roaringOperation(ROARING_XOR, setA, setB, maxCapacity(setA, setB));
+}
+
+RoaringSet roaringComplement(RoaringSet* setA) {
+    RoaringSet result      = roaringCreate(setA->capacity);
+    size_t     lastKey     = setA->capacity >> 16;
+    size_t     index       = 0;
+    int        status_code = 0;
+
+    for (size_t key = 0; key <= lastKey && status_code == 0; key++) {
+        uint32_t lastLow = key == lastKey ? setA->capacity & 0xFFFF
+                                          : ROARING_CHUNK_BITS - 1;
+        RoaringContainer container = containerEmpty((uint16_t)key);
+
+        if (index < setA->count && setA->containers[index].key == key) {
+            uint64_t words[BITMAP_WORDS];
+            containerToBitmap(&setA->containers[index], words);
+            for (size_t word = 0; word < BITMAP_WORDS; word++) {
+                words[word] = ~words[word];
+            }
+            if (lastLow + 1 < ROARING_CHUNK_BITS) {
+                uint64_t tail[BITMAP_WORDS] = {0};
+                bitmapSetRange(tail, 0, lastLow);
+                for (size_t word = 0; word < BITMAP_WORDS; word++) {
+                    words[word] &= tail[word];
+                }
+            }
+            status_code = containerFromBitmap(&container, words, true);
+            index++;
+        } else {
+            // Отсутствующий контейнер дополняется одним отрезком
+            container.type = ROARING_RUN;
+            status_code = containerReserve(&container, 1);
+            if (status_code == 0) {
+                RoaringRun* runs       = (RoaringRun*)container.data;
+                runs[0].start          = 0;
+                runs[0].length         = (uint16_t)lastLow;
+                container.length       = 1;
+                container.cardinality  = lastLow + 1;
+            }
+        }
+
+        if (status_code == 0) {
+            status_code = appendContainer(&result, &container);
+        } else {
+            containerClear(&container);
+        }
+    }
+
+    if (status_code != 0) {
+        result = roaringFailed(&result);
+    }
+
+    return result;
+}
+
+/* Совместная работа с плотными множествами */
+
+RoaringSet roaringFromBitSet(BitSet* set) {
+    RoaringSet result      = roaringCreate(set->capacity);
+    uint64_t*  bits        = bitsetBlocks(set);
+    int        status_code = 0;
+
+    for (size_t start = 0; start < set->blockCount && status_code == 0;
+         start += BITMAP_WORDS) {
+        uint64_t words[BITMAP_WORDS] = {0};
+        bool     isEmpty             = true;
+
+        for (size_t word = 0; word < BITMAP_WORDS &&
+                              start + word < set->blockCount;
+             word++) {
+            words[word] = bits[start + word];
+            isEmpty     = isEmpty && words[word] == 0;
+        }
+
+        if (!isEmpty) {
+            RoaringContainer container =
+                containerEmpty((uint16_t)(start / BITMAP_WORDS));
+            status_code = containerFromBitmap(&container, words, true);
+            if (status_code == 0) {
+                status_code = appendContainer(&result, &container);
+            } else {
+                containerClear(&container);
+            }
+        }
+    }
+
+    if (status_code != 0) {
+        result = roaringFailed(&result);
+    }
+
+    return result;
+}
+
+// Объединяет контейнер с соответствующими словами плотного множества
+static void containerOrIntoBitSet(const RoaringContainer* container,
+                                  BitSet* dense) {
+    size_t base = (size_t)container->key << 16;
+
+    if (container->type == ROARING_ARRAY) {
+        const uint16_t* values = (const uint16_t*)container->data;
+        for (uint32_t iter = 0; iter < container->length; iter++) {
+            bitsetAdd(dense, (int)(base + values[iter]));
+        }
+    } else {
+        uint64_t  words[BITMAP_WORDS];
+        uint64_t* bits  = bitsetBlocks(dense);
+        size_t    start = base / 64;
+        containerToBitmap(container, words);
+
+        for (size_t word = 0; word < BITMAP_WORDS &&
+                              start + word < dense->blockCount;
+             word++) {
+            uint64_t previous = bits[start + word];
+            uint64_t current  = previous | words[word];
+            bits[start + word] = current;
+            dense->size += (size_t)(__builtin_popcountll(current) -
+                                    __builtin_popcountll(previous));
+        }
+    }
+}
+
+BitSet roaringToBitSet(RoaringSet* set) {
+    BitSet result = bitsetCreate(set->capacity);
+
+    if (bitsetBlocks(&result) != NULL) {
+        for (size_t index = 0; index < set->count; index++) {
+            containerOrIntoBitSet(&set->containers[index], &result);
+        }
+    }
+
+    return result;
+}
+
+int roaringUnionIntoBitSet(BitSet* dense, RoaringSet* sparse) {
+    int status_code = 0;
+
+    if (bitsetBlocks(dense) == NULL || dense->capacity < sparse->capacity) {
+        status_code = -1;
+    } else {
+        for (size_t index = 0; index < sparse->count; index++) {
+            containerOrIntoBitSet(&sparse->containers[index], dense);
+        }
+        bitsetBlocksChanged(dense, 0, dense->blockCount);
+    }
+
+    return status_code;
+}
+
+RoaringSet roaringIntersectionWithBitSet(RoaringSet* sparse, BitSet* dense) {
+    RoaringSet result      = roaringCreate(sparse->capacity);
+    int        status_code = 0;
+
+    for (size_t index = 0; index < sparse->count && status_code == 0;
+         index++) {
+        RoaringContainer* source    = &sparse->containers[index];
+        RoaringContainer  container = containerEmpty(source->key);
+        size_t            base      = (size_t)source->key << 16;
+
+        if (source->type == ROARING_ARRAY) {
+            uint16_t        values[ROARING_ARRAY_LIMIT];
+            const uint16_t* input = (const uint16_t*)source->data;
+            uint32_t        count = 0;
+
+            for (uint32_t iter = 0; iter < source->length; iter++) {
+                if (bitsetContains(dense, (int)(base + input[iter]))) {
+                    values[count++] = input[iter];
+                }
+            }
+            status_code = containerFromValues(&container, values, count);
+        } else {
+            uint64_t  words[BITMAP_WORDS];
+            uint64_t* bits  = bitsetBlocks(dense);
+            size_t    start = base / 64;
+            containerToBitmap(source, words);
+
+            for (size_t word = 0; word < BITMAP_WORDS; word++) {
+                uint64_t denseWord = 0;
+                if (start + word < dense->blockCount) {
+                    denseWord = bits[start + word];
+                }
+                words[word] &= denseWord;
+            }
+            status_code = containerFromBitmap(&container, words, true);
+        }
+
+        if (status_code == 0) {
+            status_code = appendContainer(&result, &container);
+        } else {
+            containerClear(&container);
+        }
+    }
+
+    if (status_code != 0) {
+        result = roaringFailed(&result);
+    }
+
+    return result;
+}
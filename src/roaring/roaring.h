@@ -0,0 +1,70 @@
+#ifndef ROARING_H
+#define ROARING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../bitset/bitset.h"
+
+#define ROARING_CHUNK_BITS 65536   // Элементов в одном контейнере
+#define ROARING_ARRAY_LIMIT 4096   // Наибольший размер контейнера-массива
+
+typedef enum {
+    ROARING_ARRAY,   // Отсортированный массив младших 16 бит элементов
+    ROARING_BITMAP,  // 1024 слова по 64 бита
+    ROARING_RUN      // Отсортированные отрезки [start, start + length]
+} RoaringContainerType;
+
+typedef struct {
+    uint16_t start;
+    uint16_t length;  // Отрезок содержит length + 1 элементов
+} RoaringRun;
+
+typedef struct {
+    void*    data;         // uint16_t*, uint64_t* или RoaringRun*
+    uint32_t length;       // Элементов массива или число отрезков
+    uint32_t allocated;    // Выделено элементов массива или отрезков
+    uint32_t cardinality;  // Количество элементов в контейнере
+    uint16_t key;          // Старшие 16 бит элементов
+    uint8_t  type;         // RoaringContainerType
+} RoaringContainer;
+
+typedef struct {
+    RoaringContainer* containers;  // Упорядочены по key, пустых нет
+    size_t            count;       // Количество контейнеров
+    size_t            allocated;   // Выделено контейнеров
+    size_t            size;        // Количество элементов в множестве
+    size_t            capacity;    // Максимальное число элементов в множестве
+} RoaringSet;
+
+/* Функции работы со сжатым множеством */
+RoaringSet roaringCreate(size_t capacity);
+void roaringAdd(RoaringSet* set, int element);
+void roaringAddMany(RoaringSet* set, int* array, int elementsCount);
+void roaringRemove(RoaringSet* set, int element);
+void roaringRemoveMany(RoaringSet* set, int* array, int elementsCount);
+bool roaringContains(RoaringSet* set, int element);
+void roaringDestroy(RoaringSet* set);
+size_t roaringSize(RoaringSet* set);
+size_t roaringMemoryUsage(RoaringSet* set);
+void roaringRunOptimize(RoaringSet* set);
+bool roaringIsEqual(RoaringSet* setA, RoaringSet* setB);
+bool roaringIsSubset(RoaringSet* setA, RoaringSet* setB);
+bool roaringIsStrictSubset(RoaringSet* setA, RoaringSet* setB);
+/* Операции, а также roaringFromBitSet и roaringIntersectionWithBitSet,
+ * возвращают новое множество; при нехватке памяти — пустое с capacity 0
+ * и ошибкой ERROR_OUT_OF_MEMORY */
+RoaringSet roaringUnion(RoaringSet* setA, RoaringSet* setB);
+RoaringSet roaringIntersection(RoaringSet* setA, RoaringSet* setB);
+RoaringSet roaringDifference(RoaringSet* setA, RoaringSet* setB);
+RoaringSet roaringSymmetricDifference(RoaringSet* setA, RoaringSet* setB);
+RoaringSet roaringComplement(RoaringSet* setA);
+
+/* Совместная работа с плотными множествами */
+RoaringSet roaringFromBitSet(BitSet* set);
+BitSet roaringToBitSet(RoaringSet* set);
+int roaringUnionIntoBitSet(BitSet* dense, RoaringSet* sparse);
+RoaringSet roaringIntersectionWithBitSet(RoaringSet* sparse, BitSet* dense);
+
+#endif
@@ -0,0 +1,250 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "stats.h"
+
+#include <string.h>
+
+static const char* functionNames[STATS_FUNCTION_COUNT] = {
+    "bitsetCreate",        "bitsetDestroy",      "bitsetAdd",
+    "bitsetRemove",        "bitsetContains",     "bitsetAddMany",
+    "bitsetRemoveMany",    "bitsetContainsMany", "bitsetRange",
+    "findSetSize",         "setsIsEqual",        "setIsSubset",
+    "getSetsUnion",        "getSetsIntersection", "getSetsDifference",
+    "getSetsSymmetricDifference", "getComplementSet"};
+
+const char* statsFunctionName(StatsFunction function) {
+    const char* name = "unknown";
+    if (function >= 0 && function < STATS_FUNCTION_COUNT) {
+        name = functionNames[function];
+    }
+    return name;
+}
+
+#ifdef BITSET_STATS
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <time.h>
+
+/*
+ * Счётчики потока пишет только он сам (обычные сложения через relaxed
+ * атомики, без блокировок); другие потоки их только читают и обнуляют.
+ */
+typedef struct StatsThread {
+    atomic_uint_least64_t calls[STATS_FUNCTION_COUNT];
+    atomic_uint_least64_t nanoseconds[STATS_FUNCTION_COUNT];
+    atomic_uint_least64_t histogram[STATS_FUNCTION_COUNT]
+                                   [STATS_HISTOGRAM_BUCKETS];
+    atomic_uint_least64_t created;
+    atomic_uint_least64_t destroyed;
+    atomic_uint_least64_t allocated;
+    atomic_uint_least64_t released;
+    struct StatsThread*   next;
+} StatsThread;
+
+static pthread_mutex_t       registryLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t        keyOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t         threadKey;
+static StatsThread*          threads = NULL;   // Живые потоки
+static StatsThread           retired;          // Итоги завершившихся потоков
+static _Thread_local StatsThread* current = NULL;
+
+static _Atomic(StatsClock)   userClock = NULL;
+static _Atomic(StatsHook)    userHook = NULL;
+static void* _Atomic         userHookContext = NULL;
+
+static void counterAdd(atomic_uint_least64_t* counter, uint64_t value) {
+    atomic_store_explicit(
+        counter, atomic_load_explicit(counter, memory_order_relaxed) + value,
+        memory_order_relaxed);
+}
+
+static uint64_t counterGet(atomic_uint_least64_t* counter) {
+    return atomic_load_explicit(counter, memory_order_relaxed);
+}
+
+// Складывает счётчики source в target; вызывается под registryLock
+static void threadMerge(StatsThread* target, StatsThread* source) {
+    for (int function = 0; function < STATS_FUNCTION_COUNT; function++) {
+        counterAdd(&target->calls[function], counterGet(&source->calls[function]));
+        counterAdd(&target->nanoseconds[function],
+                   counterGet(&source->nanoseconds[function]));
+        for (int bucket = 0; bucket < STATS_HISTOGRAM_BUCKETS; bucket++) {
+            counterAdd(&target->histogram[function][bucket],
+                       counterGet(&source->histogram[function][bucket]));
+        }
+    }
+    counterAdd(&target->created, counterGet(&source->created));
+    counterAdd(&target->destroyed, counterGet(&source->destroyed));
+    counterAdd(&target->allocated, counterGet(&source->allocated));
+    counterAdd(&target->released, counterGet(&source->released));
+}
+
+// При завершении потока его счётчики переносятся в retired
+static void threadRetire(void* data) {
+    StatsThread* thread = (StatsThread*)data;
+
+    pthread_mutex_lock(&registryLock);
+    threadMerge(&retired, thread);
+    for (StatsThread** link = &threads; *link != NULL; link = &(*link)->next) {
+        if (*link == thread) {
+            *link = thread->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&registryLock);
+
+    free(thread);
+}
+
+static void keyCreate(void) {
+    pthread_key_create(&threadKey, threadRetire);
+}
+
+static StatsThread* threadStats(void) {
+    if (current == NULL) {
+        StatsThread* thread = (StatsThread*)calloc(1, sizeof(StatsThread));
+        if (thread != NULL) {
+            pthread_once(&keyOnce, keyCreate);
+            pthread_setspecific(threadKey, thread);
+
+            pthread_mutex_lock(&registryLock);
+            thread->next = threads;
+            threads = thread;
+            pthread_mutex_unlock(&registryLock);
+
+            current = thread;
+        }
+    }
+    return current;
+}
+
+static uint64_t monotonicClock(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t)time.tv_sec * 1000000000u + (uint64_t)time.tv_nsec;
+}
+
+uint64_t statsBegin(void) {
+    StatsClock clock = atomic_load_explicit(&userClock, memory_order_relaxed);
+    return clock != NULL ? clock() : monotonicClock();
+}
+
+void statsEnd(StatsFunction function, uint64_t start) {
+    uint64_t     elapsed = statsBegin() - start;
+    StatsThread* thread  = threadStats();
+
+    if (thread != NULL) {
+        int bucket = elapsed == 0 ? 0 : 64 - __builtin_clzll(elapsed);
+        if (bucket >= STATS_HISTOGRAM_BUCKETS) {
+            bucket = STATS_HISTOGRAM_BUCKETS - 1;
+        }
+        counterAdd(&thread->calls[function], 1);
+        counterAdd(&thread->nanoseconds[function], elapsed);
+        counterAdd(&thread->histogram[function][bucket], 1);
+    }
+
+    StatsHook hook = atomic_load_explicit(&userHook, memory_order_relaxed);
+    if (hook != NULL) {
+        hook(function, elapsed,
+             atomic_load_explicit(&userHookContext, memory_order_relaxed));
+    }
+}
+
+void statsMemory(int64_t sets, int64_t bytes) {
+    StatsThread* thread = threadStats();
+
+    if (thread != NULL) {
+        if (sets > 0) {
+            counterAdd(&thread->created, (uint64_t)sets);
+        } else if (sets < 0) {
+            counterAdd(&thread->destroyed, (uint64_t)-sets);
+        }
+        if (bytes > 0) {
+            counterAdd(&thread->allocated, (uint64_t)bytes);
+        } else if (bytes < 0) {
+            counterAdd(&thread->released, (uint64_t)-bytes);
+        }
+    }
+}
+
+void statsSnapshot(StatsSnapshot* snapshot) {
+    StatsThread total;
+    memset(&total, 0, sizeof(total));
+
+    pthread_mutex_lock(&registryLock);
+    threadMerge(&total, &retired);
+    for (StatsThread* thread = threads; thread != NULL; thread = thread->next) {
+        threadMerge(&total, thread);
+    }
+    pthread_mutex_unlock(&registryLock);
+
+    for (int function = 0; function < STATS_FUNCTION_COUNT; function++) {
+        snapshot->calls[function] = counterGet(&total.calls[function]);
+        snapshot->nanoseconds[function] = counterGet(&total.nanoseconds[function]);
+        for (int bucket = 0; bucket < STATS_HISTOGRAM_BUCKETS; bucket++) {
+            snapshot->histogram[function][bucket] =
+                counterGet(&total.histogram[function][bucket]);
+        }
+    }
+    snapshot->setsCreated = counterGet(&total.created);
+    snapshot->setsDestroyed = counterGet(&total.destroyed);
+    snapshot->bytesAllocated = counterGet(&total.allocated);
+    snapshot->bytesReleased = counterGet(&total.released);
+}
+
+// Обнуление, совпавшее с записью владельца, может потерять эту запись
+static void threadClear(StatsThread* thread) {
+    for (int function = 0; function < STATS_FUNCTION_COUNT; function++) {
+        atomic_store_explicit(&thread->calls[function], 0, memory_order_relaxed);
+        atomic_store_explicit(&thread->nanoseconds[function], 0,
+                              memory_order_relaxed);
+        for (int bucket = 0; bucket < STATS_HISTOGRAM_BUCKETS; bucket++) {
+            atomic_store_explicit(&thread->histogram[function][bucket], 0,
+                                  memory_order_relaxed);
+        }
+    }
+    atomic_store_explicit(&thread->created, 0, memory_order_relaxed);
+    atomic_store_explicit(&thread->destroyed, 0, memory_order_relaxed);
+    atomic_store_explicit(&thread->allocated, 0, memory_order_relaxed);
+    atomic_store_explicit(&thread->released, 0, memory_order_relaxed);
+}
+
+void statsReset(void) {
+    pthread_mutex_lock(&registryLock);
+    threadClear(&retired);
+    for (StatsThread* thread = threads; thread != NULL; thread = thread->next) {
+        threadClear(thread);
+    }
+    pthread_mutex_unlock(&registryLock);
+}
+
+void statsSetClock(StatsClock clock) {
+    atomic_store(&userClock, clock);
+}
+
+void statsSetHook(StatsHook hook, void* context) {
+    atomic_store(&userHookContext, context);
+    atomic_store(&userHook, hook);
+}
+
+#else
+
+void statsSnapshot(StatsSnapshot* snapshot) {
+    memset(snapshot, 0, sizeof(*snapshot));
+}
+
+void statsReset(void) {
+}
+
+void statsSetClock(StatsClock clock) {
+    (void)clock;
+}
+
+void statsSetHook(StatsHook hook, void* context) {
+    (void)hook;
+    (void)context;
+}
+
+#endif
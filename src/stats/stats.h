@@ -0,0 +1,73 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+
+#define STATS_HISTOGRAM_BUCKETS 32   // Корзина k: задержка в [2^(k-1), 2^k) нс
+
+typedef enum {
+    STATS_BITSET_CREATE,
+    STATS_BITSET_DESTROY,
+    STATS_BITSET_ADD,
+    STATS_BITSET_REMOVE,
+    STATS_BITSET_CONTAINS,
+    STATS_BITSET_ADD_MANY,
+    STATS_BITSET_REMOVE_MANY,
+    STATS_BITSET_CONTAINS_MANY,
+    STATS_BITSET_RANGE,
+    STATS_FIND_SET_SIZE,
+    STATS_SETS_IS_EQUAL,
+    STATS_SET_IS_SUBSET,
+    STATS_SETS_UNION,
+    STATS_SETS_INTERSECTION,
+    STATS_SETS_DIFFERENCE,
+    STATS_SETS_SYMMETRIC_DIFFERENCE,
+    STATS_COMPLEMENT_SET,
+    STATS_FUNCTION_COUNT
+} StatsFunction;
+
+typedef struct {
+    uint64_t calls[STATS_FUNCTION_COUNT];
+    uint64_t nanoseconds[STATS_FUNCTION_COUNT];
+    uint64_t histogram[STATS_FUNCTION_COUNT][STATS_HISTOGRAM_BUCKETS];
+    uint64_t setsCreated;
+    uint64_t setsDestroyed;
+    uint64_t bytesAllocated;
+    uint64_t bytesReleased;
+} StatsSnapshot;
+
+// Часы в наносекундах и обработчик каждого замера
+typedef uint64_t (*StatsClock)(void);
+typedef void (*StatsHook)(StatsFunction function, uint64_t nanoseconds,
+                          void* context);
+
+/*
+ * Без -DBITSET_STATS макросы ничего не порождают, а снимок всегда пуст.
+ * Счётчики ведёт каждый поток отдельно; снимок суммирует все потоки,
+ * включая завершившиеся.
+ */
+void statsSnapshot(StatsSnapshot* snapshot);
+void statsReset(void);
+const char* statsFunctionName(StatsFunction function);
+void statsSetClock(StatsClock clock);
+void statsSetHook(StatsHook hook, void* context);
+
+#ifdef BITSET_STATS
+
+uint64_t statsBegin(void);
+void statsEnd(StatsFunction function, uint64_t start);
+void statsMemory(int64_t sets, int64_t bytes);
+
+#define STATS_BEGIN() uint64_t statsStart = statsBegin()
+#define STATS_END(function) statsEnd((function), statsStart)
+#define STATS_MEMORY(sets, bytes) statsMemory((sets), (bytes))
+
+#else
+
+#define STATS_BEGIN() ((void)0)
+#define STATS_END(function) ((void)0)
+#define STATS_MEMORY(sets, bytes) ((void)0)
+
+#endif
+
+#endif
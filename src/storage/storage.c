@@ -0,0 +1,733 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "storage.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../stats/stats.h"
+
+static const char storageMagic[8] = {'B', 'I', 'T', 'S', 'E', 'T', 0, 0};
+
+// Заполнение между заголовком и словами
+static const unsigned char padding[STORAGE_DATA_OFFSET] = {0};
+
+uint64_t storageChecksum(const uint64_t* words, size_t count) {
+    uint64_t hash = 0x9E3779B97F4A7C15ULL ^ count;
+
+    for (size_t iter = 0; iter < count; iter++) {
+        hash = (hash ^ words[iter]) * 0xFF51AFD7ED558CCDULL;
+        hash ^= hash >> 32;
+    }
+
+    return hash;
+}
+
+static uint64_t headerChecksum(BitsetFileHeader* header) {
+    return storageChecksum((const uint64_t*)header,
+                           offsetof(BitsetFileHeader, headerChecksum) /
+                               sizeof(uint64_t));
+}
+
+int bitsetSave(BitSet* set, const char* path) {
+    int   status_code = 0;
+    FILE* file        = fopen(path, "wb");
+
+    if (bitsetBlocks(set) == NULL || file == NULL) {
+        status_code = errorReport(ERROR_IO, 0, 0);
+    } else {
+        BitsetFileHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, storageMagic, sizeof(storageMagic));
+        header.version = STORAGE_VERSION;
+        header.headerSize = sizeof(BitsetFileHeader);
+        header.wordOrder = STORAGE_WORD_ORDER;
+        header.capacity = set->capacity;
+        header.size = set->size;
+        header.blockCount = set->blockCount;
+        header.dataOffset = STORAGE_DATA_OFFSET;
+        header.dataChecksum =
+            storageChecksum(bitsetBlocks(set), set->blockCount);
+        header.headerChecksum = headerChecksum(&header);
+
+        if (fwrite(&header, sizeof(header), 1, file) != 1 ||
+            fwrite(padding, STORAGE_DATA_OFFSET - sizeof(header), 1, file) != 1 ||
+            fwrite(bitsetBlocks(set), sizeof(uint64_t), set->blockCount,
+                   file) != set->blockCount) {
+            status_code = errorReport(ERROR_IO, 0, 0);
+        }
+    }
+
+    if (file != NULL && fclose(file) != 0) {
+        status_code = errorReport(ERROR_IO, 0, 0);
+    }
+
+    return status_code;
+}
+
+// Отображение освобождается целиком вместе с заголовком
+static void mappedRelease(Allocator* allocator, void* memory, size_t bytes) {
+    (void)allocator;
+    munmap((unsigned char*)memory - STORAGE_DATA_OFFSET,
+           STORAGE_DATA_OFFSET + bytes);
+}
+
+static Allocator mappedAllocator = {NULL, mappedRelease, NULL};
+
+static bool headerIsValid(BitsetFileHeader* header, size_t fileSize) {
+    return memcmp(header->magic, storageMagic, sizeof(storageMagic)) == 0 &&
+           header->version == STORAGE_VERSION &&
+           header->headerSize == sizeof(BitsetFileHeader) &&
+           header->wordOrder == STORAGE_WORD_ORDER &&
+           header->headerChecksum == headerChecksum(header) &&
+           header->dataOffset == STORAGE_DATA_OFFSET &&
+           header->blockCount == header->capacity / 64 + 1 &&
+           header->size <= header->capacity + 1 &&
+           header->blockCount <=
+               (fileSize - STORAGE_DATA_OFFSET) / sizeof(uint64_t);
+}
+
+/*
+ * Открывает сохранённое множество без чтения слов: данные подгружаются
+ * страницами по мере обращения и делятся между процессами через кэш
+ * страниц. bitsetDestroy снимает отображение.
+ */
+int bitsetOpenMapped(const char* path, int flags, BitSet* set) {
+    int            status_code = 0;
+    unsigned char* mapping     = MAP_FAILED;
+    size_t         length      = 0;
+    int            descriptor  = open(path, O_RDONLY);
+    struct stat    info;
+
+    if (descriptor < 0 || fstat(descriptor, &info) != 0 ||
+        (size_t)info.st_size < STORAGE_DATA_OFFSET) {
+        status_code = errorReport(ERROR_IO, 0, 0);
+    } else {
+        bool copyOnWrite = (flags & BITSET_MAP_COPY_ON_WRITE) != 0;
+
+        length = (size_t)info.st_size;
+        mapping = (unsigned char*)mmap(
+            NULL, length, copyOnWrite ? PROT_READ | PROT_WRITE : PROT_READ,
+            copyOnWrite ? MAP_PRIVATE : MAP_SHARED, descriptor, 0);
+        if (mapping == MAP_FAILED) {
+            status_code = errorReport(ERROR_IO, 0, 0);
+        }
+    }
+
+    if (descriptor >= 0) {
+        close(descriptor);
+    }
+
+    if (status_code == 0) {
+        BitsetFileHeader* header = (BitsetFileHeader*)mapping;
+        uint64_t*         words  = (uint64_t*)(mapping + STORAGE_DATA_OFFSET);
+
+        if (!headerIsValid(header, length) ||
+            ((flags & BITSET_MAP_VERIFY) != 0 &&
+             storageChecksum(words, header->blockCount) !=
+                 header->dataChecksum)) {
+            status_code = errorReport(ERROR_FORMAT, 0, 0);
+            munmap(mapping, length);
+        } else {
+            // Хвост файла за словами не нужен и снимается сразу, чтобы
+            // bitsetDestroy знал длину отображения по числу слов
+            size_t used = STORAGE_DATA_OFFSET +
+                          header->blockCount * sizeof(uint64_t);
+            size_t page = (size_t)sysconf(_SC_PAGESIZE);
+            size_t keep = (used + page - 1) / page * page;
+            if (keep < length) {
+                munmap(mapping + keep, length - keep);
+            }
+
+            set->bits = words;
+            set->blockCount = header->blockCount;
+            set->size = header->size;
+            set->capacity = header->capacity;
+            set->allocator = &mappedAllocator;
+            set->index = NULL;
+            set->summary = NULL;
+            set->growable = false;
+        }
+    }
+
+    return status_code;
+}
+
+/*
+ * Общие страницы копий. Слова множества из bitsetCreateShared
+ * отображаются закрыто (MAP_PRIVATE) из объекта общей памяти (shm_open,
+ * только POSIX). Объект делится на участки: участок записывается один раз
+ * и дальше только читается, пока его отображает хотя бы один отрезок.
+ * Запись в страницу копирует её в память множества и отмечает изменённой;
+ * bitsetClone сохраняет изменённые страницы в новые участки, не трогая
+ * отображение оригинала, и копия получает те же участки.
+ */
+typedef struct SharedFile SharedFile;
+
+// Свободные страницы объекта
+typedef struct {
+    size_t page;
+    size_t count;
+} SharedRange;
+
+struct SharedFile {
+    int             descriptor;
+    pthread_mutex_t lock;       // Выделение и освобождение участков
+    size_t          pageCount;  // Длина объекта в страницах
+    SharedRange*    free;       // Свободные страницы по возрастанию
+    size_t          freeCount;
+    size_t          segments;   // Живые участки; с последним объект закрывается
+};
+
+// Участок объекта: страницы [page, page + count)
+typedef struct {
+    SharedFile*   file;
+    size_t        page;
+    size_t        count;
+    atomic_size_t references;  // Отрезков, отображающих участок
+} SharedSegment;
+
+// Страницы множества [page, page + count) из участка со сдвигом offset
+typedef struct {
+    size_t         page;
+    size_t         count;
+    SharedSegment* segment;
+    size_t         offset;
+} SharedRun;
+
+// Распределитель слов множества: снимает отображение и отпускает участки
+typedef struct {
+    Allocator   base;       // Первое поле: в множестве хранится &base
+    SharedFile* file;
+    SharedRun*  runs;       // Отрезки по возрастанию, покрывают все страницы
+    size_t      runCount;
+    uint64_t*   dirty;      // Страницы, изменённые после прошлой копии
+    size_t      pageCount;
+    size_t      pageWords;  // Слов в странице
+} SharedWords;
+
+static size_t pageBytes(void) {
+    return (size_t)sysconf(_SC_PAGESIZE);
+}
+
+/*
+ * Новый объект. Имя удаляется сразу после создания: объект живёт, пока
+ * открыт дескриптор или есть отображения.
+ */
+static SharedFile* fileCreate(void) {
+    static atomic_size_t counter = 0;
+
+    SharedFile* file = (SharedFile*)malloc(sizeof(SharedFile));
+    char        name[64];
+
+    snprintf(name, sizeof(name), "/bitset-%ld-%zu", (long)getpid(),
+             atomic_fetch_add(&counter, 1));
+    if (file != NULL) {
+        file->descriptor = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (file->descriptor >= 0) {
+            shm_unlink(name);
+            pthread_mutex_init(&file->lock, NULL);
+            file->pageCount = 0;
+            file->free = NULL;
+            file->freeCount = 0;
+            file->segments = 0;
+        } else {
+            free(file);
+            file = NULL;
+        }
+    }
+
+    return file;
+}
+
+static void fileDestroy(SharedFile* file) {
+    close(file->descriptor);
+    pthread_mutex_destroy(&file->lock);
+    free(file->free);
+    free(file);
+}
+
+// Берёт свободные страницы или удлиняет объект; вызывается под lock
+static int fileTake(SharedFile* file, size_t count, size_t* page) {
+    int    status_code = -1;
+    size_t found       = file->freeCount;
+
+    for (size_t iter = 0; iter < file->freeCount && found == file->freeCount;
+         iter++) {
+        if (file->free[iter].count >= count) {
+            found = iter;
+        }
+    }
+
+    if (found < file->freeCount) {
+        SharedRange* range = &file->free[found];
+
+        *page = range->page;
+        range->page += count;
+        range->count -= count;
+        if (range->count == 0) {
+            memmove(range, range + 1,
+                    (file->freeCount - found - 1) * sizeof(SharedRange));
+            file->freeCount--;
+        }
+        status_code = 0;
+    } else if (ftruncate(file->descriptor,
+                         (off_t)((file->pageCount + count) * pageBytes())) ==
+               0) {
+        *page = file->pageCount;
+        file->pageCount += count;
+        status_code = 0;
+    }
+
+    return status_code;
+}
+
+/*
+ * Возвращает страницы в список, сливая соседние. Объект не укорачивается:
+ * усечение отбирает у закрытых отображений и скопированные при записи
+ * страницы. Если памяти под список нет, страницы больше не используются.
+ * Вызывается под lock.
+ */
+static void fileGive(SharedFile* file, size_t page, size_t count) {
+    size_t at = 0;
+
+    while (at < file->freeCount && file->free[at].page < page) {
+        at++;
+    }
+
+    if (at > 0 && file->free[at - 1].page + file->free[at - 1].count == page) {
+        at--;
+        file->free[at].count += count;
+    } else {
+        SharedRange* ranges = (SharedRange*)realloc(
+            file->free, (file->freeCount + 1) * sizeof(SharedRange));
+        if (ranges != NULL) {
+            memmove(ranges + at + 1, ranges + at,
+                    (file->freeCount - at) * sizeof(SharedRange));
+            ranges[at].page = page;
+            ranges[at].count = count;
+            file->free = ranges;
+            file->freeCount++;
+        }
+    }
+
+    if (at + 1 < file->freeCount &&
+        file->free[at].page + file->free[at].count == file->free[at + 1].page) {
+        file->free[at].count += file->free[at + 1].count;
+        memmove(file->free + at + 1, file->free + at + 2,
+                (file->freeCount - at - 2) * sizeof(SharedRange));
+        file->freeCount--;
+    }
+}
+
+// Участок с одной ссылкой; содержимое страниц не определено
+static SharedSegment* segmentCreate(SharedFile* file, size_t count) {
+    SharedSegment* segment = (SharedSegment*)malloc(sizeof(SharedSegment));
+
+    if (segment != NULL) {
+        pthread_mutex_lock(&file->lock);
+        if (fileTake(file, count, &segment->page) == 0) {
+            file->segments++;
+        } else {
+            free(segment);
+            segment = NULL;
+        }
+        pthread_mutex_unlock(&file->lock);
+    }
+
+    if (segment != NULL) {
+        segment->file = file;
+        segment->count = count;
+        atomic_init(&segment->references, 1);
+    }
+
+    return segment;
+}
+
+static void segmentRelease(SharedSegment* segment) {
+    if (atomic_fetch_sub(&segment->references, 1) == 1) {
+        SharedFile* file = segment->file;
+        bool        last = false;
+
+        pthread_mutex_lock(&file->lock);
+        fileGive(file, segment->page, segment->count);
+        file->segments--;
+        last = file->segments == 0;
+        pthread_mutex_unlock(&file->lock);
+
+        free(segment);
+        if (last) {
+            fileDestroy(file);
+        }
+    }
+}
+
+static int writeAll(int descriptor, const unsigned char* data, size_t bytes,
+                    off_t offset) {
+    int status_code = 0;
+
+    while (status_code == 0 && bytes > 0) {
+        ssize_t written = pwrite(descriptor, data, bytes, offset);
+        if (written <= 0) {
+            status_code = -1;
+        } else {
+            data += written;
+            bytes -= (size_t)written;
+            offset += written;
+        }
+    }
+
+    return status_code;
+}
+
+static void sharedFree(SharedWords* shared) {
+    for (size_t iter = 0; iter < shared->runCount; iter++) {
+        segmentRelease(shared->runs[iter].segment);
+    }
+    free(shared->runs);
+    free(shared->dirty);
+    free(shared);
+}
+
+static void sharedRelease(Allocator* allocator, void* memory, size_t bytes) {
+    SharedWords* shared = (SharedWords*)allocator;
+
+    (void)bytes;
+    munmap(memory, shared->pageCount * pageBytes());
+    sharedFree(shared);
+}
+
+static void sharedTouch(Allocator* allocator, size_t fromBlock,
+                        size_t toBlock) {
+    SharedWords* shared = (SharedWords*)allocator;
+    size_t       last   = (toBlock - 1) / shared->pageWords;
+
+    for (size_t page = fromBlock / shared->pageWords; page <= last; page++) {
+        shared->dirty[page / 64] |= (uint64_t)1 << (page % 64);
+    }
+}
+
+static bool pageIsDirty(SharedWords* shared, size_t page) {
+    return (shared->dirty[page / 64] >> (page % 64) & 1) != 0;
+}
+
+// Распределитель без отрезков; место под runCount отрезков выделено
+static SharedWords* sharedNew(SharedFile* file, size_t pageCount,
+                              size_t runCount) {
+    SharedWords* shared = (SharedWords*)malloc(sizeof(SharedWords));
+
+    if (shared != NULL) {
+        shared->runs = (SharedRun*)malloc(runCount * sizeof(SharedRun));
+        shared->dirty = (uint64_t*)calloc((pageCount + 63) / 64,
+                                          sizeof(uint64_t));
+        if (shared->runs == NULL || shared->dirty == NULL) {
+            free(shared->runs);
+            free(shared->dirty);
+            free(shared);
+            shared = NULL;
+        }
+    }
+
+    if (shared != NULL) {
+        shared->base.allocate = NULL;
+        shared->base.release = sharedRelease;
+        shared->base.touch = sharedTouch;
+        shared->file = file;
+        shared->runCount = 0;
+        shared->pageCount = pageCount;
+        shared->pageWords = pageBytes() / sizeof(uint64_t);
+    }
+
+    return shared;
+}
+
+static off_t runOffset(SharedRun* run) {
+    return (off_t)((run->segment->page + run->offset) * pageBytes());
+}
+
+// Отображает отрезки подряд; NULL, если ОС не дала отображение
+static uint64_t* sharedMap(SharedWords* shared) {
+    size_t         page       = pageBytes();
+    size_t         length     = shared->pageCount * page;
+    int            descriptor = shared->file->descriptor;
+    unsigned char* words      = (unsigned char*)mmap(
+        NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, descriptor,
+        runOffset(&shared->runs[0]));
+
+    for (size_t iter = 1; iter < shared->runCount && words != MAP_FAILED;
+         iter++) {
+        SharedRun* run = &shared->runs[iter];
+        if (mmap(words + run->page * page, run->count * page,
+                 PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, descriptor,
+                 runOffset(run)) == MAP_FAILED) {
+            munmap(words, length);
+            words = (unsigned char*)MAP_FAILED;
+        }
+    }
+
+    return words != MAP_FAILED ? (uint64_t*)words : NULL;
+}
+
+// Отрезок run, обрезанный до страниц [from, to), с новой ссылкой на участок
+static SharedRun runPiece(SharedRun* run, size_t from, size_t to) {
+    SharedRun piece = *run;
+
+    piece.page = from;
+    piece.count = to - from;
+    piece.offset = run->offset + (from - run->page);
+    atomic_fetch_add(&run->segment->references, 1);
+    return piece;
+}
+
+/*
+ * Страницы [page, page + count) берутся из нового участка: отрезки слева
+ * и справа обрезаются, ссылка на участок переходит к распределителю.
+ */
+static int sharedReplace(SharedWords* shared, size_t page, size_t count,
+                         SharedSegment* segment) {
+    int        status_code = 0;
+    size_t     end         = page + count;
+    size_t     used        = 0;
+    SharedRun* runs        = (SharedRun*)malloc((shared->runCount + 2) *
+                                                sizeof(SharedRun));
+
+    if (runs == NULL) {
+        status_code = -1;
+    } else {
+        for (size_t iter = 0; iter < shared->runCount; iter++) {
+            SharedRun* run = &shared->runs[iter];
+            if (run->page < page) {
+                size_t to = run->page + run->count;
+                runs[used++] = runPiece(run, run->page, to < page ? to : page);
+            }
+        }
+
+        runs[used].page = page;
+        runs[used].count = count;
+        runs[used].segment = segment;
+        runs[used].offset = 0;
+        used++;
+
+        for (size_t iter = 0; iter < shared->runCount; iter++) {
+            SharedRun* run = &shared->runs[iter];
+            size_t     to  = run->page + run->count;
+            if (to > end) {
+                runs[used++] = runPiece(run, run->page > end ? run->page : end,
+                                        to);
+            }
+        }
+
+        for (size_t iter = 0; iter < shared->runCount; iter++) {
+            segmentRelease(shared->runs[iter].segment);
+        }
+        free(shared->runs);
+        shared->runs = runs;
+        shared->runCount = used;
+    }
+
+    return status_code;
+}
+
+/*
+ * Переносит изменённые страницы в новые участки за O(число изменённых
+ * страниц и отрезков). Отображение множества не меняется: его страницы
+ * остаются у него, а участки получают их копию.
+ */
+static int sharedSave(SharedWords* shared, unsigned char* words) {
+    int    status_code = 0;
+    size_t bytes       = pageBytes();
+    size_t first       = 0;
+
+    while (status_code == 0 && first < shared->pageCount) {
+        if (first % 64 == 0 && shared->dirty[first / 64] == 0) {
+            first += 64;
+        } else if (!pageIsDirty(shared, first)) {
+            first++;
+        } else {
+            size_t end = first + 1;
+            while (end < shared->pageCount && pageIsDirty(shared, end)) {
+                end++;
+            }
+
+            // Страница могла быть отмечена без записи и ещё отображать
+            // старый участок, который освободится: запись того же слова
+            // отделяет её от участка
+            for (size_t page = first; page < end; page++) {
+                volatile uint64_t* word =
+                    (volatile uint64_t*)(words + page * bytes);
+                *word = *word;
+            }
+
+            SharedSegment* segment = segmentCreate(shared->file, end - first);
+            status_code = segment != NULL
+                              ? writeAll(shared->file->descriptor,
+                                         words + first * bytes,
+                                         (end - first) * bytes,
+                                         (off_t)(segment->page * bytes))
+                              : -1;
+            if (status_code == 0) {
+                status_code = sharedReplace(shared, first, end - first,
+                                            segment);
+            }
+
+            if (status_code == 0) {
+                for (size_t page = first; page < end; page++) {
+                    shared->dirty[page / 64] &= ~((uint64_t)1 << (page % 64));
+                }
+            } else if (segment != NULL) {
+                segmentRelease(segment);
+            }
+            first = end;
+        }
+    }
+
+    return status_code;
+}
+
+/*
+ * Новый объект из одного участка со словами words (NULL — нули). Копия
+ * слов стоит O(n) и делается один раз; дальше копии берут участки.
+ */
+static SharedWords* sharedCreate(const uint64_t* words, size_t bytes) {
+    size_t         page      = pageBytes();
+    size_t         pageCount = (bytes + page - 1) / page;
+    SharedFile*    file      = fileCreate();
+    SharedSegment* segment   = file != NULL ? segmentCreate(file, pageCount)
+                                            : NULL;
+    SharedWords*   shared    = segment != NULL ? sharedNew(file, pageCount, 1)
+                                               : NULL;
+
+    if (shared != NULL) {
+        shared->runs[0].page = 0;
+        shared->runs[0].count = pageCount;
+        shared->runs[0].segment = segment;
+        shared->runs[0].offset = 0;
+        shared->runCount = 1;
+        if (words != NULL &&
+            writeAll(file->descriptor, (const unsigned char*)words, bytes,
+                     (off_t)(segment->page * page)) != 0) {
+            sharedFree(shared);
+            shared = NULL;
+        }
+    } else if (segment != NULL) {
+        segmentRelease(segment);
+    } else if (file != NULL) {
+        fileDestroy(file);
+    }
+
+    return shared;
+}
+
+// Распределитель копии с теми же участками, что у оригинала
+static SharedWords* sharedFork(SharedWords* source, uint64_t* words) {
+    SharedWords* shared = NULL;
+
+    if (sharedSave(source, (unsigned char*)words) == 0) {
+        shared = sharedNew(source->file, source->pageCount, source->runCount);
+    }
+
+    if (shared != NULL) {
+        for (size_t iter = 0; iter < source->runCount; iter++) {
+            SharedRun* run = &source->runs[iter];
+            shared->runs[iter] = runPiece(run, run->page,
+                                          run->page + run->count);
+        }
+        shared->runCount = source->runCount;
+    }
+
+    return shared;
+}
+
+static bool sharedOwns(BitSet* set) {
+    return set->allocator != NULL && set->allocator->release == sharedRelease;
+}
+
+BitSet bitsetCreateShared(size_t capacity) {
+    size_t       blockCount = capacity / 64 + 1;
+    SharedWords* shared     = NULL;
+    uint64_t*    words      = NULL;
+    BitSet       set;
+
+    if (blockCount >= STORAGE_SHARE_MIN_WORDS) {
+        shared = sharedCreate(NULL, blockCount * sizeof(uint64_t));
+        words = shared != NULL ? sharedMap(shared) : NULL;
+        if (words == NULL && shared != NULL) {
+            sharedFree(shared);
+        }
+    }
+
+    if (words == NULL) {
+        set = bitsetCreate(capacity);
+    } else {
+        // Структура малого множества, слова — из общего объекта
+        set = bitsetCreate(0);
+        set.bits = words;
+        set.blockCount = blockCount;
+        set.capacity = capacity;
+        set.allocator = &shared->base;
+        STATS_MEMORY(0, (int64_t)(blockCount * sizeof(uint64_t)));
+    }
+
+    return set;
+}
+
+/*
+ * Копия множества из bitsetCreateShared (или другой такой копии) берёт
+ * его участки за O(числа отрезков и страниц, изменённых после прошлой
+ * копии). Остальные большие множества копируются один раз в новый объект,
+ * малые — распределителем оригинала. Без общей памяти слова копируются
+ * целиком.
+ */
+int bitsetClone(BitSet* source, BitSet* clone) {
+    int    status_code = bitsetBlocks(source) != NULL ? 0 : -1;
+    size_t bytes       = source->blockCount * sizeof(uint64_t);
+
+    if (status_code == 0) {
+        *clone = *source;
+        clone->index = NULL;
+        clone->summary = NULL;
+    }
+
+    if (status_code == 0 && source->bits != NULL) {
+        SharedWords* shared = NULL;
+
+        if (sharedOwns(source)) {
+            shared = sharedFork((SharedWords*)source->allocator, source->bits);
+        } else if (source->blockCount >= STORAGE_SHARE_MIN_WORDS) {
+            shared = sharedCreate(source->bits, bytes);
+        }
+        clone->bits = shared != NULL ? sharedMap(shared) : NULL;
+
+        if (clone->bits != NULL) {
+            clone->allocator = &shared->base;
+        } else {
+            if (shared != NULL) {
+                sharedFree(shared);
+            }
+            clone->allocator = allocatorResolve(source->allocator);
+            clone->bits = (uint64_t*)allocatorAllocate(clone->allocator,
+                                                       bytes);
+            status_code = memoryIsAllocated(clone->bits);
+            if (status_code == 0) {
+                memcpy(clone->bits, source->bits, bytes);
+            } else {
+                clone->blockCount = 0;
+                clone->capacity = 0;
+                clone->size = 0;
+            }
+        }
+    }
+
+    if (status_code == 0) {
+        STATS_MEMORY(1, clone->bits != NULL ? (int64_t)bytes : 0);
+    }
+
+    return status_code;
+}
@@ -0,0 +1,61 @@
+#ifndef STORAGE_H
+#define STORAGE_H
+
+#include <stdint.h>
+
+#include "../bitset/bitset.h"
+
+#define STORAGE_VERSION 1
+#define STORAGE_DATA_OFFSET 4096              // Слова начинаются с новой страницы
+#define STORAGE_WORD_ORDER 0x0706050403020100ULL
+#define STORAGE_SHARE_MIN_WORDS 8192          // Меньшие множества не делятся
+
+/* Флаги bitsetOpenMapped */
+#define BITSET_MAP_READ_ONLY 0       // Общие страницы, запись в множество запрещена
+#define BITSET_MAP_COPY_ON_WRITE 1   // Изменения видны только этому процессу
+#define BITSET_MAP_VERIFY 2          // Проверить контрольную сумму слов (O(n))
+
+/*
+ * Заголовок файла. wordOrder записывается в порядке байтов машины и
+ * отличает файлы с другим порядком. Элемент k хранится в бите k % 64
+ * слова k / 64 (версия 1).
+ */
+typedef struct {
+    char     magic[8];        // "BITSET\0\0"
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t wordOrder;
+    uint64_t capacity;
+    uint64_t size;
+    uint64_t blockCount;
+    uint64_t dataOffset;
+    uint64_t dataChecksum;    // Контрольная сумма слов
+    uint64_t headerChecksum;  // Контрольная сумма заголовка без этого поля
+} BitsetFileHeader;
+
+/* Сохранение и отображение множества в память без копирования */
+int bitsetSave(BitSet* set, const char* path);
+int bitsetOpenMapped(const char* path, int flags, BitSet* set);
+uint64_t storageChecksum(const uint64_t* words, size_t count);
+
+/*
+ * Копии с общими словами (только POSIX: объект общей памяти shm_open).
+ * bitsetCreateShared размещает слова множества от STORAGE_SHARE_MIN_WORDS
+ * слов в таком объекте; без общей памяти и для малых множеств это
+ * bitsetCreate. bitsetClone множества из bitsetCreateShared (или его
+ * копии) не копирует слова: оригинал и копии отображают общие страницы
+ * (512 слов при 4 КиБ), запись копирует только затронутую. Страницы,
+ * изменённые после прошлой копии, переносятся в общий объект за O(числа
+ * изменённых страниц); отображение оригинала при этом не меняется, и его
+ * слова не переносятся и не освобождаются. Другие множества копируются в
+ * новый общий объект целиком, малые — распределителем оригинала. Индекс и
+ * сводка в копию не переносятся; растущее множество при расширении
+ * переходит в обычную память. Копия освобождается bitsetDestroy независимо
+ * от оригинала. bitsetClone меняет учёт страниц оригинала: чтение
+ * оригинала из других потоков допустимо, запись и другие копии того же
+ * множества — нет.
+ */
+BitSet bitsetCreateShared(size_t capacity);
+int bitsetClone(BitSet* source, BitSet* clone);
+
+#endif
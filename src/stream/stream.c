@@ -0,0 +1,434 @@
+#include "stream.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "../popcount/popcount.h"
+
+#define STREAM_CHUNK_BYTES (STREAM_CHUNK_WORDS * sizeof(uint64_t))
+#define STREAM_CHUNK_BITS (STREAM_CHUNK_WORDS * 64)
+#define STREAM_WORD_ORDER 0x0706050403020100ULL
+
+static const char streamMagic[8] = {'B', 'S', 'T', 'R', 'E', 'A', 'M', 0};
+
+static size_t fileWrite(const void* data, size_t bytes, void* context) {
+    return fwrite(data, 1, bytes, (FILE*)context);
+}
+
+static size_t fileRead(void* data, size_t bytes, void* context) {
+    return fread(data, 1, bytes, (FILE*)context);
+}
+
+static int fileSkip(size_t bytes, void* context) {
+    return fseek((FILE*)context, (long)bytes, SEEK_CUR) == 0 ? 0 : -1;
+}
+
+StreamSink streamFileSink(FILE* file) {
+    StreamSink sink = {fileWrite, file};
+    return sink;
+}
+
+StreamSource streamFileSource(FILE* file) {
+    StreamSource source = {fileRead, fileSkip, file};
+    return source;
+}
+
+static size_t varintLength(uint64_t value) {
+    size_t length = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        length++;
+    }
+    return length;
+}
+
+static size_t varintPut(uint8_t* out, uint64_t value) {
+    size_t length = 0;
+    while (value >= 0x80) {
+        out[length++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[length++] = (uint8_t)value;
+    return length;
+}
+
+// -1, если число обрывается на конце данных или длиннее 64 бит
+static int varintGet(const uint8_t* data, size_t length, size_t* offset,
+                     uint64_t* value) {
+    int      status_code = -1;
+    uint64_t result      = 0;
+
+    for (int shift = 0; shift < 64 && *offset < length; shift += 7) {
+        uint8_t byte = data[(*offset)++];
+        result |= (uint64_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            status_code = 0;
+            break;
+        }
+    }
+    *value = result;
+
+    return status_code;
+}
+
+// Первая позиция не раньше position, где бит отличен от value
+static size_t nextChange(const uint64_t* words, size_t bitCount,
+                         size_t position, bool value) {
+    size_t change = bitCount;
+
+    while (position < bitCount && change == bitCount) {
+        uint64_t word = words[position / 64] ^ (value ? ~(uint64_t)0 : 0);
+        word &= ~(uint64_t)0 << (position % 64);
+        if (word != 0) {
+            change = position / 64 * 64 + (size_t)__builtin_ctzll(word);
+        } else {
+            position = (position / 64 + 1) * 64;
+        }
+    }
+
+    return change < bitCount ? change : bitCount;
+}
+
+/*
+ * Размеры кодировок считаются с ограничением limit: как только размер
+ * его превышает, подсчёт прекращается.
+ */
+static size_t runsLength(const uint64_t* words, size_t count, size_t limit) {
+    size_t bitCount = count * 64;
+    size_t position = 0;
+    size_t bytes    = 0;
+    bool   value    = false;
+
+    while (position < bitCount && bytes <= limit) {
+        size_t next = nextChange(words, bitCount, position, value);
+        bytes += varintLength(next - position);
+        position = next;
+        value = !value;
+    }
+
+    return bytes;
+}
+
+static size_t deltaLength(const uint64_t* words, size_t count, size_t limit) {
+    size_t bytes    = varintLength(popcountBlocks(words, count));
+    size_t previous = 0;
+    bool   isFirst  = true;
+
+    for (size_t block = 0; block < count && bytes <= limit; block++) {
+        uint64_t word = words[block];
+        while (word != 0) {
+            size_t element = block * 64 + (size_t)__builtin_ctzll(word);
+            bytes += varintLength(isFirst ? element : element - previous - 1);
+            previous = element;
+            isFirst = false;
+            word &= word - 1;
+        }
+    }
+
+    return bytes;
+}
+
+static size_t encodeRuns(const uint64_t* words, size_t count, uint8_t* out) {
+    size_t bitCount = count * 64;
+    size_t position = 0;
+    size_t bytes    = 0;
+    bool   value    = false;
+
+    while (position < bitCount) {
+        size_t next = nextChange(words, bitCount, position, value);
+        bytes += varintPut(out + bytes, next - position);
+        position = next;
+        value = !value;
+    }
+
+    return bytes;
+}
+
+static size_t encodeDelta(const uint64_t* words, size_t count, uint8_t* out) {
+    size_t bytes    = varintPut(out, popcountBlocks(words, count));
+    size_t previous = 0;
+    bool   isFirst  = true;
+
+    for (size_t block = 0; block < count; block++) {
+        uint64_t word = words[block];
+        while (word != 0) {
+            size_t element = block * 64 + (size_t)__builtin_ctzll(word);
+            bytes += varintPut(out + bytes,
+                               isFirst ? element : element - previous - 1);
+            previous = element;
+            isFirst = false;
+            word &= word - 1;
+        }
+    }
+
+    return bytes;
+}
+
+static int writeExact(StreamSink* sink, const void* data, size_t bytes) {
+    int status_code = 0;
+    if (sink->write(data, bytes, sink->context) != bytes) {
+        status_code = errorReport(ERROR_IO, 0, 0);
+    }
+    return status_code;
+}
+
+/*
+ * Каждая непустая порция кодируется самым коротким из трёх способов.
+ * Пустые порции не записываются.
+ */
+int streamWrite(BitSet* set, StreamSink* sink) {
+    int          status_code = bitsetBlocks(set) != NULL ? 0 : -1;
+    uint8_t      payload[STREAM_CHUNK_BYTES];
+    StreamHeader header;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, streamMagic, sizeof(streamMagic));
+    header.version = STREAM_VERSION;
+    header.chunkWords = STREAM_CHUNK_WORDS;
+    header.wordOrder = STREAM_WORD_ORDER;
+    header.capacity = set->capacity;
+    header.size = set->size;
+
+    if (status_code == 0) {
+        status_code = writeExact(sink, &header, sizeof(header));
+    }
+
+    for (size_t start = 0; start < set->blockCount && status_code == 0;
+         start += STREAM_CHUNK_WORDS) {
+        size_t          count = set->blockCount - start;
+        const uint64_t* words = bitsetBlocks(set) + start;
+        if (count > STREAM_CHUNK_WORDS) {
+            count = STREAM_CHUNK_WORDS;
+        }
+
+        bool isEmpty = true;
+        for (size_t block = 0; block < count && isEmpty; block++) {
+            isEmpty = words[block] == 0;
+        }
+
+        if (!isEmpty) {
+            size_t raw   = count * sizeof(uint64_t);
+            size_t runs  = runsLength(words, count, raw);
+            size_t delta = deltaLength(words, count, raw);
+
+            StreamChunkHeader chunk = {(uint32_t)(start / STREAM_CHUNK_WORDS),
+                                       STREAM_RAW, 0, 0};
+            if (runs < raw && runs <= delta) {
+                chunk.encoding = STREAM_RUNS;
+                chunk.payloadBytes = (uint32_t)encodeRuns(words, count, payload);
+            } else if (delta < raw) {
+                chunk.encoding = STREAM_DELTA;
+                chunk.payloadBytes =
+                    (uint32_t)encodeDelta(words, count, payload);
+            } else {
+                chunk.payloadBytes = (uint32_t)raw;
+                memcpy(payload, words, raw);
+            }
+
+            status_code = writeExact(sink, &chunk, sizeof(chunk));
+            if (status_code == 0) {
+                status_code = writeExact(sink, payload, chunk.payloadBytes);
+            }
+        }
+    }
+
+    if (status_code == 0) {
+        StreamChunkHeader end = {STREAM_END_CHUNK, 0, 0, 0};
+        status_code = writeExact(sink, &end, sizeof(end));
+    }
+
+    return status_code;
+}
+
+static int readExact(StreamSource* source, void* data, size_t bytes) {
+    int status_code = 0;
+    if (source->read(data, bytes, source->context) != bytes) {
+        status_code = errorReport(ERROR_IO, 0, 0);
+    }
+    return status_code;
+}
+
+// Пропуск данных порции; без skip данные читаются в буфер и отбрасываются
+static int skipExact(StreamSource* source, size_t bytes, uint8_t* buffer) {
+    int status_code = -1;
+
+    if (source->skip != NULL) {
+        status_code = source->skip(bytes, source->context);
+    }
+    if (status_code != 0) {
+        status_code = readExact(source, buffer, bytes);
+    }
+
+    return status_code;
+}
+
+/*
+ * Декодирует порцию в множество, начиная с элемента base. Слова
+ * множества в пределах порции должны быть нулевыми.
+ */
+static int decodeChunk(BitSet* set, StreamChunkHeader* chunk,
+                       const uint8_t* payload, size_t base) {
+    int    status_code = 0;
+    size_t start       = base / 64;
+    size_t count       = set->blockCount - start;
+    size_t length      = chunk->payloadBytes;
+    size_t offset      = 0;
+    if (count > STREAM_CHUNK_WORDS) {
+        count = STREAM_CHUNK_WORDS;
+    }
+
+    if (chunk->encoding == STREAM_RAW) {
+        if (length != count * sizeof(uint64_t)) {
+            status_code = -1;
+        } else {
+            uint64_t* bits = bitsetBlocks(set);
+
+            memcpy(bits + start, payload, length);
+            if (start + count == set->blockCount) {
+                bits[set->blockCount - 1] &= bitsetLastBlockMask(set->capacity);
+            }
+            set->size += popcountBlocks(bits + start, count);
+        }
+    } else if (chunk->encoding == STREAM_RUNS) {
+        size_t position = base;
+        bool   value    = false;
+
+        while (offset < length && status_code == 0) {
+            uint64_t run = 0;
+            status_code = varintGet(payload, length, &offset, &run);
+            if (status_code == 0 && run > base + count * 64 - position) {
+                status_code = -1;
+            }
+            if (status_code == 0 && value) {
+                status_code = bitsetAddRange(set, (int)position,
+                                             (int)(position + run));
+            }
+            position += run;
+            value = !value;
+        }
+    } else if (chunk->encoding == STREAM_DELTA) {
+        uint64_t elements = 0;
+        uint64_t element  = base;
+
+        status_code = varintGet(payload, length, &offset, &elements);
+        for (uint64_t iter = 0; iter < elements && status_code == 0; iter++) {
+            uint64_t gap = 0;
+            status_code = varintGet(payload, length, &offset, &gap);
+            element += iter == 0 ? gap : gap + 1;
+            if (status_code == 0 &&
+                (gap > STREAM_CHUNK_BITS || element > set->capacity ||
+                 element >= base + STREAM_CHUNK_BITS)) {
+                status_code = -1;
+            }
+            if (status_code == 0) {
+                bitsetAddUnchecked(set, (int)element);
+            }
+        }
+    } else {
+        status_code = -1;
+    }
+
+    return status_code;
+}
+
+/*
+ * Читает поток в новое множество. Порции вне [lo, hi) пропускаются без
+ * декодирования; чтение заканчивается на первой порции за hi.
+ */
+static int streamDecode(StreamSource* source, BitSet* set, size_t lo,
+                        size_t hi, bool isFull) {
+    int          status_code = 0;
+    uint8_t      payload[STREAM_CHUNK_BYTES];
+    StreamHeader header;
+
+    // До чтения заголовка множество выглядит как после неудачного
+    // bitsetCreate, чтобы bitsetDestroy был безопасен при любой ошибке
+    memset(set, 0, sizeof(*set));
+    set->allocator = allocatorDefault();
+    status_code = readExact(source, &header, sizeof(header));
+
+    if (status_code == 0 &&
+        (memcmp(header.magic, streamMagic, sizeof(streamMagic)) != 0 ||
+         header.version != STREAM_VERSION ||
+         header.chunkWords != STREAM_CHUNK_WORDS ||
+         header.wordOrder != STREAM_WORD_ORDER ||
+         header.capacity > (uint64_t)INT32_MAX)) {
+        status_code = errorReport(ERROR_FORMAT, 0, 0);
+    }
+
+    if (status_code == 0) {
+        *set = bitsetCreate(header.capacity);
+        status_code = memoryIsAllocated(bitsetBlocks(set));
+    }
+
+    size_t chunkCount = (set->blockCount + STREAM_CHUNK_WORDS - 1) /
+                        STREAM_CHUNK_WORDS;
+    bool   isDone     = status_code != 0;
+    size_t nextIndex  = 0;
+
+    if (hi > set->capacity + 1) {
+        hi = set->capacity + 1;
+    }
+
+    while (!isDone) {
+        StreamChunkHeader chunk;
+        status_code = readExact(source, &chunk, sizeof(chunk));
+
+        if (status_code == 0 && chunk.index == STREAM_END_CHUNK) {
+            isDone = true;
+        } else if (status_code == 0 &&
+                   (chunk.index < nextIndex || chunk.index >= chunkCount ||
+                    chunk.payloadBytes > STREAM_CHUNK_BYTES)) {
+            status_code = errorReport(ERROR_FORMAT, 0, 0);
+        } else if (status_code == 0) {
+            size_t base = (size_t)chunk.index * STREAM_CHUNK_BITS;
+            size_t end  = base + STREAM_CHUNK_BITS;
+            if (end > set->capacity + 1) {
+                end = set->capacity + 1;
+            }
+
+            nextIndex = (size_t)chunk.index + 1;
+            if (base >= hi) {
+                isDone = true;
+            } else if (end <= lo) {
+                status_code = skipExact(source, chunk.payloadBytes, payload);
+            } else {
+                status_code = readExact(source, payload, chunk.payloadBytes);
+                if (status_code == 0 &&
+                    decodeChunk(set, &chunk, payload, base) != 0) {
+                    status_code = errorReport(ERROR_FORMAT, 0, 0);
+                }
+                // Края порции за пределами [lo, hi)
+                if (status_code == 0 && base < lo) {
+                    bitsetRemoveRange(set, (int)base, (int)lo);
+                }
+                if (status_code == 0 && hi < end) {
+                    bitsetRemoveRange(set, (int)hi, (int)end);
+                }
+            }
+        }
+
+        isDone = isDone || status_code != 0;
+    }
+
+    if (status_code == 0 && isFull && set->size != header.size) {
+        status_code = errorReport(ERROR_FORMAT, 0, 0);
+    }
+    if (status_code != 0 && bitsetBlocks(set) != NULL) {
+        bitsetDestroy(set);
+    }
+
+    return status_code;
+}
+
+int streamRead(StreamSource* source, BitSet* set) {
+    return streamDecode(source, set, 0, SIZE_MAX, true);
+}
+
+int streamReadRange(StreamSource* source, BitSet* set, int lo, int hi) {
+    int status_code = -1;
+    if (lo >= 0 && lo <= hi) {
+        status_code = streamDecode(source, set, (size_t)lo, (size_t)hi, false);
+    }
+    return status_code;
+}
@@ -0,0 +1,65 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "../bitset/bitset.h"
+
+#define STREAM_VERSION 1
+#define STREAM_CHUNK_WORDS 1024    // Слов в порции (65536 элементов)
+#define STREAM_END_CHUNK UINT32_MAX
+
+typedef enum {
+    STREAM_RAW = 0,    // Слова порции как есть
+    STREAM_RUNS = 1,   // Длины чередующихся серий нулей и единиц (varint)
+    STREAM_DELTA = 2   // Число элементов и разности соседних элементов (varint)
+} StreamEncoding;
+
+/*
+ * Приёмник и источник байтов. write и read возвращают число обработанных
+ * байтов; skip необязателен (например, fseek) и возвращает 0 при успехе.
+ */
+typedef struct {
+    size_t (*write)(const void* data, size_t bytes, void* context);
+    void*  context;
+} StreamSink;
+
+typedef struct {
+    size_t (*read)(void* data, size_t bytes, void* context);
+    int    (*skip)(size_t bytes, void* context);
+    void*  context;
+} StreamSource;
+
+/*
+ * Поток: заголовок, затем непустые порции по возрастанию номера. Каждая
+ * порция начинается с номера, способа кодирования и длины данных, поэтому
+ * читатель пропускает ненужные порции без декодирования. Память обеих
+ * сторон ограничена одной порцией и не зависит от размера множества.
+ */
+typedef struct {
+    char     magic[8];      // "BSTREAM\0"
+    uint32_t version;
+    uint32_t chunkWords;
+    uint64_t wordOrder;
+    uint64_t capacity;
+    uint64_t size;
+} StreamHeader;
+
+typedef struct {
+    uint32_t index;         // Номер порции или STREAM_END_CHUNK
+    uint32_t encoding;      // StreamEncoding
+    uint32_t payloadBytes;  // Длина данных порции
+    uint32_t reserved;
+} StreamChunkHeader;
+
+/* Приёмник и источник поверх FILE* */
+StreamSink streamFileSink(FILE* file);
+StreamSource streamFileSource(FILE* file);
+
+/* Запись и чтение множества */
+int streamWrite(BitSet* set, StreamSink* sink);
+int streamRead(StreamSource* source, BitSet* set);
+int streamReadRange(StreamSource* source, BitSet* set, int lo, int hi);
+
+#endif
@@ -1,7 +1,20 @@
 #include <assert.h>
+#include <pthread.h>
+#include <string.h>
 #include <time.h>
 
 #include "../src/bitset/bitset.h"
+#include "../src/compare/compare.h"
+#include "../src/concurrent/concurrent.h"
+#include "../src/ewah/ewah.h"
+#include "../src/expression/expression.h"
+#include "../src/gather/gather.h"
+#include "../src/parallel/parallel.h"
+#include "../src/popcount/popcount.h"
+#include "../src/roaring/roaring.h"
+#include "../src/stats/stats.h"
+#include "../src/storage/storage.h"
+#include "../src/stream/stream.h"
 
 // Тестирование граничных значений
 void test_boundary() {
@@ -29,8 +42,19 @@ void test_performance() {
     clock_t end = clock();
     printf("Добавление %zu элементов заняло %.3f секунд.\n",
     N, (double)(end - start) / CLOCKS_PER_SEC);
-    
+
+    BitSet rangeSet = bitsetCreate(N);
+
+    start = clock();
+    bitsetAddRange(&rangeSet, 0, (int)N);
+    end = clock();
+    printf("Добавление диапазона из %zu элементов заняло %.6f секунд.\n",
+    N, (double)(end - start) / CLOCKS_PER_SEC);
+
+    assert(setsIsEqual(&set, &rangeSet) && "Ошибка, диапазон добавлен неверно");
+
     bitsetDestroy(&set);
+    bitsetDestroy(&rangeSet);
 }
 
 // Анализ утечек памяти (запускать с valgrind)
@@ -78,8 +102,8 @@ void test_subset() {
 
         int values[] = {0, 1, 5, 15, 50, 60, 252, 22, 250, 252, 2};
 
-        bitsetAddMany(&smallerSet, values, 12);
-        bitsetAddMany(&biggerSet, values, 12);
+        bitsetAddMany(&smallerSet, values, 11);
+        bitsetAddMany(&biggerSet, values, 11);
         
         assert(setIsSubset(&smallerSet, &biggerSet) && "Ошибка, множество не является подмножеством");
     }
@@ -108,8 +132,8 @@ void test_strict_subset() {
 
         int values[] = {0, 1, 5, 15, 50, 60, 252, 22, 250, 252, 2};
 
-        bitsetAddMany(&smallerSet, values, 12);
-        bitsetAddMany(&biggerSet, values, 12);
+        bitsetAddMany(&smallerSet, values, 11);
+        bitsetAddMany(&biggerSet, values, 11);
         
         assert(!setIsStrictSubset(&smallerSet, &biggerSet) && "Ошибка, множество не является подмножеством");
     }
@@ -121,8 +145,8 @@ void test_strict_subset() {
         int smallerValues[] = {2, 6, 11, 100};
         int biggerValues[] = {0, 2, 6, 11, 100, 150};
 
-        bitsetAddMany(&smallerSet, smallerValues, 12);
-        bitsetAddMany(&biggerSet, biggerValues, 12);
+        bitsetAddMany(&smallerSet, smallerValues, 4);
+        bitsetAddMany(&biggerSet, biggerValues, 6);
 
         assert(setIsStrictSubset(&smallerSet, &biggerSet) && "Ошибка, множество не является подмножеством");
     }
@@ -446,8 +470,1790 @@ void test_symmetric_difference() {
     }
 }
 
+void test_set_size() {
+    const size_t N = 100000;
+    BitSet set = bitsetCreate(N);
+
+    for (size_t iter = 0; iter < N; iter += 3) {
+        bitsetAdd(&set, iter);
+    }
+    bitsetAdd(&set, 63);
+    bitsetAdd(&set, 64);
+
+    size_t expectedSize = set.size;
+    PopcountKernel kernels[] = {POPCOUNT_PORTABLE, POPCOUNT_HARDWARE,
+                                POPCOUNT_AVX2, POPCOUNT_AVX512};
+
+    for (size_t iter = 0; iter < 4; iter++) {
+        if (popcountSelectKernel(kernels[iter]) == 0) {
+            assert(findSetSize(&set) == expectedSize &&
+                   "Ошибка, неверный размер множества");
+            // Срезы с некратными вектору границами
+            for (size_t from = 0; from < 40; from += 7) {
+                size_t sliceSize = 0;
+                for (size_t elem = from * 64; elem < (from + 37) * 64; elem++) {
+                    sliceSize += bitsetContains(&set, elem);
+                }
+                assert(bitsetCountBlocks(&set, from, from + 37) == sliceSize &&
+                       "Ошибка, неверный размер среза множества");
+            }
+        }
+    }
+    popcountSelectKernel(POPCOUNT_AUTO);
+
+    assert(bitsetCountBlocks(&set, 10, 5) == 0 && "Ошибка, пустой срез");
+
+    bitsetDestroy(&set);
+}
+
 void test_complement() {
-    //
+    {
+        BitSet set = bitsetCreate(10);
+        int values[] = {0, 3, 10};
+        bitsetAddMany(&set, values, 3);
+
+        BitSet result = getComplementSet(&set);
+
+        assert(result.size == 8 && "Ошибка, неверный размер дополнения");
+        assert(!bitsetContains(&result, 3) && bitsetContains(&result, 9) &&
+               "Ошибка, дополнение множества некорректно");
+        assert(!bitsetContains(&result, 10) && "Ошибка, дополнение вне универсума");
+
+        bitsetDestroy(&set);
+        bitsetDestroy(&result);
+    }
+
+    {
+        // Универсум, кратный размеру блока
+        BitSet set = bitsetCreate(128);
+        BitSet result = getComplementSet(&set);
+
+        assert(result.size == 129 && findSetSize(&result) == 129 &&
+               "Ошибка, неверный размер дополнения");
+        assert(bitsetContains(&result, 64) && bitsetContains(&result, 128) &&
+               "Ошибка, дополнение множества некорректно");
+
+        bitsetDestroy(&set);
+        bitsetDestroy(&result);
+    }
+}
+
+void test_operations_into() {
+    const size_t N = 3000;
+
+    {
+        BitSet set1 = bitsetCreate(N);
+        BitSet set2 = bitsetCreate(N);
+        BitSet result = bitsetCreate(N);
+
+        for (size_t iter = 0; iter < N; iter += 3) {
+            bitsetAdd(&set1, iter);
+        }
+        for (size_t iter = 0; iter < N; iter += 5) {
+            bitsetAdd(&set2, iter);
+        }
+
+        BitSet expected = getSetsSymmetricDifference(&set1, &set2);
+        assert(getSetsSymmetricDifferenceInto(&result, &set1, &set2) == 0);
+        assert(setsIsEqual(&result, &expected) &&
+               "Ошибка, симметричная разность в готовое множество некорректна");
+        bitsetDestroy(&expected);
+
+        expected = getSetsIntersection(&set1, &set2);
+        assert(bitsetIntersectionInPlace(&set1, &set2) == 0);
+        assert(setsIsEqual(&set1, &expected) && set1.size == N / 15 &&
+               "Ошибка, пересечение на месте некорректно");
+        bitsetDestroy(&expected);
+
+        bitsetDestroy(&set1);
+        bitsetDestroy(&set2);
+        bitsetDestroy(&result);
+    }
+
+    {
+        // Множества разной ёмкости: недостающие блоки считаются нулевыми
+        BitSet smallSet = bitsetCreate(100);
+        BitSet bigSet = bitsetCreate(N);
+        int smallValues[] = {1, 70, 100};
+        int bigValues[] = {1, 2, 2000, 3000};
+
+        bitsetAddMany(&smallSet, smallValues, 3);
+        bitsetAddMany(&bigSet, bigValues, 4);
+
+        assert(bitsetUnionInPlace(&smallSet, &bigSet) == -1 &&
+               "Ошибка, результат не помещается в множество");
+
+        BitSet result = getSetsUnion(&smallSet, &bigSet);
+        assert(result.size == 6 && bitsetContains(&result, 3000) &&
+               "Ошибка, объединение множеств разной ёмкости некорректно");
+
+        assert(bitsetUnionInPlace(&bigSet, &smallSet) == 0);
+        assert(setsIsEqual(&bigSet, &result) &&
+               "Ошибка, объединение на месте некорректно");
+
+        assert(bitsetDifferenceInPlace(&result, &smallSet) == 0);
+        assert(result.size == 3 && bitsetContains(&result, 2000) &&
+               !bitsetContains(&result, 70) &&
+               "Ошибка, разность на месте некорректна");
+
+        bitsetDestroy(&smallSet);
+        bitsetDestroy(&bigSet);
+        bitsetDestroy(&result);
+    }
+}
+
+void test_expression() {
+    const size_t N = 40000;
+
+    BitSet A = bitsetCreate(N);
+    BitSet B = bitsetCreate(N);
+    BitSet C = bitsetCreate(N);
+    BitSet D = bitsetCreate(N / 2);
+
+    for (size_t iter = 0; iter < N; iter++) {
+        if (iter % 3 == 0) bitsetAdd(&A, iter);
+        if (iter % 5 == 1) bitsetAdd(&B, iter);
+        if (iter % 7 < 3) bitsetAdd(&C, iter);
+        if (iter % 2 == 0) bitsetAdd(&D, iter);
+    }
+
+    // Эталон: попарное вычисление A - (B Δ C) ∪ ((¬D ∩ B) - A) ∪ (C ∩ D)
+    BitSet _1 = getSetsSymmetricDifference(&B, &C);
+    BitSet _2 = getSetsDifference(&A, &_1);
+    BitSet _3 = getComplementSet(&D);
+    BitSet _4 = getSetsIntersection(&_3, &B);
+    BitSet _5 = getSetsDifference(&_4, &A);
+    BitSet _6 = getSetsUnion(&_2, &_5);
+    BitSet _7 = getSetsIntersection(&C, &D);
+    BitSet expected = getSetsUnion(&_6, &_7);
+
+    const char* names[4] = {"A", "B", "C", "D"};
+    BitSet*     sets[4] = {&A, &B, &C, &D};
+
+    {
+        SetExpression* expression = expressionParse(
+            "A - (B Δ C) ∪ ((¬D ∩ B) - A) ∪ (C ∩ D)", names, sets, 4);
+        assert(expression != NULL && "Ошибка разбора выражения");
+
+        BitSet result = expressionEvaluate(expression);
+        assert(setsIsEqual(&result, &expected) &&
+               "Ошибка, значение выражения некорректно");
+        assert(expressionCount(expression) == expected.size &&
+               "Ошибка, мощность выражения некорректна");
+
+        bitsetDestroy(&result);
+        expressionDestroy(expression);
+    }
+
+    {
+        // Те же операции, построенные вручную, с записью в операнд
+        SetExpression* expression = expressionUnion(
+            expressionUnion(
+                expressionDifference(
+                    expressionSet(&A), expressionSymmetricDifference(
+                                           expressionSet(&B), expressionSet(&C))),
+                expressionDifference(
+                    expressionIntersection(expressionComplement(expressionSet(&D)),
+                                           expressionSet(&B)),
+                    expressionSet(&A))),
+            expressionIntersection(expressionSet(&C), expressionSet(&D)));
+
+        assert(expressionEvaluateInto(expression, &A) == 0);
+        assert(setsIsEqual(&A, &expected) &&
+               "Ошибка, значение выражения некорректно");
+
+        expressionDestroy(expression);
+    }
+
+    {
+        assert(expressionParse("A ∪ (B", names, sets, 4) == NULL &&
+               "Ошибка, незакрытая скобка не обнаружена");
+        assert(expressionParse("A ∪ E", names, sets, 4) == NULL &&
+               "Ошибка, неизвестное множество не обнаружено");
+        assert(expressionParse("A B", names, sets, 4) == NULL &&
+               "Ошибка, лишние символы не обнаружены");
+
+        SetExpression* expression = expressionParse("~D", names, sets, 4);
+        BitSet small = bitsetCreate(10);
+        assert(expressionEvaluateInto(expression, &small) == -1 &&
+               "Ошибка, результат не помещается в множество");
+        bitsetDestroy(&small);
+        expressionDestroy(expression);
+    }
+
+    {
+        // Δ связывает слабее разности: A ^ B - C = A Δ (B - C)
+        SetExpression* expression = expressionParse("A ^ B - C", names,
+                                                    sets, 4);
+        BitSet         difference = getSetsDifference(&B, &C);
+        BitSet         mixed      = getSetsSymmetricDifference(&A, &difference);
+        BitSet         result     = expressionEvaluate(expression);
+
+        assert(setsIsEqual(&result, &mixed) &&
+               "Ошибка, приоритет разности и симметрической разности");
+
+        bitsetDestroy(&result);
+        bitsetDestroy(&mixed);
+        bitsetDestroy(&difference);
+        expressionDestroy(expression);
+    }
+
+    BitSet* temporaries[] = {&_1, &_2, &_3, &_4, &_5, &_6, &_7, &expected,
+                             &A, &B, &C, &D};
+    for (size_t iter = 0; iter < 12; iter++) {
+        bitsetDestroy(temporaries[iter]);
+    }
+}
+
+// Проверка совпадения сжатого множества с плотным
+static bool roaringMatchesBitSet(RoaringSet* sparse, BitSet* dense) {
+    BitSet converted = roaringToBitSet(sparse);
+    bool isMatching = setsIsEqual(&converted, dense) &&
+                      roaringSize(sparse) == dense->size;
+    bitsetDestroy(&converted);
+    return isMatching;
+}
+
+void test_roaring() {
+    const size_t N = 300000;
+
+    RoaringSet sparseA = roaringCreate(N);
+    RoaringSet sparseB = roaringCreate(N);
+    BitSet denseA = bitsetCreate(N);
+    BitSet denseB = bitsetCreate(N);
+
+    // Разреженный участок, плотный участок и длинный отрезок
+    uint32_t seed = 12345;
+    for (size_t iter = 0; iter < 3000; iter++) {
+        seed = seed * 1103515245 + 12345;
+        int element = (int)(seed % 65536);
+        roaringAdd(&sparseA, element);
+        bitsetAdd(&denseA, element);
+    }
+    for (size_t iter = 65536; iter < 131072; iter += 3) {
+        roaringAdd(&sparseA, (int)iter);
+        bitsetAdd(&denseA, (int)iter);
+    }
+    for (size_t iter = 100000; iter <= N; iter++) {
+        roaringAdd(&sparseB, (int)iter);
+        bitsetAdd(&denseB, (int)iter);
+    }
+    for (size_t iter = 0; iter < 65536; iter += 7) {
+        roaringAdd(&sparseB, (int)iter);
+        bitsetAdd(&denseB, (int)iter);
+    }
+    roaringRunOptimize(&sparseB);
+
+    assert(roaringMatchesBitSet(&sparseA, &denseA) &&
+           "Ошибка, сжатое множество не совпадает с плотным");
+    assert(roaringMatchesBitSet(&sparseB, &denseB) &&
+           "Ошибка, сжатое множество не совпадает с плотным");
+    assert(roaringContains(&sparseB, (int)N) && !roaringContains(&sparseB, 1));
+
+    {
+        RoaringSet (*sparseOperations[])(RoaringSet*, RoaringSet*) = {
+            roaringUnion, roaringIntersection, roaringDifference,
+            roaringSymmetricDifference};
+        BitSet (*denseOperations[])(BitSet*, BitSet*) = {
+            getSetsUnion, getSetsIntersection, getSetsDifference,
+            getSetsSymmetricDifference};
+
+        for (size_t iter = 0; iter < 4; iter++) {
+            RoaringSet sparseResult = sparseOperations[iter](&sparseA, &sparseB);
+            BitSet denseResult = denseOperations[iter](&denseA, &denseB);
+            assert(roaringMatchesBitSet(&sparseResult, &denseResult) &&
+                   "Ошибка, операция над сжатыми множествами некорректна");
+            roaringDestroy(&sparseResult);
+            bitsetDestroy(&denseResult);
+        }
+
+        RoaringSet sparseResult = roaringComplement(&sparseA);
+        BitSet denseResult = getComplementSet(&denseA);
+        assert(roaringMatchesBitSet(&sparseResult, &denseResult) &&
+               "Ошибка, дополнение сжатого множества некорректно");
+        roaringDestroy(&sparseResult);
+        bitsetDestroy(&denseResult);
+
+        sparseResult = roaringIntersectionWithBitSet(&sparseA, &denseB);
+        denseResult = getSetsIntersection(&denseA, &denseB);
+        assert(roaringMatchesBitSet(&sparseResult, &denseResult) &&
+               "Ошибка, пересечение со плотным множеством некорректно");
+        roaringDestroy(&sparseResult);
+        bitsetDestroy(&denseResult);
+    }
+
+    {
+        RoaringSet converted = roaringFromBitSet(&denseA);
+        assert(roaringIsEqual(&converted, &sparseA) &&
+               "Ошибка, преобразование плотного множества некорректно");
+        roaringRemove(&converted, 65536 + 3);
+        assert(roaringIsStrictSubset(&converted, &sparseA) &&
+               !roaringIsSubset(&sparseA, &converted) &&
+               "Ошибка, проверка подмножества некорректна");
+        roaringDestroy(&converted);
+
+        BitSet dense = bitsetCreate(N);
+        assert(roaringUnionIntoBitSet(&dense, &sparseB) == 0);
+        assert(setsIsEqual(&dense, &denseB) &&
+               "Ошибка, объединение с плотным множеством некорректно");
+        bitsetDestroy(&dense);
+    }
+
+    {
+        // Память определяется содержимым, а не ёмкостью
+        RoaringSet huge = roaringCreate(2147483647);
+        roaringAdd(&huge, 5);
+        roaringAdd(&huge, 2147483000);
+        assert(roaringMemoryUsage(&huge) < 1024 && roaringSize(&huge) == 2 &&
+               "Ошибка, сжатое множество занимает слишком много памяти");
+
+        RoaringSet complement = roaringComplement(&huge);
+        assert(roaringSize(&complement) == 2147483646 &&
+               !roaringContains(&complement, 5) &&
+               roaringContains(&complement, 2147483647) &&
+               "Ошибка, дополнение большого множества некорректно");
+        roaringDestroy(&complement);
+        roaringDestroy(&huge);
+    }
+
+    roaringDestroy(&sparseA);
+    roaringDestroy(&sparseB);
+    bitsetDestroy(&denseA);
+    bitsetDestroy(&denseB);
+}
+
+void test_ewah() {
+    const size_t N = 200000;
+
+    BitSet denseA = bitsetCreate(N);
+    BitSet denseB = bitsetCreate(N + 5000);
+
+    // Длинные серии единиц, отдельные элементы и пустые участки
+    for (size_t iter = 1000; iter < 90000; iter++) {
+        bitsetAdd(&denseA, iter);
+    }
+    for (size_t iter = 120000; iter < N; iter += 997) {
+        bitsetAdd(&denseA, iter);
+    }
+    for (size_t iter = 50000; iter < 150000; iter++) {
+        bitsetAdd(&denseB, iter);
+    }
+    bitsetAdd(&denseB, 17);
+    bitsetAdd(&denseB, N + 5000);
+
+    EwahSet setA = ewahFromBitSet(&denseA);
+    EwahSet setB = ewahFromBitSet(&denseB);
+
+    assert(ewahSize(&setA) == denseA.size && ewahCount(&setA) == denseA.size &&
+           "Ошибка, неверный размер сжатого множества");
+    assert(setA.length < denseA.blockCount / 10 &&
+           "Ошибка, серии не сжаты");
+    assert(ewahContains(&setA, 1000) && ewahContains(&setA, 120000 + 997) &&
+           !ewahContains(&setA, 999) && !ewahContains(&setA, 120001) &&
+           ewahContains(&setB, N + 5000));
+
+    {
+        EwahSet (*ewahOperations[])(EwahSet*, EwahSet*) = {
+            ewahUnion, ewahIntersection, ewahDifference,
+            ewahSymmetricDifference};
+        BitSet (*denseOperations[])(BitSet*, BitSet*) = {
+            getSetsUnion, getSetsIntersection, getSetsDifference,
+            getSetsSymmetricDifference};
+
+        for (size_t iter = 0; iter < 8; iter++) {
+            EwahSet* left = iter < 4 ? &setA : &setB;
+            EwahSet* right = iter < 4 ? &setB : &setA;
+            BitSet* denseLeft = iter < 4 ? &denseA : &denseB;
+            BitSet* denseRight = iter < 4 ? &denseB : &denseA;
+
+            EwahSet result = ewahOperations[iter % 4](left, right);
+            BitSet expected = denseOperations[iter % 4](denseLeft, denseRight);
+            BitSet converted = ewahToBitSet(&result);
+
+            assert(setsIsEqual(&converted, &expected) &&
+                   ewahCount(&result) == expected.size &&
+                   "Ошибка, операция над сжатыми множествами некорректна");
+
+            ewahDestroy(&result);
+            bitsetDestroy(&expected);
+            bitsetDestroy(&converted);
+        }
+    }
+
+    {
+        EwahSet result = ewahComplement(&setA);
+        BitSet expected = getComplementSet(&denseA);
+        BitSet converted = ewahToBitSet(&result);
+
+        assert(setsIsEqual(&converted, &expected) &&
+               "Ошибка, дополнение сжатого множества некорректно");
+
+        ewahDestroy(&result);
+        bitsetDestroy(&expected);
+        bitsetDestroy(&converted);
+
+        EwahSet empty = ewahCreate(N);
+        assert(ewahSize(&empty) == 0 && !ewahContains(&empty, 5));
+        ewahDestroy(&empty);
+    }
+
+    ewahDestroy(&setA);
+    ewahDestroy(&setB);
+    bitsetDestroy(&denseA);
+    bitsetDestroy(&denseB);
+}
+
+static void sumVisitor(int element, void* context) {
+    *(long long*)context += element;
+}
+
+void test_iteration() {
+    const size_t N = 1000000;
+    BitSet set = bitsetCreate(N);
+    int values[] = {0, 63, 64, 127, 5000, 777777, 1000000};
+    bitsetAddMany(&set, values, 7);
+
+    {
+        int element = bitsetNextSet(&set, 0);
+        for (size_t iter = 0; iter < 7; iter++) {
+            assert(element == values[iter] && "Ошибка, неверный следующий элемент");
+            element = bitsetNextSet(&set, element + 1);
+        }
+        assert(element == -1 && "Ошибка, лишний элемент при обходе");
+
+        assert(bitsetNextSet(&set, 5001) == 777777);
+        assert(bitsetPrevSet(&set, 777776) == 5000);
+        assert(bitsetPrevSet(&set, 64) == 64 && bitsetPrevSet(&set, 63) == 63);
+        assert(bitsetPrevSet(&set, (int)N + 10) == (int)N);
+        assert(bitsetPrevSet(&set, -1) == -1);
+    }
+
+    {
+        int output[7];
+        assert(bitsetToArray(&set, 0, output, 7) == 7 &&
+               "Ошибка, неверное число извлечённых элементов");
+        for (size_t iter = 0; iter < 7; iter++) {
+            assert(output[iter] == values[iter] &&
+                   "Ошибка, неверный извлечённый элемент");
+        }
+        assert(bitsetToArray(&set, 65, output, 2) == 2 &&
+               output[0] == 127 && output[1] == 5000);
+
+        long long sum = 0;
+        bitsetForEach(&set, sumVisitor, &sum);
+
+        long long expectedSum = 0;
+        size_t count = 0;
+        BITSET_FOREACH(&set, element) {
+            expectedSum += element;
+            count++;
+        }
+        assert(count == 7 && sum == expectedSum && sum == 1783031 &&
+               "Ошибка, обход множества некорректен");
+    }
+
+    bitsetDestroy(&set);
+}
+
+void test_range() {
+    const size_t N = 1000;
+    BitSet set = bitsetCreate(N);
+    BitSet expected = bitsetCreate(N);
+
+    // Диапазоны внутри блока, на границах блоков и через несколько блоков
+    int ranges[][2] = {{3, 9}, {60, 70}, {64, 128}, {100, 900}, {990, 1001}};
+
+    for (size_t iter = 0; iter < 5; iter++) {
+        assert(bitsetAddRange(&set, ranges[iter][0], ranges[iter][1]) == 0);
+        for (int element = ranges[iter][0]; element < ranges[iter][1]; element++) {
+            bitsetAdd(&expected, element);
+        }
+        assert(setsIsEqual(&set, &expected) &&
+               "Ошибка, добавление диапазона некорректно");
+    }
+
+    assert(bitsetContainsRange(&set, 100, 900) &&
+           !bitsetContainsRange(&set, 9, 61) &&
+           bitsetContainsRange(&set, 5, 5) &&
+           "Ошибка, проверка диапазона некорректна");
+    assert(bitsetCountRange(&set, 0, 64) == 10 &&
+           bitsetCountRange(&set, 0, (int)N + 1) == set.size &&
+           "Ошибка, подсчёт диапазона некорректен");
+
+    assert(bitsetRemoveRange(&set, 65, 899) == 0);
+    for (int element = 65; element < 899; element++) {
+        bitsetRemove(&expected, element);
+    }
+    assert(setsIsEqual(&set, &expected) &&
+           "Ошибка, удаление диапазона некорректно");
+
+    assert(bitsetFlipRange(&set, 1, 1000) == 0);
+    for (int element = 1; element < 1000; element++) {
+        if (bitsetContains(&expected, element)) {
+            bitsetRemove(&expected, element);
+        } else {
+            bitsetAdd(&expected, element);
+        }
+    }
+    assert(setsIsEqual(&set, &expected) && set.size == findSetSize(&set) &&
+           "Ошибка, инвертирование диапазона некорректно");
+
+    assert(bitsetAddRange(&set, 10, 5) == -1 &&
+           bitsetAddRange(&set, 0, (int)N + 2) == -1 &&
+           bitsetRemoveRange(&set, -1, 3) == -1 &&
+           "Ошибка, неверный диапазон не обнаружен");
+
+    bitsetDestroy(&set);
+    bitsetDestroy(&expected);
+}
+
+void test_add_many() {
+    // Множество крупнее L2, чтобы неупорядоченная пачка шла через корзины
+    const size_t N = 4000000;
+    const size_t COUNT = 200000;
+    BitSet set = bitsetCreate(N);
+    BitSet expected = bitsetCreate(N);
+    int* array = (int*)malloc(COUNT * sizeof(int));
+
+    assert(array != NULL && "Ошибка, не удалось выделить память");
+
+    // Упорядоченная пачка с повторами
+    for (size_t iter = 0; iter < COUNT; iter++) {
+        array[iter] = (int)(iter / 2 * 7);
+    }
+    bitsetAddMany(&set, array, (int)COUNT);
+    for (size_t iter = 0; iter < COUNT; iter++) {
+        bitsetAdd(&expected, array[iter]);
+    }
+    assert(setsIsEqual(&set, &expected) && set.size == findSetSize(&set) &&
+           "Ошибка, упорядоченная пачка добавлена неверно");
+
+    // Неупорядоченная пачка с повторами
+    for (size_t iter = 0; iter < COUNT; iter++) {
+        array[iter] = (int)((iter * 2654435761u) % (N + 1));
+    }
+    clock_t start = clock();
+    bitsetAddMany(&set, array, (int)COUNT);
+    clock_t end = clock();
+    printf("Пакетное добавление %zu элементов заняло %.6f секунд.\n",
+    COUNT, (double)(end - start) / CLOCKS_PER_SEC);
+
+    for (size_t iter = 0; iter < COUNT; iter++) {
+        bitsetAdd(&expected, array[iter]);
+    }
+    assert(setsIsEqual(&set, &expected) && set.size == findSetSize(&set) &&
+           "Ошибка, неупорядоченная пачка добавлена неверно");
+
+    bitsetRemoveMany(&set, array, (int)(COUNT / 3));
+    for (size_t iter = 0; iter < COUNT / 3; iter++) {
+        bitsetRemove(&expected, array[iter]);
+    }
+    assert(setsIsEqual(&set, &expected) && set.size == findSetSize(&set) &&
+           "Ошибка, пакетное удаление некорректно");
+
+    // Пачка с выходом за границы: верные элементы всё равно добавляются
+    BitSet small = bitsetCreate(100);
+    int outOfRange[] = {5, 101, 64, -1, 100};
+
+    bitsetAddMany(&small, outOfRange, 5);
+    assert(small.size == 3 && bitsetContains(&small, 5) &&
+           bitsetContains(&small, 64) && bitsetContains(&small, 100) &&
+           "Ошибка, пачка с неверными элементами обработана некорректно");
+
+    free(array);
+    bitsetDestroy(&set);
+    bitsetDestroy(&expected);
+    bitsetDestroy(&small);
+}
+
+void countingCallback(ErrorCode code, long long value, size_t limit,
+                      void* context) {
+    (void)code;
+    (void)value;
+    (void)limit;
+    *(size_t*)context += 1;
+}
+
+void test_errors() {
+    BitSet set = bitsetCreate(100);
+    size_t calls = 0;
+
+    errorClear();
+    errorResetCounters();
+    assert(bitsetAdd(&set, 50) == 0 && errorLast() == ERROR_NONE);
+    assert(bitsetAdd(&set, 101) == -1 && bitsetRemove(&set, -1) == -1 &&
+           errorLast() == ERROR_OUT_OF_RANGE && set.size == 1 &&
+           "Ошибка, выход за границы не обнаружен");
+
+    // Обработчик вызывается не чаще 5 раз в секунду, остальное считается
+    errorSetCallback(countingCallback, &calls, 5);
+    for (int iter = 0; iter < 100; iter++) {
+        bitsetAdd(&set, 200 + iter);
+    }
+    errorSetCallback(NULL, NULL, 0);
+
+    assert(errorCount(ERROR_OUT_OF_RANGE) == 102 &&
+           calls + errorSuppressedCount(ERROR_OUT_OF_RANGE) == 100 &&
+           calls >= 5 && calls <= 10 &&
+           "Ошибка, ограничение обработчика ошибок некорректно");
+
+    bitsetAddUnchecked(&set, 100);
+    bitsetAddUnchecked(&set, 100);
+    bitsetRemoveUnchecked(&set, 50);
+    bitsetRemoveUnchecked(&set, 50);
+    assert(set.size == 1 && bitsetContainsUnchecked(&set, 100) &&
+           !bitsetContainsUnchecked(&set, 50) &&
+           "Ошибка, варианты без проверки некорректны");
+
+    errorClear();
+    errorResetCounters();
+    bitsetDestroy(&set);
+}
+
+void test_allocator() {
+    const size_t N = 10000;
+
+    // Распределитель по умолчанию выравнивает блоки по строке кэша
+    BitSet aligned = bitsetCreate(N);
+    assert((uintptr_t)aligned.bits % ALLOCATOR_ALIGNMENT == 0 &&
+           "Ошибка, блоки не выровнены");
+    bitsetDestroy(&aligned);
+
+    // Арена: временные множества выражения и сброс за O(1)
+    ArenaAllocator arena;
+    assert(allocatorArenaInit(&arena, 16 * 1024) == 0);
+
+    BitSet A = bitsetCreateWith(N, &arena.base);
+    BitSet B = bitsetCreateWith(N, &arena.base);
+    bitsetAddRange(&A, 0, 5000);
+    bitsetAddRange(&B, 2500, 7500);
+
+    BitSet C = getSetsIntersection(&A, &B);
+    assert(C.allocator == &arena.base && C.size == 2500 &&
+           (uintptr_t)C.bits % ALLOCATOR_ALIGNMENT == 0 &&
+           "Ошибка, операция в арене некорректна");
+
+    // Не поместившееся в арену выделяется обычным образом
+    BitSet large = bitsetCreateWith(N * 64, &arena.base);
+    assert(large.bits != NULL && arena.overflow == 1 &&
+           "Ошибка, переполнение арены обработано некорректно");
+    bitsetDestroy(&large);
+
+    size_t used = arena.used;
+    bitsetDestroy(&C);
+    assert(arena.used == used && "Ошибка, арена освобождает блоки по одному");
+
+    allocatorArenaReset(&arena);
+    assert(arena.used == 0);
+
+    BitSet D = bitsetCreateWith(N, &arena.base);
+    assert(D.size == 0 && findSetSize(&D) == 0 &&
+           "Ошибка, память арены после сброса не обнулена");
+    allocatorArenaDestroy(&arena);
+
+    // Пул: массивы одного класса размеров переиспользуются
+    PoolAllocator pool;
+    allocatorPoolInit(&pool, 4);
+
+    for (int iter = 0; iter < 100; iter++) {
+        BitSet set = bitsetCreateWith(N, &pool.base);
+        assert(set.size == 0 && findSetSize(&set) == 0 &&
+               "Ошибка, массив из пула не обнулён");
+        bitsetAddRange(&set, 0, (int)N);
+        bitsetDestroy(&set);
+    }
+    assert(pool.misses == 1 && pool.hits == 99 &&
+           "Ошибка, пул не переиспользует массивы");
+    allocatorPoolDestroy(&pool);
+}
+
+void test_parallel() {
+    const size_t N = 1000000;
+    BitSet A = bitsetCreate(N);
+    BitSet B = bitsetCreate(N / 2);
+
+    for (size_t iter = 0; iter <= N; iter += 3) {
+        bitsetAdd(&A, (int)iter);
+    }
+    for (size_t iter = 0; iter <= N / 2; iter += 5) {
+        bitsetAdd(&B, (int)iter);
+    }
+
+    // Эталон считается последовательно, до запуска пула
+    BitSet serial[5] = {getSetsUnion(&A, &B), getSetsIntersection(&A, &B),
+                        getSetsDifference(&A, &B),
+                        getSetsSymmetricDifference(&A, &B),
+                        getComplementSet(&A)};
+
+    assert(parallelInit(4) == 0 && parallelThreadCount() == 4);
+    parallelSetThreshold(64);
+
+    BitSet parallel[5] = {getSetsUnion(&A, &B), getSetsIntersection(&A, &B),
+                          getSetsDifference(&A, &B),
+                          getSetsSymmetricDifference(&A, &B),
+                          getComplementSet(&A)};
+
+    for (size_t iter = 0; iter < 5; iter++) {
+        assert(parallel[iter].size == serial[iter].size &&
+               memcmp(parallel[iter].bits, serial[iter].bits,
+                      serial[iter].blockCount * sizeof(uint64_t)) == 0 &&
+               "Ошибка, параллельная операция некорректна");
+        assert(setsIsEqual(&parallel[iter], &serial[iter]) &&
+               findSetSize(&parallel[iter]) == serial[iter].size &&
+               "Ошибка, параллельные сравнение или подсчёт некорректны");
+    }
+
+    assert(setIsSubset(&parallel[1], &A) && setIsSubset(&parallel[1], &B) &&
+           !setIsSubset(&A, &B) && !setsIsEqual(&A, &parallel[0]) &&
+           "Ошибка, параллельные предикаты некорректны");
+
+    // Малые множества остаются в вызывающем потоке
+    parallelSetThreshold(PARALLEL_DEFAULT_THRESHOLD);
+    BitSet small = getSetsUnion(&B, &B);
+    assert(setsIsEqual(&small, &B));
+
+    parallelShutdown();
+    assert(parallelThreadCount() == 1);
+
+    for (size_t iter = 0; iter < 5; iter++) {
+        bitsetDestroy(&serial[iter]);
+        bitsetDestroy(&parallel[iter]);
+    }
+    bitsetDestroy(&small);
+    bitsetDestroy(&A);
+    bitsetDestroy(&B);
+}
+
+void test_mapped() {
+    const size_t N = 100000;
+    const char* path = "test_mapped.bitset";
+    BitSet set = bitsetCreate(N);
+
+    for (size_t iter = 0; iter <= N; iter += 7) {
+        bitsetAdd(&set, (int)iter);
+    }
+    assert(bitsetSave(&set, path) == 0 && "Ошибка, множество не сохранено");
+
+    // Только чтение: запросы и операции выполняются прямо на отображении
+    BitSet mapped;
+    assert(bitsetOpenMapped(path, BITSET_MAP_READ_ONLY | BITSET_MAP_VERIFY,
+                            &mapped) == 0 &&
+           "Ошибка, множество не отображено");
+    assert((uintptr_t)mapped.bits % 4096 == 0 && mapped.size == set.size &&
+           setsIsEqual(&mapped, &set) && setIsSubset(&mapped, &set) &&
+           bitsetContains(&mapped, 70) && !bitsetContains(&mapped, 71) &&
+           "Ошибка, отображённое множество некорректно");
+
+    BitSet complement = getComplementSet(&mapped);
+    assert(complement.allocator == allocatorDefault() &&
+           complement.size == N + 1 - set.size &&
+           "Ошибка, операция над отображённым множеством некорректна");
+    bitsetDestroy(&complement);
+    bitsetDestroy(&mapped);
+    assert(mapped.bits == NULL);
+
+    // Копирование при записи не меняет файл
+    assert(bitsetOpenMapped(path, BITSET_MAP_COPY_ON_WRITE, &mapped) == 0);
+    bitsetAdd(&mapped, 71);
+    bitsetRemove(&mapped, 70);
+    assert(bitsetContains(&mapped, 71) && !bitsetContains(&mapped, 70));
+    bitsetDestroy(&mapped);
+
+    assert(bitsetOpenMapped(path, BITSET_MAP_READ_ONLY, &mapped) == 0 &&
+           setsIsEqual(&mapped, &set) &&
+           "Ошибка, изменения при копировании записаны в файл");
+    bitsetDestroy(&mapped);
+
+    // Порча слов обнаруживается только при проверке контрольной суммы
+    FILE* file = fopen(path, "r+b");
+    assert(file != NULL);
+    fseek(file, STORAGE_DATA_OFFSET + 8, SEEK_SET);
+    fputc(0xFF, file);
+    fclose(file);
+
+    assert(bitsetOpenMapped(path, BITSET_MAP_READ_ONLY | BITSET_MAP_VERIFY,
+                            &mapped) == -1 &&
+           errorLast() == ERROR_FORMAT &&
+           "Ошибка, повреждение данных не обнаружено");
+    assert(bitsetOpenMapped("missing.bitset", BITSET_MAP_READ_ONLY,
+                            &mapped) == -1 && errorLast() == ERROR_IO);
+
+    errorClear();
+    errorResetCounters();
+    remove(path);
+    bitsetDestroy(&set);
+}
+
+// Поток в памяти для проверки приёмника и источника на обратных вызовах
+typedef struct {
+    uint8_t data[1 << 16];
+    size_t  length;
+    size_t  position;
+} MemoryStream;
+
+size_t memoryWrite(const void* data, size_t bytes, void* context) {
+    MemoryStream* stream = (MemoryStream*)context;
+    if (stream->length + bytes > sizeof(stream->data)) {
+        bytes = sizeof(stream->data) - stream->length;
+    }
+    memcpy(stream->data + stream->length, data, bytes);
+    stream->length += bytes;
+    return bytes;
+}
+
+size_t memoryRead(void* data, size_t bytes, void* context) {
+    MemoryStream* stream = (MemoryStream*)context;
+    if (stream->position + bytes > stream->length) {
+        bytes = stream->length - stream->position;
+    }
+    memcpy(data, stream->data + stream->position, bytes);
+    stream->position += bytes;
+    return bytes;
+}
+
+void test_stream() {
+    // Порции: редкая, сплошной отрезок, плотная нерегулярная, пустая, неполная
+    const size_t N = 300000;
+    BitSet set = bitsetCreate(N);
+
+    for (size_t iter = 0; iter < 65536; iter += 1000) {
+        bitsetAdd(&set, (int)iter);
+    }
+    bitsetAddRange(&set, 70000, 130000);
+    for (size_t iter = 131072; iter < 196608; iter++) {
+        if ((iter * 2654435761u) % 3 == 0) {
+            bitsetAdd(&set, (int)iter);
+        }
+    }
+    bitsetAddRange(&set, 290000, (int)N + 1);
+
+    static MemoryStream memory;
+    memory.length = 0;
+    memory.position = 0;
+    StreamSink sink = {memoryWrite, &memory};
+    assert(streamWrite(&set, &sink) == 0 && "Ошибка, поток не записан");
+
+    // Пустая порция 3 не записана, остальные закодированы по-разному
+    uint32_t expected[][2] = {{0, STREAM_DELTA}, {1, STREAM_RUNS},
+                              {2, STREAM_RAW}, {4, STREAM_RUNS}};
+    size_t offset = sizeof(StreamHeader);
+    for (size_t iter = 0; iter < 4; iter++) {
+        StreamChunkHeader chunk;
+        memcpy(&chunk, memory.data + offset, sizeof(chunk));
+        assert(chunk.index == expected[iter][0] &&
+               chunk.encoding == expected[iter][1] &&
+               "Ошибка, выбор кодирования порции некорректен");
+        offset += sizeof(chunk) + chunk.payloadBytes;
+    }
+    assert(memory.length < set.blockCount * sizeof(uint64_t) / 2 &&
+           "Ошибка, поток не сжат");
+
+    StreamSource source = {memoryRead, NULL, &memory};
+    BitSet restored;
+    assert(streamRead(&source, &restored) == 0 &&
+           setsIsEqual(&restored, &set) && restored.capacity == N &&
+           "Ошибка, поток прочитан неверно");
+    bitsetDestroy(&restored);
+
+    // Чтение отрезка из файла с пропуском ненужных порций через fseek
+    FILE* file = tmpfile();
+    assert(file != NULL);
+    sink = streamFileSink(file);
+    assert(streamWrite(&set, &sink) == 0);
+    rewind(file);
+    source = streamFileSource(file);
+
+    BitSet range;
+    assert(streamReadRange(&source, &range, 100000, 140000) == 0);
+    BitSet expectedRange = bitsetCreate(N);
+    for (int element = 100000; element < 140000; element++) {
+        if (bitsetContains(&set, element)) {
+            bitsetAdd(&expectedRange, element);
+        }
+    }
+    assert(setsIsEqual(&range, &expectedRange) &&
+           "Ошибка, чтение отрезка потока некорректно");
+    fclose(file);
+
+    // Оборванный поток
+    memory.length -= 5;
+    source.read = memoryRead;
+    source.skip = NULL;
+    source.context = &memory;
+    memory.position = 0;
+    assert(streamRead(&source, &restored) == -1 && restored.bits == NULL &&
+           errorLast() == ERROR_IO && "Ошибка, оборванный поток не обнаружен");
+
+    // Оборванный заголовок: мусор в структуре не должен попасть в destroy
+    memset(&restored, 0xAB, sizeof(restored));
+    memory.length = 3;
+    memory.position = 0;
+    assert(streamRead(&source, &restored) == -1 && restored.bits == NULL &&
+           restored.index == NULL && restored.summary == NULL &&
+           "Ошибка, оборванный заголовок");
+    bitsetDestroy(&restored);
+
+    errorClear();
+    errorResetCounters();
+    bitsetDestroy(&range);
+    bitsetDestroy(&expectedRange);
+    bitsetDestroy(&set);
+}
+
+static uint64_t fakeTime = 0;
+
+uint64_t fakeClock() {
+    fakeTime += 100;
+    return fakeTime;
+}
+
+void countingHook(StatsFunction function, uint64_t nanoseconds, void* context) {
+    (void)function;
+    (void)nanoseconds;
+    *(size_t*)context += 1;
+}
+
+void test_stats() {
+    StatsSnapshot snapshot;
+    size_t hookCalls = 0;
+
+    statsReset();
+    statsSetClock(fakeClock);
+    statsSetHook(countingHook, &hookCalls);
+
+    BitSet A = bitsetCreate(1000);
+    BitSet B = bitsetCreate(1000);
+    bitsetAdd(&A, 1);
+    bitsetAdd(&A, 2);
+    bitsetContains(&A, 1);
+    BitSet C = getSetsUnion(&A, &B);
+    findSetSize(&C);
+    bitsetDestroy(&A);
+    bitsetDestroy(&B);
+    bitsetDestroy(&C);
+
+    statsSetHook(NULL, NULL);
+    statsSetClock(NULL);
+    statsSnapshot(&snapshot);
+
+#ifdef BITSET_STATS
+    // Каждый замер по поддельным часам длится 100 нс: корзина [64, 128)
+    assert(snapshot.calls[STATS_BITSET_CREATE] == 3 &&
+           snapshot.calls[STATS_BITSET_ADD] == 2 &&
+           snapshot.calls[STATS_SETS_UNION] == 1 &&
+           snapshot.calls[STATS_FIND_SET_SIZE] == 1 &&
+           snapshot.nanoseconds[STATS_BITSET_ADD] == 200 &&
+           snapshot.histogram[STATS_BITSET_ADD][7] == 2 &&
+           "Ошибка, счётчики вызовов некорректны");
+    assert(snapshot.setsCreated == 3 && snapshot.setsDestroyed == 3 &&
+           snapshot.bytesAllocated == 3 * 16 * sizeof(uint64_t) &&
+           snapshot.bytesAllocated == snapshot.bytesReleased &&
+           "Ошибка, учёт памяти некорректен");
+    assert(hookCalls == 11 && "Ошибка, обработчик замеров не вызван");
+
+    statsReset();
+    statsSnapshot(&snapshot);
+    assert(snapshot.calls[STATS_BITSET_ADD] == 0 && snapshot.setsCreated == 0);
+#else
+    // Без BITSET_STATS инструментирование отсутствует
+    assert(snapshot.calls[STATS_BITSET_ADD] == 0 && hookCalls == 0 &&
+           snapshot.setsCreated == 0 && "Ошибка, статистика без BITSET_STATS");
+#endif
+    assert(strcmp(statsFunctionName(STATS_FIND_SET_SIZE), "findSetSize") == 0);
+}
+
+// Сверяет rank/select с перебором по элементам
+static void checkRankSelect(BitSet* set) {
+    size_t rank = 0;
+
+    for (size_t element = 0; element <= set->capacity; element++) {
+        assert(bitsetRank(set, element) == rank &&
+               "Ошибка, rank некорректен");
+        if (bitsetContains(set, (int)element)) {
+            assert(bitsetSelect(set, rank) == (int)element &&
+                   "Ошибка, select некорректен");
+            rank++;
+        }
+    }
+    assert(bitsetRank(set, set->capacity + 1) == set->size &&
+           bitsetSelect(set, set->size) == -1 &&
+           "Ошибка, rank/select за пределами множества");
+}
+
+void test_rank_select() {
+    const size_t N = 20000;
+    BitSet set = bitsetCreate(N);
+
+    assert(bitsetMin(&set) == -1 && bitsetMax(&set) == -1 &&
+           bitsetSelect(&set, 0) == -1);
+
+    srand(7);
+    for (size_t iter = 0; iter < 3000; iter++) {
+        bitsetAdd(&set, rand() % (int)(N + 1));
+    }
+    assert(bitsetAddRange(&set, 8000, 9000) == 0);
+
+    checkRankSelect(&set);
+    assert(bitsetIndexBuild(&set) == 0 && set.index != NULL);
+    checkRankSelect(&set);
+    assert(bitsetMin(&set) == bitsetNextSet(&set, 0) &&
+           bitsetMax(&set) == bitsetPrevSet(&set, (int)N) &&
+           "Ошибка, минимум или максимум некорректны");
+
+    // Изменения после построения индекса учитываются при следующем запросе
+    bitsetAdd(&set, 0);
+    bitsetAdd(&set, (int)N);
+    bitsetRemove(&set, 8500);
+    assert(bitsetRemoveRange(&set, 12000, 16000) == 0);
+    checkRankSelect(&set);
+    assert(bitsetMin(&set) == 0 && bitsetMax(&set) == (int)N);
+
+    BitSet other = bitsetCreate(N);
+    bitsetAdd(&other, 4096);
+    assert(getSetsIntersectionInto(&set, &set, &other) == 0);
+    checkRankSelect(&set);
+    assert(bitsetMin(&set) == bitsetMax(&set));
+
+    bitsetIndexDestroy(&set);
+    assert(set.index == NULL);
+    checkRankSelect(&set);
+
+    bitsetDestroy(&other);
+    bitsetDestroy(&set);
+}
+
+// Сравнивает множество со сводкой с таким же множеством без неё
+static void checkSummarySet(BitSet* summarized, BitSet* plain) {
+    int elements[64];
+    int expected[64];
+
+    assert(setsIsEqual(summarized, plain) &&
+           findSetSize(summarized) == findSetSize(plain) &&
+           summarized->size == plain->size &&
+           "Ошибка, множество со сводкой отличается");
+    for (int from = 0; from <= (int)plain->capacity; from += 997) {
+        assert(bitsetNextSet(summarized, from) == bitsetNextSet(plain, from) &&
+               bitsetPrevSet(summarized, from) == bitsetPrevSet(plain, from) &&
+               "Ошибка, обход со сводкой некорректен");
+        size_t count = bitsetToArray(summarized, from, elements, 64);
+        assert(count == bitsetToArray(plain, from, expected, 64) &&
+               memcmp(elements, expected, count * sizeof(int)) == 0);
+    }
+}
+
+void test_summary() {
+    const size_t N = 300000;
+    BitSet A  = bitsetCreate(N);
+    BitSet B  = bitsetCreate(N / 2);
+    BitSet pA = bitsetCreate(N);
+    BitSet pB = bitsetCreate(N / 2);
+
+    assert(bitsetSummaryBuild(&A) == 0 && bitsetSummaryBuild(&B) == 0);
+    checkSummarySet(&A, &pA);
+    assert(bitsetNextSet(&A, 0) == -1 && bitsetPrevSet(&A, (int)N) == -1);
+
+    srand(11);
+    for (size_t iter = 0; iter < 200; iter++) {
+        int element = rand() % (int)(N + 1);
+        bitsetAdd(&A, element);
+        bitsetAdd(&pA, element);
+        element = rand() % (int)(N / 2 + 1);
+        bitsetAdd(&B, element);
+        bitsetAdd(&pB, element);
+    }
+    bitsetAdd(&A, (int)N);
+    bitsetAdd(&pA, (int)N);
+    bitsetAddRange(&A, 70000, 70100);
+    bitsetAddRange(&pA, 70000, 70100);
+    checkSummarySet(&A, &pA);
+    checkSummarySet(&B, &pB);
+
+    // Удаление последнего элемента слова очищает сводку
+    int last = bitsetPrevSet(&pA, (int)N - 1);
+    bitsetRemove(&A, last);
+    bitsetRemove(&pA, last);
+    checkSummarySet(&A, &pA);
+
+    BitSet (*operations[])(BitSet*, BitSet*) = {
+        getSetsUnion, getSetsIntersection, getSetsDifference,
+        getSetsSymmetricDifference
+    };
+    for (size_t iter = 0; iter < 4; iter++) {
+        BitSet result   = operations[iter](&A, &B);
+        BitSet expected = operations[iter](&pA, &pB);
+        BitSet reverse  = operations[iter](&B, &A);
+        BitSet plainRev = operations[iter](&pB, &pA);
+
+        assert(result.summary != NULL && expected.summary == NULL);
+        checkSummarySet(&result, &expected);
+        checkSummarySet(&reverse, &plainRev);
+        bitsetDestroy(&result);
+        bitsetDestroy(&expected);
+        bitsetDestroy(&reverse);
+        bitsetDestroy(&plainRev);
+    }
+
+    // Операции на месте сохраняют сводку точной
+    assert(bitsetSymmetricDifferenceInPlace(&A, &B) == 0 &&
+           bitsetSymmetricDifferenceInPlace(&pA, &pB) == 0);
+    checkSummarySet(&A, &pA);
+    assert(bitsetIntersectionInPlace(&A, &B) == 0 &&
+           bitsetIntersectionInPlace(&pA, &pB) == 0);
+    checkSummarySet(&A, &pA);
+    assert(bitsetComplementInPlace(&A) == 0 &&
+           bitsetComplementInPlace(&pA) == 0);
+    checkSummarySet(&A, &pA);
+    assert(bitsetRemoveRange(&A, 1000, (int)N) == 0 &&
+           bitsetRemoveRange(&pA, 1000, (int)N) == 0);
+    checkSummarySet(&A, &pA);
+
+    bitsetSummaryDestroy(&A);
+    assert(A.summary == NULL);
+    checkSummarySet(&A, &pA);
+
+    bitsetDestroy(&A);
+    bitsetDestroy(&B);
+    bitsetDestroy(&pA);
+    bitsetDestroy(&pB);
+}
+
+#define CONCURRENT_WRITERS 4
+#define CONCURRENT_PER_WRITER 50000
+
+typedef struct {
+    ConcurrentSet* set;
+    int            writer;
+} ConcurrentWriter;
+
+// Писатель добавляет чётные элементы по одному, нечётные пачками
+static void* concurrentWriter(void* context) {
+    ConcurrentWriter* writer = (ConcurrentWriter*)context;
+    int               batch[64];
+    int               base   = writer->writer * CONCURRENT_PER_WRITER;
+
+    for (int element = base; element < base + CONCURRENT_PER_WRITER;
+         element += 2) {
+        concurrentAdd(writer->set, element);
+        // Пересекающийся диапазон соседнего писателя
+        concurrentAdd(writer->set, (element + CONCURRENT_PER_WRITER / 2) %
+                                       (CONCURRENT_WRITERS *
+                                        CONCURRENT_PER_WRITER));
+    }
+    for (int start = base + 1; start < base + CONCURRENT_PER_WRITER;
+         start += 128) {
+        int count = 0;
+        for (int element = start;
+             element < start + 128 && element < base + CONCURRENT_PER_WRITER;
+             element += 2) {
+            batch[count++] = element;
+        }
+        concurrentAddMany(writer->set, batch, count);
+    }
+    return NULL;
+}
+
+void test_concurrent() {
+    const size_t     N = CONCURRENT_WRITERS * CONCURRENT_PER_WRITER;
+    ConcurrentSet    set = concurrentCreate(N);
+    ConcurrentWriter writers[CONCURRENT_WRITERS];
+    pthread_t        threads[CONCURRENT_WRITERS];
+    size_t           previous = 0;
+
+    for (int iter = 0; iter < CONCURRENT_WRITERS; iter++) {
+        writers[iter].set = &set;
+        writers[iter].writer = iter;
+        pthread_create(&threads[iter], NULL, concurrentWriter, &writers[iter]);
+    }
+
+    // Снимки во время записи согласованы: размер совпадает с содержимым
+    for (int iter = 0; iter < 20; iter++) {
+        BitSet snapshot = concurrentSnapshot(&set);
+        assert(snapshot.size == findSetSize(&snapshot) &&
+               snapshot.size >= previous &&
+               "Ошибка, снимок множества несогласован");
+        previous = snapshot.size;
+        bitsetDestroy(&snapshot);
+    }
+
+    for (int iter = 0; iter < CONCURRENT_WRITERS; iter++) {
+        pthread_join(threads[iter], NULL);
+    }
+
+    assert(concurrentSize(&set) == N && "Ошибка, размер множества некорректен");
+    assert(concurrentRemove(&set, 7) == 0 && !concurrentContains(&set, 7) &&
+           concurrentContains(&set, 8) && concurrentSize(&set) == N - 1);
+    assert(concurrentAdd(&set, (int)N + 1) == -1 &&
+           concurrentRemove(&set, -1) == -1 &&
+           errorLast() == ERROR_OUT_OF_RANGE);
+
+    int mixed[] = {(int)N, (int)N + 5, -3, 7};
+    concurrentAddMany(&set, mixed, 4);
+    assert(concurrentContains(&set, 7) && concurrentSize(&set) == N + 1 &&
+           "Ошибка, пакетное добавление некорректно");
+
+    BitSet snapshot = concurrentSnapshot(&set);
+    BitSet small    = bitsetCreate(N / 2);
+    assert(snapshot.size == N + 1 && bitsetContainsRange(&snapshot, 0, (int)N + 1));
+    assert(concurrentSnapshotInto(&set, &small) == -1);
+
+    bitsetDestroy(&small);
+    bitsetDestroy(&snapshot);
+    concurrentDestroy(&set);
+
+    // Разрушенное множество выглядит как не созданное: без слов и счётчиков
+    assert(concurrentAdd(&set, 0) == -1 && concurrentRemove(&set, 0) == -1 &&
+           !concurrentContains(&set, 0) && concurrentSize(&set) == 0 &&
+           "Ошибка, операции над пустым параллельным множеством");
+    errorClear();
+}
+
+void test_growable() {
+    BitSet set = bitsetCreateGrowable(10);
+
+    assert(set.growable && set.capacity == 63);
+    errorClear();
+    assert(bitsetAdd(&set, 1000) == 0 && bitsetContains(&set, 1000) &&
+           set.capacity >= 1000 && errorLast() == ERROR_NONE &&
+           "Ошибка, множество не расширилось");
+
+    // Удвоение: добавление по возрастанию перевыделяет память редко
+    for (int element = 0; element < 100000; element += 7) {
+        bitsetAdd(&set, element);
+    }
+    assert(set.blockCount <= 2 * (100000 / 64 + 1) &&
+           set.size == findSetSize(&set) && bitsetContains(&set, 99995));
+
+    assert(bitsetRemove(&set, 5000000) == 0 &&
+           !bitsetContains(&set, 5000000) && errorLast() == ERROR_NONE &&
+           "Ошибка, удаление за границей растущего множества");
+    assert(bitsetRemove(&set, -1) == -1);
+    errorClear();
+
+    int batch[] = {300000, 5, 250000};
+    bitsetAddMany(&set, batch, 3);
+    assert(bitsetAddRange(&set, 400000, 400100) == 0 &&
+           bitsetContains(&set, 300000) && bitsetContains(&set, 400099) &&
+           bitsetCountRange(&set, 400000, 400100) == 100);
+
+    // Операции над множествами разной ёмкости, результат растёт сам
+    BitSet small  = bitsetCreate(100);
+    BitSet result = bitsetCreateGrowable(0);
+    bitsetAdd(&small, 7);
+    bitsetAdd(&small, 100);
+    assert(getSetsUnionInto(&result, &small, &set) == 0 &&
+           result.size == set.size + 1 && bitsetContains(&result, 400099));
+    assert(getSetsIntersectionInto(&result, &set, &small) == 0 &&
+           result.size == 1 && bitsetContains(&result, 7));
+
+    BitSet difference = getSetsDifference(&small, &set);
+    assert(difference.growable && difference.size == 1 &&
+           bitsetContains(&difference, 100) &&
+           "Ошибка, разность множеств разной ёмкости");
+    bitsetDestroy(&difference);
+
+    // Ужатие до наибольшего элемента сохраняет элементы, индекс и сводку
+    assert(bitsetSummaryBuild(&set) == 0 && bitsetIndexBuild(&set) == 0);
+    assert(bitsetRemoveRange(&set, 200000, 400100) == 0);
+    size_t size = set.size;
+    assert(bitsetShrinkToFit(&set) == 0 &&
+           set.blockCount == 99995 / 64 + 1 && set.size == size &&
+           findSetSize(&set) == size && bitsetMax(&set) == 99995 &&
+           bitsetRank(&set, 99995) == size - 1 &&
+           "Ошибка, ужатие множества некорректно");
+    assert(bitsetAdd(&set, 200000) == 0 && bitsetMax(&set) == 200000);
+
+    // Обычное множество расширяется только явно и точно до capacity
+    assert(bitsetAdd(&small, 500) == -1);
+    assert(bitsetReserve(&small, 500) == 0 && small.capacity == 500 &&
+           bitsetAdd(&small, 500) == 0 && bitsetContains(&small, 100));
+    errorClear();
+
+    bitsetDestroy(&small);
+    bitsetDestroy(&result);
+    bitsetDestroy(&set);
+}
+
+void test_inline() {
+    ArenaAllocator arena;
+    assert(allocatorArenaInit(&arena, 4096) == 0);
+
+    // Множество до 256 элементов не выделяет память
+    BitSet A = bitsetCreateWith(200, &arena.base);
+    BitSet B = bitsetCreateWith(100, &arena.base);
+    assert(A.bits == NULL && bitsetBlocks(&A) != NULL &&
+           A.blockCount == BITSET_INLINE_WORDS && arena.used == 0 &&
+           "Ошибка, малое множество выделило память");
+
+    bitsetAddRange(&A, 10, 150);
+    bitsetAdd(&A, 200);
+    bitsetAdd(&B, 5);
+    bitsetAdd(&B, 100);
+    assert(bitsetRemove(&A, 11) == 0 && A.size == 140 &&
+           bitsetContains(&A, 200) && !bitsetContains(&A, 11));
+
+    // Копия структуры малого множества не разделяет слова с оригиналом
+    BitSet copy = A;
+    bitsetAdd(&copy, 0);
+    assert(!bitsetContains(&A, 0) && bitsetContains(&copy, 0));
+
+    BitSet unionSet     = getSetsUnion(&A, &B);
+    BitSet intersection = getSetsIntersection(&A, &B);
+    BitSet complement   = getComplementSet(&B);
+    assert(unionSet.bits == NULL && unionSet.size == 141 &&
+           intersection.size == 1 && bitsetContains(&intersection, 100) &&
+           complement.size == 99 && arena.used == 0 &&
+           "Ошибка, операции над малыми множествами некорректны");
+    assert(bitsetIndexBuild(&unionSet) == 0 &&
+           bitsetRank(&unionSet, 100) == 90 &&
+           bitsetSelect(&unionSet, 0) == 5 && bitsetMax(&unionSet) == 200);
+
+    // Растущее множество переходит в кучу и возвращается обратно
+    BitSet growable = bitsetCreateGrowable(10);
+    bitsetAdd(&growable, 3);
+    assert(growable.bits == NULL && bitsetAdd(&growable, 1000) == 0 &&
+           growable.bits != NULL && bitsetContains(&growable, 3));
+    bitsetRemove(&growable, 1000);
+    assert(bitsetShrinkToFit(&growable) == 0 && growable.bits == NULL &&
+           growable.blockCount == 1 && bitsetContains(&growable, 3) &&
+           growable.size == 1 && "Ошибка, возврат во встроенный буфер");
+
+    bitsetDestroy(&growable);
+    bitsetDestroy(&complement);
+    bitsetDestroy(&intersection);
+    bitsetDestroy(&unionSet);
+    bitsetDestroy(&copy);
+    bitsetDestroy(&B);
+    bitsetDestroy(&A);
+    allocatorArenaDestroy(&arena);
+}
+
+// Предикаты сравниваются с определением по элементам
+static void checkPredicates(BitSet* setA, BitSet* setB) {
+    bool   extraA = false;
+    bool   extraB = false;
+    bool   common = false;
+    size_t limit  = setA->capacity > setB->capacity ? setA->capacity
+                                                     : setB->capacity;
+
+    for (size_t element = 0; element <= limit; element++) {
+        bool inA = element <= setA->capacity &&
+                   bitsetContains(setA, (int)element);
+        bool inB = element <= setB->capacity &&
+                   bitsetContains(setB, (int)element);
+
+        extraA |= inA && !inB;
+        extraB |= inB && !inA;
+        common |= inA && inB;
+    }
+
+    assert(setsIsEqual(setA, setB) == (!extraA && !extraB) &&
+           setIsSubset(setA, setB) == !extraA &&
+           setIsStrictSubset(setA, setB) == (!extraA && extraB) &&
+           setIsSuperset(setA, setB) == !extraB &&
+           bitsetIntersects(setA, setB) == common &&
+           "Ошибка, предикат не совпадает с определением");
+}
+
+void test_predicates() {
+    CompareKernel kernels[] = {COMPARE_PORTABLE, COMPARE_AVX2,
+                               COMPARE_AVX512};
+    size_t        capacities[] = {100, 700, 5000};
+    int           elements[]   = {0, 63, 64, 255, 256, 511, 512, 700, 4999};
+
+    for (size_t kernel = 0; kernel < 3; kernel++) {
+        if (compareSelectKernel(kernels[kernel]) != 0) {
+            continue;
+        }
+        for (size_t iter = 0; iter < 9; iter++) {
+            BitSet A = bitsetCreate(capacities[iter % 3]);
+            BitSet B = bitsetCreate(capacities[iter / 3]);
+
+            // Общая часть, затем по одному отличию на разных позициях
+            bitsetAddRange(&A, 10, 60);
+            bitsetAddRange(&B, 10, 60);
+            checkPredicates(&A, &B);
+            for (size_t elem = 0; elem < 9; elem++) {
+                if ((size_t)elements[elem] <= B.capacity) {
+                    bitsetAdd(&B, elements[elem]);
+                    checkPredicates(&A, &B);
+                    checkPredicates(&B, &A);
+                }
+                if ((size_t)elements[elem] <= A.capacity &&
+                    elements[elem] % 2 == 1) {
+                    bitsetAdd(&A, elements[elem]);
+                    checkPredicates(&A, &B);
+                }
+            }
+            bitsetRemoveRange(&A, 0, 100);
+            bitsetRemoveRange(&B, 0, 100);
+            checkPredicates(&A, &B);
+            checkPredicates(&B, &A);
+
+            bitsetDestroy(&B);
+            bitsetDestroy(&A);
+        }
+    }
+    compareSelectKernel(COMPARE_AUTO);
+
+    BitSet empty = bitsetCreate(10);
+    BitSet full  = bitsetCreate(10);
+    bitsetAddRange(&full, 0, 11);
+    assert(setIsStrictSubset(&empty, &full) &&
+           !bitsetIntersects(&empty, &full) &&
+           !setIsStrictSubset(&full, &full) && setIsSuperset(&full, &empty) &&
+           bitsetIntersects(&full, &full) &&
+           "Ошибка, предикаты пустого множества");
+
+    bitsetDestroy(&full);
+    bitsetDestroy(&empty);
+}
+
+void test_cardinality() {
+    PopcountKernel kernels[] = {POPCOUNT_PORTABLE, POPCOUNT_HARDWARE,
+                                POPCOUNT_AVX2, POPCOUNT_AVX512};
+    BitSet         candidates[5];
+    size_t         sizes[5];
+    double         scores[5];
+    BitSet         query = bitsetCreate(70000);
+
+    srand(13);
+    for (size_t iter = 0; iter < 5; iter++) {
+        // Разные ёмкости: короче запроса, длиннее и малое встроенное
+        size_t capacity = iter == 4 ? 200 : 30000 + iter * 20000;
+        candidates[iter] = bitsetCreate(capacity);
+        for (size_t elem = 0; elem < 3000; elem++) {
+            bitsetAdd(&candidates[iter], rand() % (int)(capacity + 1));
+        }
+    }
+    for (size_t elem = 0; elem < 6000; elem++) {
+        bitsetAdd(&query, rand() % 70001);
+    }
+
+    for (size_t kernel = 0; kernel < 4; kernel++) {
+        if (popcountSelectKernel(kernels[kernel]) != 0) {
+            continue;
+        }
+        bitsetIntersectionSizeMany(&query, candidates, 5, sizes);
+        bitsetJaccardMany(&query, candidates, 5, scores);
+        for (size_t iter = 0; iter < 5; iter++) {
+            BitSet* candidate    = &candidates[iter];
+            BitSet  intersection = getSetsIntersection(&query, candidate);
+            BitSet  unionSet     = getSetsUnion(&query, candidate);
+            BitSet  difference   = getSetsDifference(&query, candidate);
+            BitSet  symmetric    = getSetsSymmetricDifference(&query,
+                                                              candidate);
+
+            assert(bitsetIntersectionSize(&query, candidate) ==
+                       intersection.size &&
+                   bitsetIntersectionSize(candidate, &query) ==
+                       intersection.size &&
+                   sizes[iter] == intersection.size &&
+                   bitsetUnionSize(&query, candidate) == unionSet.size &&
+                   bitsetDifferenceSize(&query, candidate) ==
+                       difference.size &&
+                   bitsetSymmetricDifferenceSize(&query, candidate) ==
+                       symmetric.size &&
+                   bitsetHamming(&query, candidate) == symmetric.size &&
+                   "Ошибка, мощность без построения результата");
+            assert(scores[iter] == bitsetJaccard(&query, candidate) &&
+                   bitsetJaccard(&query, candidate) ==
+                       (double)intersection.size / (double)unionSet.size &&
+                   bitsetDice(&query, candidate) ==
+                       2.0 * (double)intersection.size /
+                           (double)(query.size + candidate->size) &&
+                   "Ошибка, мера сходства некорректна");
+
+            bitsetDestroy(&symmetric);
+            bitsetDestroy(&difference);
+            bitsetDestroy(&unionSet);
+            bitsetDestroy(&intersection);
+        }
+    }
+    popcountSelectKernel(POPCOUNT_AUTO);
+
+    // Пересечение по сводкам совпадает с плотным подсчётом
+    size_t expected = bitsetIntersectionSize(&query, &candidates[1]);
+    assert(bitsetSummaryBuild(&query) == 0 &&
+           bitsetSummaryBuild(&candidates[1]) == 0 &&
+           bitsetIntersectionSize(&query, &candidates[1]) == expected &&
+           "Ошибка, мощность пересечения по сводкам");
+
+    BitSet emptyA = bitsetCreate(10);
+    BitSet emptyB = bitsetCreate(1000);
+    assert(bitsetJaccard(&emptyA, &emptyB) == 1.0 &&
+           bitsetDice(&emptyA, &emptyB) == 1.0 &&
+           bitsetJaccard(&emptyA, &query) == 0.0 &&
+           bitsetHamming(&emptyA, &query) == query.size &&
+           "Ошибка, сходство пустых множеств");
+
+    bitsetDestroy(&emptyB);
+    bitsetDestroy(&emptyA);
+    for (size_t iter = 0; iter < 5; iter++) {
+        bitsetDestroy(&candidates[iter]);
+    }
+    bitsetDestroy(&query);
+}
+
+void test_many() {
+    const size_t K = 7;
+    BitSet       sets[7];
+    BitSet*      pointers[7];
+
+    srand(17);
+    for (size_t iter = 0; iter < K; iter++) {
+        // Разные ёмкости и плотности, включая малое встроенное множество
+        size_t capacity = iter == 6 ? 150 : 40000 + iter * 7000;
+        sets[iter] = bitsetCreate(capacity);
+        pointers[iter] = &sets[iter];
+        bitsetAddRange(&sets[iter], 100, 140);
+        for (size_t elem = 0; elem < 2000 * (iter + 1); elem++) {
+            bitsetAdd(&sets[iter], rand() % (int)(capacity + 1));
+        }
+    }
+
+    BitSet unionSet     = bitsetUnionMany(pointers, K);
+    BitSet intersection = bitsetIntersectionMany(pointers, K);
+    BitSet majority     = bitsetMajorityMany(pointers, K);
+    BitSet expectUnion  = getSetsUnion(&sets[0], &sets[K - 2]);
+    BitSet expectCommon = getSetsIntersection(&sets[0], &sets[K - 2]);
+
+    for (size_t iter = 1; iter < K; iter++) {
+        bitsetUnionInPlace(&expectUnion, &sets[iter]);
+        bitsetIntersectionInPlace(&expectCommon, &sets[iter]);
+    }
+    assert(setsIsEqual(&unionSet, &expectUnion) &&
+           setsIsEqual(&intersection, &expectCommon) &&
+           findSetSize(&intersection) == intersection.size &&
+           bitsetContains(&intersection, 120) &&
+           "Ошибка, операция над массивом множеств");
+
+    // Порог сверяется с подсчётом по элементам
+    for (size_t threshold = 1; threshold <= K + 1; threshold++) {
+        BitSet result = bitsetThresholdMany(pointers, K, threshold);
+        size_t size   = 0;
+
+        for (size_t element = 0; element <= result.capacity; element++) {
+            size_t hits = 0;
+            for (size_t iter = 0; iter < K; iter++) {
+                hits += element <= sets[iter].capacity &&
+                        bitsetContains(&sets[iter], (int)element);
+            }
+            assert(bitsetContains(&result, (int)element) ==
+                       (hits >= threshold) &&
+                   "Ошибка, пороговая операция");
+            size += hits >= threshold;
+        }
+        assert(result.size == size && (threshold != K / 2 + 1 ||
+                                       setsIsEqual(&result, &majority)));
+        bitsetDestroy(&result);
+    }
+
+    // Порядок большого массива не помещается на стек
+    {
+        BitSet* repeated[100];
+        for (size_t iter = 0; iter < 100; iter++) {
+            repeated[iter] = pointers[iter % K];
+        }
+        BitSet wide = bitsetUnionMany(repeated, 100);
+        assert(setsIsEqual(&wide, &expectUnion) &&
+               "Ошибка, операция над большим массивом множеств");
+        bitsetDestroy(&wide);
+    }
+
+    // Результат может совпадать с одним из входов
+    BitSet copy = bitsetCreate(sets[3].capacity);
+    bitsetUnionInPlace(&copy, &sets[3]);
+    assert(bitsetIntersectionManyInto(&sets[3], pointers, K) == 0 &&
+           setsIsEqual(&sets[3], &expectCommon) &&
+           bitsetUnionManyInto(&sets[3], pointers, K) == -1 &&
+           bitsetThresholdManyInto(&sets[3], pointers, K, 0) == -1 &&
+           bitsetUnionManyInto(&copy, pointers, 0) == -1);
+
+    bitsetDestroy(&copy);
+    bitsetDestroy(&expectCommon);
+    bitsetDestroy(&expectUnion);
+    bitsetDestroy(&majority);
+    bitsetDestroy(&intersection);
+    bitsetDestroy(&unionSet);
+    for (size_t iter = 0; iter < K; iter++) {
+        bitsetDestroy(&sets[iter]);
+    }
+}
+
+void test_contains_many() {
+    const int    N     = 200000;
+    const size_t COUNT = 5000;
+    GatherKernel kernels[] = {GATHER_PORTABLE, GATHER_AVX2, GATHER_AVX512};
+    BitSet       set    = bitsetCreate(N);
+    BitSet       small  = bitsetCreate(100);
+    int*         ids    = (int*)malloc(COUNT * sizeof(int));
+    bool*        out    = (bool*)malloc(COUNT * sizeof(bool));
+    uint64_t*    packed = (uint64_t*)malloc((COUNT + 63) / 64 *
+                                            sizeof(uint64_t));
+
+    srand(19);
+    for (int iter = 0; iter < N / 3; iter++) {
+        bitsetAdd(&set, rand() % (N + 1));
+    }
+    bitsetAdd(&set, N);
+    for (size_t iter = 0; iter < COUNT; iter++) {
+        ids[iter] = rand() % (N + 1);
+    }
+    ids[0] = 0;
+    ids[1] = N;
+
+    for (size_t kernel = 0; kernel < 3; kernel++) {
+        if (gatherSelectKernel(kernels[kernel]) != 0) {
+            continue;
+        }
+        // Длины пачек, некратные вектору и слову ответа
+        for (size_t count = 1; count <= COUNT; count = count * 3 + 1) {
+            bitsetContainsMany(&set, ids, (int)count, out);
+            bitsetContainsManyPacked(&set, ids, (int)count, packed);
+            for (size_t iter = 0; iter < count; iter++) {
+                bool expected = bitsetContains(&set, ids[iter]);
+                assert(out[iter] == expected &&
+                       ((packed[iter / 64] >> (iter % 64)) & 1) == expected &&
+                       "Ошибка, пакетная проверка наличия");
+            }
+        }
+    }
+    gatherSelectKernel(GATHER_AUTO);
+
+    // Пачка с элементами за границами проверяется поэлементно
+    ids[2] = -5;
+    ids[3] = N + 1;
+    bitsetAdd(&small, 7);
+    bitsetContainsMany(&set, ids, (int)COUNT, out);
+    assert(out[1] && !out[2] && !out[3] &&
+           out[4] == bitsetContains(&set, ids[4]) &&
+           "Ошибка, элементы за границами");
+    ids[4] = 7;
+    bitsetContainsManyPacked(&small, ids, 5, packed);
+    assert(packed[0] == (uint64_t)1 << 4 &&
+           "Ошибка, пакетная проверка малого множества");
+
+    free(packed);
+    free(out);
+    free(ids);
+    bitsetDestroy(&small);
+    bitsetDestroy(&set);
+}
+
+void test_clone() {
+    const int N      = 1000000;
+    BitSet    source = bitsetCreateShared(N);
+    BitSet    plain  = bitsetCreate(N);
+    BitSet    small  = bitsetCreate(100);
+    BitSet    other  = bitsetCreate(N);
+    BitSet    first;
+    BitSet    second;
+    BitSet    third;
+    BitSet    fourth;
+    BitSet    tiny;
+
+    srand(23);
+    for (int iter = 0; iter < N / 10; iter++) {
+        bitsetAdd(&source, rand() % (N + 1));
+    }
+    bitsetRemove(&source, 5);
+    bitsetAdd(&source, 7);
+    bitsetSummaryBuild(&source);
+
+    uint64_t* words = source.bits;
+    BitSet    alias = source;
+
+    assert(bitsetClone(&source, &first) == 0 && setsIsEqual(&source, &first) &&
+           first.summary == NULL && source.bits == words &&
+           "Ошибка, копия множества");
+
+    // Запись в копию и в оригинал не видна другой стороне
+    bitsetAdd(&first, 5);
+    bitsetRemove(&source, 7);
+    assert(bitsetContains(&first, 5) && !bitsetContains(&source, 5) &&
+           bitsetContains(&first, 7) && !bitsetContains(&source, 7) &&
+           first.size == source.size + 2 && "Ошибка, независимость копий");
+    assert(bitsetNextSet(&source, 7) > 7 && bitsetNextSet(&first, 5) == 5 &&
+           "Ошибка, сводка оригинала");
+
+    // Изменённый оригинал остаётся на месте, копия копии общая
+    assert(bitsetClone(&source, &second) == 0 &&
+           setsIsEqual(&source, &second) && source.bits == words &&
+           !bitsetContains(&alias, 7) && "Ошибка, копия изменённого");
+    bitsetAdd(&source, 9);
+    assert(!bitsetContains(&second, 9) && "Ошибка, запись после копии");
+    bitsetRemove(&source, 9);
+    assert(bitsetClone(&second, &third) == 0 && "Ошибка, копия копии");
+    assert(bitsetClone(&third, &fourth) == 0 && "Ошибка, копия копии");
+    bitsetDestroy(&source);
+    bitsetAdd(&other, 11);
+    getSetsUnionInto(&third, &third, &other);
+    assert(bitsetContains(&third, 11) && !bitsetContains(&fourth, 11) &&
+           !bitsetContains(&second, 11) && setsIsEqual(&second, &fourth) &&
+           "Ошибка, запись операцией в копию");
+
+    // Цепочка версий: каждая копия видит свои правки
+    BitSet versions[8];
+    for (int iter = 0; iter < 8; iter++) {
+        bitsetRemove(&fourth, iter);
+        bitsetRemove(&fourth, iter * 100003);
+    }
+    versions[0] = fourth;
+    for (int iter = 1; iter < 8; iter++) {
+        bitsetAdd(&versions[iter - 1], iter * 100003);
+        assert(bitsetClone(&versions[iter - 1], &versions[iter]) == 0 &&
+               "Ошибка, цепочка версий");
+        bitsetRemove(&versions[iter - 1], 0);
+        bitsetAdd(&versions[iter - 1], iter);
+    }
+    for (int iter = 1; iter < 8; iter++) {
+        assert(bitsetContains(&versions[iter], iter * 100003) &&
+               !bitsetContains(&versions[iter], iter) &&
+               (iter == 7 || bitsetContains(&versions[iter], iter + 1)) &&
+               "Ошибка, цепочка версий");
+        bitsetDestroy(&versions[iter]);
+    }
+    fourth = versions[0];
+    assert(bitsetContains(&fourth, 1) && !bitsetContains(&fourth, 0) &&
+           bitsetContains(&fourth, 100003) &&
+           "Ошибка, цепочка версий");
+
+    // Обычное множество копируется, не меняя своих слов
+    bitsetAdd(&plain, 13);
+    words = plain.bits;
+    bitsetDestroy(&second);
+    assert(bitsetClone(&plain, &second) == 0 && plain.bits == words &&
+           setsIsEqual(&plain, &second) && "Ошибка, копия обычного");
+    bitsetAdd(&second, 15);
+    assert(!bitsetContains(&plain, 15) && "Ошибка, копия обычного");
+    bitsetDestroy(&plain);
+
+    // Малое множество копируется вместе со структурой
+    bitsetAdd(&small, 3);
+    assert(bitsetClone(&small, &tiny) == 0 && tiny.bits == NULL &&
+           "Ошибка, копия малого множества");
+    bitsetAdd(&tiny, 4);
+    assert(bitsetContains(&tiny, 3) && !bitsetContains(&small, 4) &&
+           "Ошибка, копия малого множества");
+
+    bitsetDestroy(&tiny);
+    bitsetDestroy(&fourth);
+    bitsetDestroy(&third);
+    bitsetDestroy(&second);
+    bitsetDestroy(&first);
+    bitsetDestroy(&other);
+    bitsetDestroy(&small);
+
+    // Копия растущего множества расширяется, не трогая оригинал
+    BitSet growable = bitsetCreateGrowable(1000);
+    BitSet grown;
+    bitsetAdd(&growable, 999);
+    assert(bitsetClone(&growable, &grown) == 0 && "Ошибка, копия растущего");
+    assert(bitsetAdd(&grown, 50000) == 0 && bitsetContains(&grown, 999) &&
+           growable.capacity < 50000 && bitsetContains(&growable, 999) &&
+           "Ошибка, расширение копии");
+    bitsetDestroy(&grown);
+    bitsetDestroy(&growable);
 }
 
 int main() {
@@ -462,6 +2268,30 @@ int main() {
     test_difference();
     test_symmetric_difference();
     test_complement();
+    test_set_size();
+    test_operations_into();
+    test_expression();
+    test_roaring();
+    test_ewah();
+    test_iteration();
+    test_range();
+    test_add_many();
+    test_errors();
+    test_allocator();
+    test_parallel();
+    test_mapped();
+    test_stream();
+    test_stats();
+    test_rank_select();
+    test_summary();
+    test_concurrent();
+    test_growable();
+    test_inline();
+    test_predicates();
+    test_cardinality();
+    test_many();
+    test_contains_many();
+    test_clone();
 
     printf("Все тесты пройдены успешно!\n");
 